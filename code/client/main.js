@@ -11,6 +11,26 @@ var keysDown = [];
 var readyToSend = false;
 var websocket;
 
+// the subprotocols that ask the server for binary snapshots, newest first
+var binaryProtocols = ['chaos.binary.v2', 'chaos.binary.v1'];
+
+// the number of sections in a version 2 snapshot, and the fields of each entity in each section
+// players, walls, bombs, projectiles
+var sectionFields = [3, 3, 4, 2];
+
+// the states rebuilt from version 2 snapshots, indexed by tick, so deltas can be applied to them
+var snapshotStates = {};
+// the latest tick received, acknowledged to the server with each input message
+var latestTick = null;
+// the number of older states kept, the server only keeps 32
+var keptStates = 64;
+// the input is resent after this many snapshots so the server keeps getting acknowledgements
+var ackInterval = 4;
+var snapshotsSinceSend = 0;
+
+// player colors indexed by the player ids in binary snapshots, in the same order as the server's
+var playerColors = ['blue', 'green', 'purple', 'orange'];
+
 // declaration of player sprites
 var blueSprite;
 var greenSprite;
@@ -20,102 +40,346 @@ var orangeSprite;
 function connect() {
 	
 	// create a new connection to the server, uses secure websockets
-	websocket = new WebSocket("wss://chaos-the-game.com/websocket:443");
+	// requesting a binary subprotocol asks the server for binary snapshots instead of text
+	websocket = new WebSocket("wss://chaos-the-game.com/websocket:443", binaryProtocols);
 	
 	/*
 	this is used for testing on my computer
 	
-	websocket = new WebSocket('ws://localhost:8080');
+	websocket = new WebSocket('ws://localhost:8080', binaryProtocols);
 	*/
 	
+	// binary snapshots are received as ArrayBuffers so they can be read with a DataView
+	websocket.binaryType = 'arraybuffer';
+	
 	// callback function for when a connection is first established
 	websocket.onopen = function() {
 		readyToSend = true;
 	};
 	
 	// callback function for new messages
+	// the server sends binary snapshots if it accepted a binary subprotocol, text otherwise
 	websocket.onmessage = function(event) {
-		var message = event.data;
-		
-		// split the message into player data and projectile data
-		var parts = message.split('/');
-		// split the data into individual components using the commas
-		var players = parts[0].split(',');
-		var walls = parts[1].split(',');
-		var bombs = parts[2].split(',');
-		var projectiles = parts[3].split(',');
-		
-		var index = 0;
-		
-		var canvas = document.getElementById("canvas");
-		var context = canvas.getContext("2d");
-		
-		context.clearRect(0, 0, canvas.width, canvas.height);
-		
-		// the size of each side of the square
-		var size = 100;
-		
-		// the dimensions of the walls
-		var wall_width = 40;
-		var wall_height = 200;
+		var snapshot;
+		if (typeof event.data === 'string') {
+			snapshot = parseTextSnapshot(event.data);
+		} else {
+			snapshot = parseBinarySnapshot(event.data);
+		}
 		
-		while (index < players.length) {
-			// load the correct image by passing the color of player
-			var image = loadImage(players[index]);
-			
-			// saves the current translation and rotation so it can be restored after drawing
-			context.save();
-			
-			// set the position and rotation of the image
-			context.translate(parseInt(players[index+1]), parseInt(players[index+2]));
-			context.rotate(parseInt(players[index+3]) * Math.PI/180);
-			
-			context.drawImage(image, -size/2, -size/2, size, size);
-			context.restore();
-			index += 4;
+		if (snapshot) {
+			drawSnapshot(snapshot);
 		}
 		
-		index = 1;
-		while (index < bombs.length) {
-			context.save();
-			context.translate(parseInt(bombs[index]), parseInt(bombs[index+1]));
-			context.strokeStyle = 'red';
-			context.beginPath();
-			context.arc(0, 0, parseInt(bombs[index+2]), 0, 2 * Math.PI);
-			if (parseInt(bombs[index+3])) {
-				context.fillStyle = 'rgba(255, 0, 0, 0.5)';
-			} else {
-				context.fillStyle = 'red';
+		// acknowledge new snapshots even when no keys are pressed
+		if (latestTick !== null) {
+			snapshotsSinceSend++;
+			if (snapshotsSinceSend >= ackInterval) {
+				sendData();
 			}
-			context.fill();
-			context.stroke();
-			context.restore();
-			index += 4;
 		}
-		
-		index = 0;
-		while (index < walls.length) {
-			context.save();
-			context.translate(parseInt(walls[index]), parseInt(walls[index+1]));
-			context.rotate(parseInt(walls[index+2]) * Math.PI / 180);
-			context.beginPath();
-			context.moveTo(0, -70);
-			context.lineTo(0, 70);
-			context.stroke();
+	};
+	
+}
+
+// parse a text snapshot into lists of players, walls, bombs, and projectiles
+function parseTextSnapshot(message) {
+	var snapshot = {players: [], walls: [], bombs: [], projectiles: []};
+	
+	// split the message into player data and projectile data
+	var parts = message.split('/');
+	// split the data into individual components using the commas
+	var players = parts[0].split(',');
+	var walls = parts[1].split(',');
+	var bombs = parts[2].split(',');
+	var projectiles = parts[3].split(',');
+	
+	var index = 0;
+	
+	while (index + 3 < players.length) {
+		snapshot.players.push({
+			color: players[index],
+			x: parseInt(players[index+1]),
+			y: parseInt(players[index+2]),
+			rotation: parseInt(players[index+3])
+		});
+		index += 4;
+	}
+	
+	index = 0;
+	while (index + 2 < walls.length) {
+		snapshot.walls.push({
+			x: parseInt(walls[index]),
+			y: parseInt(walls[index+1]),
+			rotation: parseInt(walls[index+2])
+		});
+		index += 3;
+	}
+	
+	// the first element is a placeholder
+	index = 1;
+	while (index + 3 < bombs.length) {
+		snapshot.bombs.push({
+			x: parseInt(bombs[index]),
+			y: parseInt(bombs[index+1]),
+			radius: parseInt(bombs[index+2]),
+			warning: parseInt(bombs[index+3])
+		});
+		index += 4;
+	}
+	
+	index = 0;
+	while (index + 1 < projectiles.length) {
+		snapshot.projectiles.push({
+			x: parseInt(projectiles[index]),
+			y: parseInt(projectiles[index+1])
+		});
+		index += 2;
+	}
+	
+	return snapshot;
+}
+
+// parse a binary snapshot, the formats are described in code/server/snapshot.h
+function parseBinarySnapshot(buffer) {
+	var view = new DataView(buffer);
+	var version = view.getUint8(0);
+	
+	if (version == 1) {
+		return parseSnapshotV1(view);
+	}
+	if (version == 2) {
+		var state = parseSnapshotV2(view);
+		if (!state) {
+			return null;
+		}
+		return stateToSnapshot(state);
+	}
+	
+	// ignore snapshots from a version of the format this client does not understand
+	console.log('unknown snapshot version');
+	return null;
+}
+
+// parse a version 1 snapshot, which always contains every object
+function parseSnapshotV1(view) {
+	var snapshot = {players: [], walls: [], bombs: [], projectiles: []};
+	
+	var playerCount = view.getUint8(1);
+	var wallCount = view.getUint8(2);
+	var bombCount = view.getUint8(3);
+	var projectileCount = view.getUint16(4, true);
+	var offset = 6;
+	
+	for (var i = 0; i < playerCount; i++) {
+		snapshot.players.push({
+			color: playerColors[view.getUint8(offset)],
+			x: view.getUint16(offset + 1, true),
+			y: view.getUint16(offset + 3, true),
+			rotation: view.getUint16(offset + 5, true)
+		});
+		offset += 7;
+	}
+	
+	for (var i = 0; i < wallCount; i++) {
+		snapshot.walls.push({
+			x: view.getUint16(offset, true),
+			y: view.getUint16(offset + 2, true),
+			rotation: view.getUint16(offset + 4, true)
+		});
+		offset += 6;
+	}
+	
+	for (var i = 0; i < bombCount; i++) {
+		snapshot.bombs.push({
+			x: view.getUint16(offset, true),
+			y: view.getUint16(offset + 2, true),
+			radius: view.getUint8(offset + 4),
+			warning: view.getUint8(offset + 5)
+		});
+		offset += 6;
+	}
+	
+	for (var i = 0; i < projectileCount; i++) {
+		snapshot.projectiles.push({
+			x: view.getUint16(offset, true),
+			y: view.getUint16(offset + 2, true)
+		});
+		offset += 4;
+	}
+	
+	return snapshot;
+}
+
+/*
+parse a version 2 snapshot into a state, a list of entities for each section
+a state maps each entity id to its fields, keyframes contain every entity and deltas
+are applied to the state of an earlier tick
+*/
+function parseSnapshotV2(view) {
+	var type = view.getUint8(1);
+	var tick = view.getUint32(2, true);
+	var offset = 6;
+	var sections = [];
+	
+	if (type == 0) {
+		// keyframe
+		for (var section = 0; section < sectionFields.length; section++) {
+			var entities = new Map();
+			var count = view.getUint16(offset, true);
+			offset += 2;
 			
-			context.restore();
-			index += 3;
+			for (var i = 0; i < count; i++) {
+				var id = view.getUint16(offset, true);
+				offset += 2;
+				var fields = [];
+				for (var field = 0; field < sectionFields[section]; field++) {
+					fields.push(view.getUint16(offset, true));
+					offset += 2;
+				}
+				entities.set(id, fields);
+			}
+			sections.push(entities);
+		}
+	} else {
+		// delta, the server only sends one against a tick this client acknowledged
+		var baseline = snapshotStates[view.getUint32(6, true)];
+		offset = 10;
+		if (!baseline) {
+			console.log('missing baseline for delta');
+			return null;
 		}
 		
-		index = 0;
-		while (index < projectiles.length) {
-			context.beginPath();
-			context.arc(parseInt(projectiles[index]), parseInt(projectiles[index+1]), 10, 0, 2 * Math.PI);
-			context.stroke();
-			index += 2;
+		for (var section = 0; section < sectionFields.length; section++) {
+			var entities = new Map(baseline[section]);
+			
+			var removedCount = view.getUint16(offset, true);
+			offset += 2;
+			for (var i = 0; i < removedCount; i++) {
+				entities.delete(view.getUint16(offset, true));
+				offset += 2;
+			}
+			
+			var changedCount = view.getUint16(offset, true);
+			offset += 2;
+			for (var i = 0; i < changedCount; i++) {
+				var id = view.getUint16(offset, true);
+				var mask = view.getUint8(offset + 2);
+				offset += 3;
+				
+				// fields not in the mask keep their value from the baseline
+				var fields = entities.has(id) ? entities.get(id).slice() : [];
+				for (var field = 0; field < sectionFields[section]; field++) {
+					if (mask & (1 << field)) {
+						fields[field] = view.getUint16(offset, true);
+						offset += 2;
+					}
+				}
+				entities.set(id, fields);
+			}
+			sections.push(entities);
 		}
+	}
+	
+	// keep the state so later deltas can use it, and forget states the server no longer has
+	snapshotStates[tick] = sections;
+	if ((latestTick === null) || (tick > latestTick)) {
+		latestTick = tick;
+	}
+	for (var kept in snapshotStates) {
+		if (latestTick - kept > keptStates) {
+			delete snapshotStates[kept];
+		}
+	}
+	
+	return sections;
+}
+
+// convert a version 2 state into lists of players, walls, bombs, and projectiles
+function stateToSnapshot(state) {
+	var snapshot = {players: [], walls: [], bombs: [], projectiles: []};
+	
+	// entities are drawn in the order of their ids, the same order the server sends them in
+	var sorted = function(entities) {
+		return Array.from(entities.entries()).sort(function(a, b) {
+			return a[0] - b[0];
+		});
 	};
 	
+	for (var [id, fields] of sorted(state[0])) {
+		snapshot.players.push({color: playerColors[id], x: fields[0], y: fields[1], rotation: fields[2]});
+	}
+	for (var [id, fields] of sorted(state[1])) {
+		snapshot.walls.push({x: fields[0], y: fields[1], rotation: fields[2]});
+	}
+	for (var [id, fields] of sorted(state[2])) {
+		snapshot.bombs.push({x: fields[0], y: fields[1], radius: fields[2], warning: fields[3]});
+	}
+	for (var [id, fields] of sorted(state[3])) {
+		snapshot.projectiles.push({x: fields[0], y: fields[1]});
+	}
+	
+	return snapshot;
+}
+
+// draw every object in a snapshot
+function drawSnapshot(snapshot) {
+	var canvas = document.getElementById("canvas");
+	var context = canvas.getContext("2d");
+	
+	context.clearRect(0, 0, canvas.width, canvas.height);
+	
+	// the size of each side of the square
+	var size = 100;
+	
+	for (var player of snapshot.players) {
+		// load the correct image by passing the color of player
+		var image = loadImage(player.color);
+		
+		// saves the current translation and rotation so it can be restored after drawing
+		context.save();
+		
+		// set the position and rotation of the image
+		context.translate(player.x, player.y);
+		context.rotate(player.rotation * Math.PI/180);
+		
+		context.drawImage(image, -size/2, -size/2, size, size);
+		context.restore();
+	}
+	
+	for (var bomb of snapshot.bombs) {
+		context.save();
+		context.translate(bomb.x, bomb.y);
+		context.strokeStyle = 'red';
+		context.beginPath();
+		context.arc(0, 0, bomb.radius, 0, 2 * Math.PI);
+		if (bomb.warning) {
+			context.fillStyle = 'rgba(255, 0, 0, 0.5)';
+		} else {
+			context.fillStyle = 'red';
+		}
+		context.fill();
+		context.stroke();
+		context.restore();
+	}
+	
+	for (var wall of snapshot.walls) {
+		context.save();
+		context.translate(wall.x, wall.y);
+		context.rotate(wall.rotation * Math.PI / 180);
+		context.beginPath();
+		context.moveTo(0, -70);
+		context.lineTo(0, 70);
+		context.stroke();
+		
+		context.restore();
+	}
+	
+	for (var projectile of snapshot.projectiles) {
+		context.beginPath();
+		context.arc(projectile.x, projectile.y, 10, 0, 2 * Math.PI);
+		context.stroke();
+	}
 }
 
 // load the correct sprite for a player based on their color
@@ -171,10 +435,14 @@ function sendData(event) {
 		data[2] = 1;
 	}
 	
-	console.log(data);
-	
 	message = data[0] + ',' + data[1] + ',' + data[2];
 	
+	// acknowledge the latest snapshot, the server sends deltas against it
+	if (latestTick !== null) {
+		message += ',' + latestTick;
+	}
+	snapshotsSinceSend = 0;
+	
 	websocket.send(message);
 }
 
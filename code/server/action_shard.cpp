@@ -0,0 +1,581 @@
+/*
+Action shard class file
+Owns a group of arenas and the connections playing in them, and runs their action loop
+
+Chaos The Game
+*/
+
+// this project uses the websocketpp library to handle WebSocket communication
+#include <websocketpp/server.hpp>
+// uses insecure websockets, proxy handles security with SSL
+#include <websocketpp/config/asio_no_tls.hpp>
+
+// include the header file
+#include "action_shard.h"
+
+// include other server files
+#include "arena.h"
+#include "player.h"
+#include "broadcast.h"
+#include "snapshot.h"
+#include "arena_scheduler.h"
+#include "matchmaker.h"
+#include "shard_placement.h"
+#include "object_pool.h"
+
+// include other dependencies
+#include <string>
+#include <set>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+// connection handler
+using websocketpp::connection_hdl;
+// used to assign callback functions to events
+using websocketpp::lib::bind;
+
+
+// constructor, the shard does nothing until it is started
+Action_Shard::Action_Shard(server& ws_server, Arena_Scheduler& scheduler, Shard_Placement& placement, int shard,
+						   int min_arenas, int pool_arenas, int idle_timeout_s)
+	: m_server(ws_server), m_scheduler(scheduler), m_placement(placement), m_shard(shard),
+	  m_player_id_pool(pool_arenas * Arena::MAX_PLAYERS * 2), m_player_pool(pool_arenas * Arena::MAX_PLAYERS * 2),
+	  m_actions(ACTION_QUEUE_CAPACITY) {
+	// the smallest size of the shard's arena pool, it grows as long as the placement has arenas left
+	this->min_arenas = min_arenas;
+	idle_timeout = chrono::seconds(idle_timeout_s);
+	last_pool_check = chrono::steady_clock::now();
+	stats_interval = chrono::seconds(0);
+	last_stats_log = last_pool_check;
+	
+	// nothing published yet
+	seats_changed = false;
+	connections_taken = 0;
+	
+	// nothing to send yet
+	m_outgoing_ready = false;
+	m_action_loop_waiting = false;
+	m_running = false;
+}
+
+// destructor
+Action_Shard::~Action_Shard() {
+	// empty all data structures, the action queue empties itself
+	stop();
+	
+	// the scheduler has been stopped, or never had the arenas, so none of them can be ticked
+	while (arenas.size() > 0) {
+		Arena* arena = arenas[0];
+		arenas.erase(arenas.begin());
+		// the players that disconnected during its last game have already left the player map
+		arena->clean_up();
+		delete_left_players(arena);
+		delete arena;
+	}
+	
+	for (pair<const connection_hdl, player_id*>& entry : m_player_map) {
+		m_player_pool.destroy(entry.second->player);
+		m_player_id_pool.destroy(entry.second);
+	}
+	
+	m_connections.clear();
+	arena_players_map.clear();
+	m_player_map.clear();
+}
+
+// creates the first arenas and starts the action loop
+void Action_Shard::start() {
+	// arenas are created before the action loop starts, in case of an immediate connection
+	// the pool starts at its minimum size, more arenas are created as players arrive
+	for (int i = 0; (i < min_arenas) && m_placement.take_arena(); i++) {
+		create_arena();
+	}
+	// the placement knows the shard's seats before the first connection
+	publish_seats();
+	
+	m_running = true;
+	m_action_thread = thread(&Action_Shard::process_actions, this);
+}
+
+// stops the action loop, actions still on the queue are thrown away
+void Action_Shard::stop() {
+	m_running = false;
+	
+	if (m_action_thread.joinable()) {
+		{
+			// taking the lock ensures the action loop is either waiting or will see m_running is false
+			websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_action_lock);
+			m_action_condition.notify_one();
+		}
+		m_action_thread.join();
+	}
+}
+
+// adds an action to the action queue, called by the listener callbacks
+void Action_Shard::push_action(action&& a) {
+	// the queue only fills up if the action loop has fallen far behind, wait for it to make room
+	while (!m_actions.try_push(std::move(a))) {
+		this_thread::yield();
+	}
+	
+	wake_action_loop();
+}
+
+// wakes up the action loop, but only takes the lock if the action loop is asleep
+void Action_Shard::wake_action_loop() {
+	// the new action or message must be visible before checking if the action loop is asleep,
+	// matches the fence in process_actions
+	atomic_thread_fence(memory_order_seq_cst);
+	
+	if (m_action_loop_waiting.load()) {
+		// taking the lock ensures the action loop is either waiting or has not checked for work yet
+		websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_action_lock);
+		m_action_condition.notify_one();
+	}
+}
+
+
+/*
+the main event loop of the server
+runs in a separate thread from the event listeners
+sleeps until there is an action to take or a message to send, then sends out all messages in the
+outgoing queues and processes every action that was waiting
+*/
+void Action_Shard::process_actions() {
+	// the action currently being taken
+	action a;
+	
+	while (m_running) {
+		{
+			websocketpp::lib::unique_lock<websocketpp::lib::mutex> lock(m_action_lock);
+			
+			// announce that the action loop is going to sleep, then check one last time for work
+			// matches the fence in wake_action_loop, so a new action is either seen here or wakes the loop
+			m_action_loop_waiting = true;
+			atomic_thread_fence(memory_order_seq_cst);
+			
+			// sleep until a listener queues an action or an arena has something to send
+			// wakes up on its own now and then to look for idle arenas
+			m_action_condition.wait_for(lock, chrono::milliseconds(POOL_CHECK_INTERVAL_MS),
+										[this] { return !m_actions.empty() || m_outgoing_ready || !m_running; });
+			m_action_loop_waiting = false;
+		}
+		
+		if (chrono::steady_clock::now() - last_pool_check >= chrono::milliseconds(POOL_CHECK_INTERVAL_MS)) {
+			shrink_arena_pool();
+		}
+		
+		// the loop wakes up at least once every pool check, so the statistics are at most that late
+		if (stats_callback && (chrono::steady_clock::now() - last_stats_log >= stats_interval)) {
+			last_stats_log = chrono::steady_clock::now();
+			stats_callback();
+		}
+		
+		// each iteration, send all messages before processing any action
+		m_outgoing_ready = false;
+		send_messages();
+		
+		// take the actions that are waiting, at most one queue's worth so messages are not held up
+		int count = 0;
+		while ((count < ACTION_QUEUE_CAPACITY) && m_actions.try_pop(a)) {
+			// handle each type of action
+			if (a.type == CONNECT) {
+				// adds a new player
+				add_connection(a.handler);
+			} else if (a.type == DISCONNECT) {
+				// removes a player
+				remove_connection(a.handler);
+			} else if (a.type == MESSAGE) {
+				// route an incoming message to the appropriate arena
+				process_incoming_message(a.handler, a.message);
+			}
+			
+			// release the message now rather than holding it until the next action
+			a.message.reset();
+			count++;
+		}
+		
+		publish_seats();
+	}
+}
+
+// called by an arena when it has a message to send or is ready to reset
+void Action_Shard::notify_outgoing() {
+	m_outgoing_ready = true;
+	wake_action_loop();
+}
+
+// publishes the arenas on the matchmaker's ready queue, once the actions that changed them are done
+void Action_Shard::publish_seats() {
+	if (!seats_changed) {
+		return;
+	}
+	
+	m_matchmaker.get_open_seats(published_seats);
+	m_placement.publish(m_shard, published_seats, m_matchmaker.get_queue_depth(), connections_taken);
+	seats_changed = false;
+	connections_taken = 0;
+}
+
+// adds the new connection to the list of connections, creates a player, and assigns the player to the arena
+void Action_Shard::add_connection(connection_hdl handler) {
+	// locks the connections list so one can be added
+	{
+		websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_connection_lock);
+		// add the connection handler to the set of connections
+		m_connections.insert(handler);
+	}
+	
+	// create a new player identifier
+	player_id* new_player = m_player_id_pool.create();
+	
+	// add a new player object to the identifier
+	new_player->player = m_player_pool.create();
+	// not in an arena until assigned to one
+	new_player->parent_arena = NULL;
+	new_player->handler = handler;
+	new_player->waiting = false;
+	
+	// the client asks for binary snapshots by requesting a binary subprotocol when it connects
+	new_player->snapshot_version = 0;
+	new_player->has_acked_tick = false;
+	new_player->acked_tick = 0;
+	try {
+		server::connection_ptr con = m_server.get_con_from_hdl(handler);
+		if (con->get_subprotocol() == BINARY_SNAPSHOT_PROTOCOL_1) {
+			new_player->snapshot_version = BINARY_SNAPSHOT_VERSION_1;
+		} else if (con->get_subprotocol() == BINARY_SNAPSHOT_PROTOCOL_2) {
+			new_player->snapshot_version = BINARY_SNAPSHOT_VERSION_2;
+		}
+	} catch (exception e) {
+		// the connection has already closed, its disconnect action will follow
+	}
+	
+	// add the connection handler and the player identifier to the map of players
+	m_player_map.insert(pair<connection_hdl, player_id*>(handler, new_player));
+	
+	// assign the player to an arena, fills the parent_arena field in the player identifier
+	// the player waits on the matchmaker's queue if every arena is busy
+	assign_to_arena(new_player);
+	
+	// the placement promised the connection a seat, it is taken now
+	seats_changed = true;
+	connections_taken++;
+}
+
+// removes the connection from the list of connections
+void Action_Shard::remove_connection(connection_hdl handler) {
+	// locks the connections list so one can be removed
+	{
+		websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_connection_lock);
+		// remove a connection from the list
+		m_connections.erase(handler);
+	}
+	
+	// find the player, it is no longer routed to
+	map<connection_hdl, player_id*, owner_less<connection_hdl>>::iterator itr = m_player_map.find(handler);
+	if (itr == m_player_map.end()) {
+		return;
+	}
+	player_id* leaver = itr->second;
+	m_player_map.erase(itr);
+	
+	if (leaver->parent_arena != NULL) {
+		arena_players_map[leaver->parent_arena].erase(handler);
+	}
+	
+	// a player still waiting for an arena gives up its place in the queue, and one in a lobby gives up
+	// its seat, which goes to the player that has waited longest
+	vector<player_id*> placed;
+	bool released = m_matchmaker.leave(leaver, placed, chrono::steady_clock::now());
+	for (player_id* placed_player : placed) {
+		add_to_arena_connections(placed_player);
+	}
+	seats_changed = true;
+	
+	// deletes the player, unless its arena is in a game, which hands the player back after its next frame
+	if (released) {
+		m_player_pool.destroy(leaver->player);
+	}
+	m_player_id_pool.destroy(leaver);
+}
+
+// receives a new message and sends the message to the arena
+void Action_Shard::process_incoming_message(connection_hdl handler, server::message_ptr message) {
+	// find the player that sent the message, based on player's connection handler
+	map<connection_hdl, player_id*, owner_less<connection_hdl>>::iterator itr = m_player_map.find(handler);
+	if (itr == m_player_map.end()) {
+		return;
+	}
+	player_id* sender = itr->second;
+	
+	// players waiting for an arena, or whose game has ended, have nowhere to send input
+	if (sender->parent_arena == NULL) {
+		return;
+	}
+	
+	// clients receiving deltas acknowledge the latest snapshot they have received with each input message
+	if (sender->snapshot_version == BINARY_SNAPSHOT_VERSION_2) {
+		uint32_t tick;
+		if (read_acked_tick(message->get_payload(), tick)) {
+			sender->acked_tick = tick;
+			sender->has_acked_tick = true;
+		}
+	}
+	
+	// the arena decodes the message and adds it to its message queue
+	// the arena's queue has a single producer, this thread, so no lock is needed
+	sender->parent_arena->add_to_incoming_queue(sender->player, message->get_payload());
+}
+
+
+// sends a message from the arena to all members of the arena
+void Action_Shard::send_messages() {
+	for (Arena* arena : arenas) {
+		// delete the players that disconnected during a game, now that the arena has let go of them
+		delete_left_players(arena);
+		
+		// check if the arena's game has finished and needs to be reset
+		// exists here because the arena's connection list cannot be accessed from static method
+		if (arena->ready_to_reset) {
+			reset_arena(arena);
+			continue;
+		}
+		
+		// take every message in the outgoing queue at once, then release the lock before sending
+		// the shard's vector is empty and keeps its memory, so the swap does not allocate
+		arena->lock_mutex();
+		swap(outgoing_snapshots, arena->outgoing_queue);
+		arena->unlock_mutex();
+		
+		Snapshot_History& history = snapshot_histories[arena];
+		
+		// send all messages in the queue, oldest first
+		for (snapshot_struct& snapshot : outgoing_snapshots) {
+			
+			// each format is framed once, the first time a player needs it,
+			// and every connection that uses that format is sent the same buffer
+			server::message_ptr text_message;
+			server::message_ptr v1_message;
+			server::message_ptr keyframe_message;
+			// deltas are shared by every player that has acknowledged the same baseline
+			map<uint32_t, server::message_ptr> delta_messages;
+			
+			// send message to all connections in the arena
+			for (connection_hdl handler : arena_players_map[arena]) {
+				player_id* receiver = m_player_map[handler];
+				server::message_ptr message;
+				
+				if (receiver->snapshot_version == BINARY_SNAPSHOT_VERSION_2) {
+					// use a delta if the player's last acknowledged snapshot is still in the history
+					const snapshot_state* baseline = NULL;
+					if (receiver->has_acked_tick) {
+						baseline = history.find(receiver->acked_tick);
+					}
+					
+					if (baseline != NULL) {
+						server::message_ptr& delta_message = delta_messages[baseline->tick];
+						if (!delta_message) {
+							string binary;
+							write_delta(snapshot.state, *baseline, binary);
+							delta_message = frame_broadcast_message(std::move(binary), websocketpp::frame::opcode::binary);
+						}
+						message = delta_message;
+					} else {
+						// the baseline is too old or there is none yet, send the whole snapshot
+						if (!keyframe_message) {
+							string binary;
+							write_keyframe(snapshot.state, binary);
+							keyframe_message = frame_broadcast_message(std::move(binary), websocketpp::frame::opcode::binary);
+						}
+						message = keyframe_message;
+					}
+				} else if (receiver->snapshot_version == BINARY_SNAPSHOT_VERSION_1) {
+					if (!v1_message) {
+						string binary;
+						write_snapshot_v1(snapshot.state, binary);
+						v1_message = frame_broadcast_message(std::move(binary), websocketpp::frame::opcode::binary);
+					}
+					message = v1_message;
+				} else {
+					if (!text_message) {
+						// the frame gets its own copy, the snapshot's text buffer goes back to the arena
+						text_message = frame_broadcast_message(string(snapshot.text),
+															   websocketpp::frame::opcode::text);
+					}
+					message = text_message;
+				}
+				
+				try {
+					// queues the shared frame on the player's connection without copying it
+					m_server.send(handler, message);
+				} catch (exception e) {
+					// error sending message
+				}
+			}
+			
+			// later snapshots can be sent as deltas against this one
+			history.add(snapshot.state);
+		}
+		
+		// the arena builds its next messages in the buffers of these ones
+		arena->recycle_snapshots(outgoing_snapshots);
+	}
+}
+
+
+// adds a new player to the arena at the front of the matchmaker's ready queue
+void Action_Shard::assign_to_arena(player_id* new_player) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	
+	if (m_matchmaker.join(new_player, now)) {
+		add_to_arena_connections(new_player);
+		return;
+	}
+	
+	// every arena is full or in a game, grow the pool if it is not at its maximum
+	// the new arena takes the waiting players, this one included
+	if (m_placement.take_arena()) {
+		create_arena();
+	}
+	
+	// otherwise the player waits until an arena is reset
+}
+
+// adds the players the matchmaker has placed to the connection lists of their arenas
+void Action_Shard::add_to_arena_connections(player_id* placed_player) {
+	// locks the connections list so one can be added
+	websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_connection_lock);
+	// add the connection handler to the set of connections
+	arena_players_map[placed_player->parent_arena].insert(placed_player->handler);
+}
+
+// creates an arena and hands it to the scheduler
+Arena* Action_Shard::create_arena() {
+	Arena* arena = new Arena();
+	// the arena wakes up the action loop whenever it has a message to send
+	arena->set_outgoing_callback(bind(&Action_Shard::notify_outgoing, this));
+	
+	connection_list arena_connections;
+	arena_players_map.insert(pair<Arena*, connection_list>(arena, arena_connections));
+	snapshot_histories[arena];
+	arenas.push_back(arena);
+	
+	// the arena parks in its lobby until a player joins
+	m_scheduler.add(arena);
+	
+	// players waiting for an arena are placed in the new one
+	open_arena(arena);
+	return arena;
+}
+
+// puts an arena that is ready for players on the matchmaker's ready queue
+void Action_Shard::open_arena(Arena* arena) {
+	vector<player_id*> placed;
+	m_matchmaker.open_arena(arena, placed, chrono::steady_clock::now());
+	
+	for (player_id* placed_player : placed) {
+		add_to_arena_connections(placed_player);
+	}
+	seats_changed = true;
+}
+
+// shuts down extra arenas that have had no players for a while
+void Action_Shard::shrink_arena_pool() {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	last_pool_check = now;
+	
+	// track how long each arena has been empty
+	for (Arena* arena : arenas) {
+		if (arena_players_map[arena].empty()) {
+			// only inserted the first time the arena is seen empty
+			arena_idle_since.insert(pair<Arena*, chrono::steady_clock::time_point>(arena, now));
+		} else {
+			arena_idle_since.erase(arena);
+		}
+	}
+	
+	// start from the newest arenas, the oldest ones are filled first so they are kept
+	for (int i = arenas.size() - 1; (i >= 0) && ((int) arenas.size() > min_arenas); i--) {
+		Arena* arena = arenas[i];
+		
+		map<Arena*, chrono::steady_clock::time_point>::iterator idle = arena_idle_since.find(arena);
+		if ((idle == arena_idle_since.end()) || (now - idle->second < idle_timeout)) {
+			continue;
+		}
+		
+		// an arena still running a game, or being reset, is left until it is back in its lobby
+		if (arena->stop()) {
+			retire_arena(arena);
+		}
+	}
+}
+
+// removes a stopped arena from the pool and deletes it
+void Action_Shard::retire_arena(Arena* arena) {
+	// waits for a worker that is ticking the arena, it is never ticked again
+	m_scheduler.remove(arena);
+	m_matchmaker.close_arena(arena);
+	
+	arenas.erase(find(arenas.begin(), arenas.end(), arena));
+	{
+		websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_connection_lock);
+		arena_players_map.erase(arena);
+	}
+	snapshot_histories.erase(arena);
+	arena_idle_since.erase(arena);
+	
+	delete_left_players(arena);
+	delete arena;
+	
+	// another shard can create the arena instead
+	m_placement.give_back_arena();
+	seats_changed = true;
+}
+
+// deletes the players that disconnected during a game once the arena has let go of them
+void Action_Shard::delete_left_players(Arena* arena) {
+	arena->take_left_players(left_players);
+	for (Player* player : left_players) {
+		m_player_pool.destroy(player);
+	}
+	left_players.clear();
+}
+
+// prepares the arena for a new game
+// clears the connection list for the arena
+void Action_Shard::reset_arena(Arena* arena) {
+	// the players of the last game no longer belong to the arena
+	for (connection_hdl handler : arena_players_map[arena]) {
+		map<connection_hdl, player_id*, owner_less<connection_hdl>>::iterator itr = m_player_map.find(handler);
+		if (itr != m_player_map.end()) {
+			itr->second->parent_arena = NULL;
+		}
+	}
+	
+	// removes each connection from the arena
+	arena_players_map[arena].clear();
+	
+	// the arena can now accept new players, starting with any that are waiting
+	arena->finish_reset();
+	open_arena(arena);
+}
+
+// statistics for the shard's matchmaker, safe to call from any thread
+matchmaking_stats Action_Shard::get_matchmaking_stats() {
+	return m_matchmaker.get_stats();
+}
+
+// sets the function the action loop calls to log the statistics
+void Action_Shard::set_stats_callback(function<void()> callback, int interval_s) {
+	stats_callback = callback;
+	stats_interval = chrono::seconds(interval_s);
+}
+
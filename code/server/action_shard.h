@@ -0,0 +1,222 @@
+/*
+Action shard class header file
+
+Chaos The Game
+
+A shard owns a group of arenas and every connection playing in them. Its action loop, running on
+a thread of its own, adds and removes the shard's players, routes their input to their arenas,
+and sends the arenas' snapshots to them. Nothing a shard owns is touched by another shard, so the
+shards run side by side without sharing any locks. The shard placement (see shard_placement.h)
+picks the shard of each connection when it connects, from the seats every shard publishes, and a
+shard takes its arenas from the pool's maximum that all of them share.
+*/
+
+#ifndef ACTION_SHARD_H
+#define ACTION_SHARD_H
+
+// this project uses the websocketpp library to handle WebSocket communication
+#include <websocketpp/server.hpp>
+// uses insecure websockets, proxy handles security with SSL
+#include <websocketpp/config/asio_no_tls.hpp>
+
+// include other server files
+#include "arena.h"
+#include "player.h"
+#include "mpsc_queue.h"
+#include "snapshot.h"
+#include "arena_scheduler.h"
+#include "matchmaker.h"
+#include "shard_placement.h"
+#include "object_pool.h"
+
+// include other dependencies
+#include <string>
+#include <set>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
+
+using namespace std;
+
+// connection handler
+using websocketpp::connection_hdl;
+
+// defines the server type used by websocketpp
+typedef websocketpp::server<websocketpp::config::asio> server;
+// defines the type of the set of connections
+typedef set<connection_hdl, owner_less<connection_hdl>> connection_list;
+
+
+// the different types of actions the server can perform
+enum action_type {
+	CONNECT,
+	DISCONNECT,
+	MESSAGE
+};
+
+/*
+A struct for an individual action that the server can take
+Constructors only initialize values
+*/
+struct action {
+	// empty action, filled in when an action is popped off the action queue
+	action() : type(MESSAGE) {}
+	// constructor for connect and disconnect actions
+	action(action_type t, connection_hdl h) : type(t), handler(h) {}
+	// constructor for incoming and outgoing messages
+	action(action_type t, connection_hdl h, server::message_ptr m)
+		: type(t), handler(h), message(m) {}
+
+	// the action to be taken
+	action_type type;
+	// the unique identifier of the player to communicate with
+	connection_hdl handler;
+	// the message, if it is a message action
+	server::message_ptr message;
+
+	// actions are moved through the action queue, never copied
+	action(const action&) = delete;
+	action& operator=(const action&) = delete;
+	action(action&&) = default;
+	action& operator=(action&&) = default;
+};
+
+
+class Action_Shard {
+
+public:
+	// the shard keeps min_arenas arenas and takes more from the placement's pool as players arrive
+	// its object pools have room for pool_arenas full arenas, more players are allocated normally
+	Action_Shard(server& ws_server, Arena_Scheduler& scheduler, Shard_Placement& placement, int shard, int min_arenas,
+				 int pool_arenas, int idle_timeout_s);
+	~Action_Shard();
+
+	// creates the shard's first arenas and starts its action loop
+	void start();
+	// stops the action loop and waits for it to finish
+	void stop();
+
+	// queues an action from a listener callback, safe to call from any thread
+	void push_action(action&& a);
+	
+	// statistics for the shard's matchmaker, safe to call from any thread
+	matchmaking_stats get_matchmaking_stats();
+	// sets a function the action loop calls every interval_s seconds, used to log the server's statistics
+	// must be set before the shard is started
+	void set_stats_callback(function<void()> callback, int interval_s);
+
+private:
+	// action loop, runs in its own thread
+	void process_actions();
+	// wakes up the action loop when an arena has a message to send or is ready to reset
+	void notify_outgoing();
+	// wakes up the action loop if it is asleep
+	void wake_action_loop();
+	// tells the placement which of the shard's arenas have seats, if they have changed
+	void publish_seats();
+
+	// add a player to the list of connections and add to an arena
+	void add_connection(connection_hdl handler);
+	// remove a player from the list of connections
+	void remove_connection(connection_hdl handler);
+	// route received messages to the arena
+	void process_incoming_message(connection_hdl handler, server::message_ptr message);
+	// send messages that have been added to the arena's outgoing message queue
+	void send_messages();
+
+	// assigns a new player to an arena, or has it wait for one
+	void assign_to_arena(player_id* new_player);
+	// adds a player that has been placed in an arena to the arena's connection list
+	void add_to_arena_connections(player_id* placed_player);
+	// creates an arena, adds it to the pool, and hands it to the scheduler
+	Arena* create_arena();
+	// offers an arena that has been created or reset to the matchmaker, which fills it with waiting players
+	void open_arena(Arena* arena);
+	// shuts down arenas above the minimum that have been empty for longer than the idle timeout
+	void shrink_arena_pool();
+	// removes a stopped arena from the pool and the scheduler, and deletes it
+	void retire_arena(Arena* arena);
+	// deletes the players that disconnected during a game, once their arena has handed them back
+	void delete_left_players(Arena* arena);
+	// after an arena's game has terminated, reset the arena to prepare for a new game
+	void reset_arena(Arena* arena);
+
+	// the websocketpp server shared by every shard, used to send messages and look up connections
+	server& m_server;
+	// runs the ticks of every arena, shared by every shard
+	Arena_Scheduler& m_scheduler;
+	// picks the shard of each new connection, shared by every shard, and the shard's index in it
+	Shard_Placement& m_placement;
+	int m_shard;
+	// set when the shard's seats may have changed since it last published them, and the new
+	// connections taken since then
+	bool seats_changed;
+	int connections_taken;
+	// the seats last published, keeps its memory between publishes
+	vector<open_seats> published_seats;
+
+	// the list of all of the shard's open connections
+	connection_list m_connections;
+	// the shard's arena pool grows from min_arenas for as long as the placement has arenas left,
+	// and arenas above the minimum are shut down after being empty for idle_timeout
+	int min_arenas;
+	chrono::seconds idle_timeout;
+	// how often (milliseconds) the action loop checks for idle arenas, even with nothing else to do
+	static constexpr int POOL_CHECK_INTERVAL_MS = 1000;
+	// the last time the action loop checked for idle arenas
+	chrono::steady_clock::time_point last_pool_check;
+	// called by the action loop every stats_interval, if it is set, and the last time it was called
+	function<void()> stats_callback;
+	chrono::seconds stats_interval;
+	chrono::steady_clock::time_point last_stats_log;
+	// the arenas in the pool, in the order they are filled
+	// only accessed by the action loop once the shard has started
+	vector<Arena*> arenas;
+	// when each empty arena was first seen empty
+	map<Arena*, chrono::steady_clock::time_point> arena_idle_since;
+	// a map of arenas to the players in the arena
+	map<Arena*, connection_list> arena_players_map;
+	// a map of arenas to the snapshots they have recently sent, used to build deltas
+	map<Arena*, Snapshot_History> snapshot_histories;
+	// the messages of the arena being sent, swapped out of its outgoing queue and handed back
+	// empty, only accessed by the action loop
+	vector<snapshot_struct> outgoing_snapshots;
+	// players that disconnected during a game, handed back by their arenas once they are out of it
+	vector<Player*> left_players;
+	// places new players in arenas, and holds players that arrive when every arena is busy
+	Matchmaker m_matchmaker;
+	// the player identifiers and players of the shard's connections are created in these pools,
+	// with room for every arena to be full and as many players again waiting
+	Object_Pool<player_id> m_player_id_pool;
+	Object_Pool<Player> m_player_pool;
+	// a map of connection identifiers to a struct containing players and their arena
+	// allows an incoming message to be efficiently routed to the appropriate arena
+	map<connection_hdl, player_id*, owner_less<connection_hdl>> m_player_map;
+
+	// the number of actions that can be waiting before the listeners have to wait for the action loop
+	static const int ACTION_QUEUE_CAPACITY = 65536;
+	// action queue, added to by listeners and processed by action loop
+	// lock-free, the listeners never wait on the action loop or each other to push an action
+	MPSC_Queue<action> m_actions;
+	// only used for the action loop to sleep on, not for accessing the action queue
+	websocketpp::lib::mutex m_action_lock;
+	// signalled when an action is queued or an arena has something to send, wakes up the action loop
+	websocketpp::lib::condition_variable m_action_condition;
+	// set while the action loop is asleep or about to go to sleep, only then does it need to be woken up
+	atomic<bool> m_action_loop_waiting;
+	// set when an arena has added to its outgoing queue since the action loop last sent messages
+	atomic<bool> m_outgoing_ready;
+	// cleared to make the action loop exit
+	atomic<bool> m_running;
+	// used for locking access to the connection list
+	websocketpp::lib::mutex m_connection_lock;
+	// runs the action loop
+	thread m_action_thread;
+
+};
+
+#endif
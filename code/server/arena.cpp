@@ -20,6 +20,11 @@ single game instance.
 #include "wall.h"
 #include "wall_manager.h"
 #include "bomb.h"
+#include "frame_scheduler.h"
+#include "snapshot.h"
+#include "text_writer.h"
+#include "input_parser.h"
+#include "rotation_table.h"
 
 // include other dependencies
 #include <iostream>
@@ -27,28 +32,44 @@ single game instance.
 #include <mutex>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <functional>
 #include <cmath>
+#include <algorithm>
 // used for random number generation
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
-// include boost string splitter
-#include <boost/algorithm/string.hpp>
-
 using namespace std;
 
 // the colors that will be assigned to the players
 const string Arena::color_list[] = {"blue", "green", "purple", "orange"};
+const string Arena::BOMB_PLACEHOLDER = "=====,";
+const chrono::steady_clock::time_point Arena::PARKED = chrono::steady_clock::time_point::max();
 
 
 // constructor
-Arena::Arena() {
+Arena::Arena()
+	: incoming_queue(INCOMING_QUEUE_CAPACITY), frame_scheduler(FRAME_TIME_MS), projectiles(SCREEN_WIDTH, SCREEN_HEIGHT),
+	  wall_grid(SCREEN_WIDTH, SCREEN_HEIGHT, GRID_CELL_SIZE), player_grid(SCREEN_WIDTH, SCREEN_HEIGHT, GRID_CELL_SIZE),
+	  bomb_grid(SCREEN_WIDTH, SCREEN_HEIGHT, GRID_CELL_SIZE), projectile_grid(SCREEN_WIDTH, SCREEN_HEIGHT, GRID_CELL_SIZE),
+	  contact_batch(SCREEN_WIDTH, SCREEN_HEIGHT) {
+	for (int i = 0; i < MAX_PLAYERS; i++) {
+		player_slots[i] = NULL;
+	}
+
 	num_players = 0;
 	accepting_players = true;
 	ready_to_start = false;
-	color_index = 0;
+	stopped = false;
+	state = LOBBY;
+	lobby_deadline_set = false;
+	frame_bodies.rebuilt = 0;
+	frame_bodies.reused = 0;
 	ready_to_reset = false;
+	snapshot_tick = 0;
+	rejected_messages = 0;
 }
 
 // destructor
@@ -59,25 +80,38 @@ Arena::~Arena() {
 
 // attempt to add a player to the arena, returns true if successful
 bool Arena::add_player(Player* player) {
-	// lock the arena lock to add a player to set
-	lock_guard<mutex> guard(arena_lock);
-	
-	// check if the arena has stopped accepting players
-	if (!accepting_players) {
-		return false;
+	{
+		// lock the arena lock to add a player to set
+		lock_guard<mutex> guard(arena_lock);
+		
+		// check if the arena has stopped accepting players
+		if (!accepting_players) {
+			return false;
+		}
+		
+		// game is still accepting players, add player to set and check for start condition
+		arena_players.insert(player);
+		num_players++;
+		
+		// give the player the first free slot, used to identify the player in input messages,
+		// and the color that goes with it, a player that left the lobby frees its slot
+		int slot = 0;
+		while (player_slots[slot] != NULL) {
+			slot++;
+		}
+		player->color = color_list[slot];
+		player->slot = slot;
+		player_slots[slot] = player;
+		
+		// check if the arena should be closed off to new players
+		if (num_players >= MAX_PLAYERS) {
+			accepting_players = false;
+		}
 	}
 	
-	// game is still accepting players, add player to set and check for start condition
-	arena_players.insert(player);
-	num_players++;
-	
-	// assign the player the next color in the list and increment the index
-	player->color = color_list[color_index];
-	color_index++;
-	
-	// check if the arena should be closed off to new players
-	if (num_players >= MAX_PLAYERS) {
-		accepting_players = false;
+	// tick the lobby so it can check if the game is ready to begin
+	if (wake_callback) {
+		wake_callback();
 	}
 	
 	// if the function reaches this point, the addition was successful
@@ -85,75 +119,191 @@ bool Arena::add_player(Player* player) {
 }
 
 // remove a player who has disconnected
-void Arena::remove_player(Player* player) {
-	// try to erase from each set (alive and dead)
-	arena_players.erase(player);
+bool Arena::remove_player(Player* player, bool& seat_freed) {
+	// lock the arena lock, a worker may be starting or running a game with the player in it
+	lock_guard<mutex> guard(arena_lock);
+	seat_freed = false;
+	
+	// stop routing the player's queued input messages to it
+	if ((player->slot >= 0) && (player_slots[player->slot] == player)) {
+		player_slots[player->slot] = NULL;
+	}
+	
+	// the frame being run may be using the player, it is dropped before the next one
+	if (ready_to_start) {
+		leaving_players.push_back(player);
+		return false;
+	}
+	
+	// in the lobby, or after the game has been cleaned up, nothing else uses the sets
+	// a player leaving the lobby gives its seat back
+	if (arena_players.erase(player) > 0) {
+		num_players--;
+		accepting_players = true;
+		seat_freed = true;
+		// the wait for more players starts again with the next player
+		if (num_players == 0) {
+			lobby_deadline_set = false;
+		}
+	}
 	dead_players.erase(player);
+	return true;
 }
 
-// add a new message from the server to the queue of messages to be processed
-void Arena::add_to_incoming_queue(message_struct* new_message) {
-	// lock the arena to add to the queue
+// hand the players the arena no longer uses back to the gameserver
+void Arena::take_left_players(vector<Player*>& left) {
 	lock_guard<mutex> guard(arena_lock);
-	// push the message to the queue
-	incoming_queue.push(new_message);
+	left.insert(left.end(), left_players.begin(), left_players.end());
+	left_players.clear();
 }
 
-// add a new message produced by the arena to the queue to be sent
-void Arena::add_to_outgoing_queue(string message) {
-	// lock the arena to add to the queue
+// drop the players that disconnected during the last frame
+void Arena::drop_leaving_players() {
 	lock_guard<mutex> guard(arena_lock);
-	// push the message to the queue
-	outgoing_queue.push(message);
+	for (Player* player : leaving_players) {
+		// try to erase from each set (alive and dead)
+		arena_players.erase(player);
+		dead_players.erase(player);
+		num_players--;
+		left_players.push_back(player);
+	}
+	leaving_players.clear();
 }
 
-// runs the processes to get the game ready to start, then runs the game loop
-void Arena::start() {
-	// when the arena is restarted, signal that it should not be reset again by gameserver
-	ready_to_reset = false;
+// decode a new message from the server and add it to the queue of messages to be processed
+// only called from the gameserver's action thread, the single producer for the incoming queue
+void Arena::add_to_incoming_queue(Player* player, const string& message_text) {
+	// only players currently in the arena can send input
+	if ((player->slot < 0) || (player_slots[player->slot] != player)) {
+		return;
+	}
 	
-	// sets a timer for how long the arena can be waiting for players without starting
-	// after a certain amount of time has passed, the arena will start partially full
-	chrono::time_point<chrono::system_clock> start, current;
-	// sets the starting point of the timer
-	start = chrono::system_clock::now();
-	// the total elapsed time since the timer started
-	chrono::duration<double> elapsed_seconds;
+	message_struct msg;
+	msg.player_slot = player->slot;
 	
-	// the amount of time (seconds) to wait after creation before the arena starts partially filled
-	double waiting_limit = 40.0;
+	// malformed messages are counted and dropped
+	if (!parse_input_message(message_text, msg)) {
+		rejected_messages.fetch_add(1, memory_order_relaxed);
+		return;
+	}
 	
-	// runs until the game is ready to start
-	while (!ready_to_start) {
-		// check if the arena has filled up
-		if (num_players >= MAX_PLAYERS) {
-			ready_to_start = true;
+	// if the arena has fallen so far behind that the queue is full, drop the message
+	incoming_queue.try_push(msg);
+}
+
+// add a new message produced by the arena to the queue to be sent
+void Arena::add_to_outgoing_queue(snapshot_struct snapshot) {
+	{
+		// lock the arena to add to the queue
+		lock_guard<mutex> guard(arena_lock);
+		// push the message to the queue
+		outgoing_queue.push_back(std::move(snapshot));
+	}
+	
+	// let the gameserver know there is a message to send
+	if (outgoing_callback) {
+		outgoing_callback();
+	}
+}
+
+// keep the buffers of the sent snapshots for the next messages
+void Arena::recycle_snapshots(vector<snapshot_struct>& sent) {
+	lock_guard<mutex> guard(arena_lock);
+	for (snapshot_struct& snapshot : sent) {
+		spare_snapshots.push_back(std::move(snapshot));
+	}
+	sent.clear();
+}
+
+// sets the function called whenever there is something new for the gameserver to send or reset
+void Arena::set_outgoing_callback(function<void()> callback) {
+	outgoing_callback = callback;
+}
+
+// sets the function called when a parked arena has something to do
+void Arena::set_wake_callback(function<void()> callback) {
+	wake_callback = callback;
+}
+
+// moves the arena through its lobby, game, and reset, one step at a time
+chrono::steady_clock::time_point Arena::tick(chrono::steady_clock::time_point now) {
+	if (state == PLAYING) {
+		// woken up early, the next frame is not due yet
+		if (now < frame_scheduler.next_deadline()) {
+			return frame_scheduler.next_deadline();
+		}
+		
+		frame_scheduler.begin_frame(now);
+		run_frame();
+		
+		// check for a winner
+		if (arena_players.size() > 1) {
+			return frame_scheduler.next_deadline();
 		}
 		
-		// get the current time and find the total elapsed time
-		current = chrono::system_clock::now();
-		elapsed_seconds = current - start;
-		// check if the timer has exceeded the waiting limit
-		if (elapsed_seconds.count() > waiting_limit) {
-			ready_to_start = true;
+		// free used memory, the gameserver resets the arena and wakes it up again
+		clean_up();
+		state = RESETTING;
+		return PARKED;
+	}
+	
+	unique_lock<mutex> lock(arena_lock);
+	
+	if (stopped) {
+		state = STOPPED;
+		return PARKED;
+	}
+	
+	// wait for the gameserver to clear the connections of the last game before opening the arena
+	if (state == RESETTING) {
+		if (ready_to_reset) {
+			return PARKED;
 		}
+		state = LOBBY;
+		lobby_deadline_set = false;
+	}
+	
+	// an empty arena waits until its first player arrives, without a time limit
+	if (num_players == 0) {
+		return PARKED;
+	}
+	
+	// after a certain amount of time has passed since the first player joined,
+	// the arena will start partially full
+	if (!lobby_deadline_set) {
+		lobby_deadline = now + chrono::seconds(WAITING_LIMIT);
+		lobby_deadline_set = true;
+	}
+	
+	// woken up again by add_player, waits until the arena has filled up or the deadline has passed
+	if ((num_players < MAX_PLAYERS) && (now < lobby_deadline)) {
+		return lobby_deadline;
 	}
 	
 	// signal that the arena is no longer accepting players, in case it wasn't already set
+	ready_to_start = true;
 	accepting_players = false;
 	
-	// get everything set up
-	setup();
+	// the game handles its own locking
+	lock.unlock();
 	
-	// the game is ready to start, call the game loop
-	game_loop();
+	// get everything set up, the first frame runs one frame from now
+	setup();
+	frame_scheduler.start(now);
+	state = PLAYING;
 	
-	// free used memory and be prepared to restart the arena
-	clean_up();
+	return frame_scheduler.next_deadline();
 }
 
 // handles everything that needs to happen before the game can start
 void Arena::setup() {
+	// drop any messages sent to the arena before the game started,
+	// including any from the last game that arrived after it was cleaned up
+	message_struct msg;
+	while (incoming_queue.try_pop(msg)) {
+		// nothing to do, the message is dropped
+	}
+	
 	// give every player a starting position
 	init_player_positions();
 	
@@ -168,71 +318,31 @@ void Arena::setup() {
 }
 
 
-// the main loop for the game, handles everything that relates to the game
-void Arena::game_loop() {
-	// exit condition
-	bool end_game = false;
+// one frame of the game, handles everything that relates to the game
+void Arena::run_frame() {
+	// players that have disconnected are no longer in the game
+	drop_leaving_players();
 	
-	// regulate frames per second by waiting at the end of the loop until enough time has passed
-	// create a time point for the starting time of each frame and one to check if enough time has passed
-	chrono::time_point<chrono::system_clock> start, current;
-	// sets the starting point of the timer
-	start = chrono::system_clock::now();
-	// the time duration to be used as the stopwatch for each frame
-	chrono::duration<double> elapsed_seconds;
+	// iterate through each message and update the player's velocity
+	process_messages();
 	
-	// desired time (in milliseconds) of each frame
-	int frame_time_ms = 25;
-	// desired time (in seconds) of each frame
-	double frame_time = (double) frame_time_ms / 1000;
+	/*
+	handle all game related activity
+	*/
 	
+	// move each player according to its velocity
+	update_player_positions();
+	// move each projectile according to its velocity
+	update_projectiles();
+	// update the walls
+	update_walls();
+	// update the bombs, everything can be done by the bomb manager
+	bomb_manager.update_bombs();
 	
-	// the game loop
-	while (!end_game) {
-		// iterate through each message and update the player's velocity
-		process_messages();
-		
-		/*
-		handle all game related activity
-		*/
-		
-		// move each player according to its velocity
-		update_player_positions();
-		// move each projectile according to its velocity
-		update_projectiles();
-		// update the walls
-		update_walls();
-		// update the bombs, everything can be done by the bomb manager
-		bomb_manager.update_bombs();
-		
-		// compile all relevant data into a string message and push it to the outgoing queue
-		send_message();
-		
-		
-		/*
-		regulate the frame rate
-		*/
-		
-		// get the current time and find how much time has passed since the start of the frame
-		current = chrono::system_clock::now();
-		elapsed_seconds = start - current;
-		
-		// continuously update the elapsed time until it reaches the target time
-		while (elapsed_seconds.count() < frame_time) {
-			current = chrono::system_clock::now();
-			elapsed_seconds = current - start;
-		}
-		
-		// update the start time to when the next frame should start
-		// will always slightly overshoot the target time, this compensates for that
-		start += chrono::milliseconds(frame_time_ms);
-		
-		// check for a winner
-		if (arena_players.size() <= 1) {
-			end_game = true;
-		}
-	}
+	// compile all relevant data into a string message and push it to the outgoing queue
+	send_message();
 	
+	frame_bodies = count_bodies();
 }
 
 // gives every player a starting position from a preset list of positions
@@ -254,266 +364,407 @@ void Arena::init_player_positions() {
 	for (Player* player : arena_players) {
 		player->posX = starting_positions[count].x;
 		player->posY = starting_positions[count].y;
+		// the collision body starts where the player does, other players check against it before it first moves
+		player->reset_temp_vars();
+		player->update_rectangle_points();
 		count++;
 		continue;
 	}
 }
 
 // go through the queue of messages and take the actions associated with each message
+// only called from the arena thread, the single consumer for the incoming queue, so no lock is needed
 void Arena::process_messages() {
-	lock_guard<mutex> guard(arena_lock);
+	message_struct msg;
+	
 	// process messages until there are no more in the queue
-	while (!incoming_queue.empty()) {
-		// pop the top message off tthe queue
-		message_struct* msg = incoming_queue.front();
-		incoming_queue.pop();
-		
-		// the container to be used for the pieces of data in the message
-		vector<string> data;
-		// split the message at each comma to obtain individual values to be used
-		boost::split(data, msg->message_text, boost::is_any_of(","));
+	while (incoming_queue.try_pop(msg)) {
+		// find the player who sent the message, skip it if they have since disconnected
+		Player* player = player_slots[msg.player_slot];
+		if (player == NULL) {
+			continue;
+		}
 		
 		// set the velocity for the player according to the message data
+		player->rotationVel = msg.rotationVel;
+		player->vel = msg.vel;
+		
 		// set the shooting status for the player
-		try {
-			msg->player->rotationVel = stoi(data[0]);
-			msg->player->vel = stoi(data[1]);
-			
-			bool space_pressed;
-			if (stoi(data[2]) == 1) {
-				space_pressed = true;
-			} else {
-				space_pressed = false;
-			}
-			if (space_pressed && msg->player->ready_to_shoot) {
-				msg->player->shoot_projectile = true;
-				msg->player->ready_to_shoot = false;
-			} else if (space_pressed) {
-				msg->player->shoot_projectile = false;
-			} else if (!space_pressed) {
-				msg->player->shoot_projectile = false;
-				msg->player->ready_to_shoot = true;
-			}
-		} catch (exception e) {
-			// catch errors but do nothing about them
+		bool space_pressed = msg.fire;
+		if (space_pressed && player->ready_to_shoot) {
+			player->shoot_projectile = true;
+			player->ready_to_shoot = false;
+		} else if (space_pressed) {
+			player->shoot_projectile = false;
+		} else if (!space_pressed) {
+			player->shoot_projectile = false;
+			player->ready_to_shoot = true;
 		}
-		
-		// delete the message struct and free the memory
-		msg->player = NULL;
-		delete msg;
 	}
 }
 
-// update the position of each player according to its velocity, as long as the move is valid
+/*
+update the position of each player according to its velocity, as long as the move is valid
+a player moves a pixel and turns a degree at a time, MOVEMENT_PER_FRAME times, it stops at the pose
+before the first one that collides with the boundary, another player or a wall, and is killed at
+the first one that touches a bomb
+the other players and the wall and bomb grids are looked through once for the area every pose
+could cover, and a pose is only checked against the objects whose boxes reach it, so most poses need
+no collision checks at all, and each pose is only worked out once the poses before it are free
+*/
 void Arena::update_player_positions() {
-	for (Player* player : arena_players) {
-		// separate the movement into 5 movements by a single pixel, check for a collision each time
-		int i = 0;
-		bool collision = false;
-		bool delete_player = false;
+	// the walls and bombs stay where they are while the players move
+	// their grids are filled the first time they are needed, most moves end at the edge of the field or at another player
+	bool wall_grid_ready = false;
+	bool bomb_grid_ready = false;
+	
+	// the poses the player has been through, the one before the first collision is kept
+	double pose_x[MOVEMENT_PER_FRAME];
+	double pose_y[MOVEMENT_PER_FRAME];
+	int pose_rotation[MOVEMENT_PER_FRAME];
+	
+	// iterate manually so that a player killed by a bomb can be erased without invalidating the loop
+	set<Player*>::iterator itr = arena_players.begin();
+	while (itr != arena_players.end()) {
+		Player* player = *itr;
 		
-		while ((i < MOVEMENT_PER_FRAME) && (!collision)) {
-			/*
-			if there will be no collision with a movement, move the player
-			*/
-
-			player->newRotation = player->rotation + player->rotationVel;
-			player->newRotation = (player->newRotation + 360) % 360;
-			
-			player->velX = - player->vel * sin(player->newRotation * (M_PI / 180));
-			player->velY = player->vel * cos(player->newRotation * (M_PI / 180));
+		// each pose moves the center up to the speed, and a corner is up to PLAYER_REACH from the center
+		grid_box path = circle_box(player->posX, player->posY,
+								   PLAYER_REACH + (MOVEMENT_PER_FRAME * abs(player->vel)) + 1);
+		
+		// the objects near the path, found the first time a pose gets far enough to be checked against them
+		bool players_found = false;
+		bool walls_found = false;
+		bool bombs_found = false;
+		
+		// the first pose that collides, MOVEMENT_PER_FRAME if none does
+		int stop = 0;
+		bool delete_player = false;
+		for (; stop < MOVEMENT_PER_FRAME; stop++) {
+			// the pose, a step on from the one before
+			double x = (stop == 0) ? player->posX : pose_x[stop - 1];
+			double y = (stop == 0) ? player->posY : pose_y[stop - 1];
+			int rotation = (stop == 0) ? player->rotation : pose_rotation[stop - 1];
+			pose_rotation[stop] = ((rotation + player->rotationVel) + 360) % 360;
 			
-			player->newX = player->posX + player->velX;
-			player->newY = player->posY + player->velY;
+			// the last pose tried is left in the temp values, the other players' bodies are built from them
+			player->newRotation = pose_rotation[stop];
+			player->velX = - player->vel * Rotation_Table::sine(pose_rotation[stop]);
+			player->velY = player->vel * Rotation_Table::cosine(pose_rotation[stop]);
+			player->newX = x + player->velX;
+			player->newY = y + player->velY;
+			pose_x[stop] = player->newX;
+			pose_y[stop] = player->newY;
 			
-			/*
-			check for wall collisions
-			- update rectangle points
-			- for each point, check if it overlaps with wall
-			*/
+			// the corners are the center moved by the half sides, then rounded to a pixel, and the casts
+			// round towards zero, so the box is grown by two pixels and the body is not built until a check needs it
+			half_side length = Rotation_Table::player_length(pose_rotation[stop]);
+			half_side width = Rotation_Table::player_width(pose_rotation[stop]);
+			double extent_x = fabs(length.x) + fabs(width.x);
+			double extent_y = fabs(length.y) + fabs(width.y);
+			grid_box reach;
+			reach.min_x = (int) (player->newX - extent_x) - 2;
+			reach.min_y = (int) (player->newY - extent_y) - 2;
+			reach.max_x = (int) (player->newX + extent_x) + 2;
+			reach.max_y = (int) (player->newY + extent_y) + 2;
 			
-			// check if each point is outside the boundary
-			player->update_rectangle_points();
-			for (point p : player->body.points) {
-				if ((p.x <= 0) || (p.x >= SCREEN_WIDTH) || (p.y <= 0) || (p.y >= SCREEN_HEIGHT)) {
-					collision = true;
+			// check if each point is outside the boundary, only when the box around the body reaches it
+			if ((reach.min_x <= 0) || (reach.max_x >= SCREEN_WIDTH) || (reach.min_y <= 0) || (reach.max_y >= SCREEN_HEIGHT)) {
+				player->update_rectangle_points();
+				bool outside = false;
+				for (int i = 0; i < player->body.num_points; i++) {
+					point p = player->body.points[i];
+					if ((p.x <= 0) || (p.x >= SCREEN_WIDTH) || (p.y <= 0) || (p.y >= SCREEN_HEIGHT)) {
+						outside = true;
+						break;
+					}
+				}
+				if (outside) {
 					break;
 				}
 			}
 			
-			// break now for efficiency
-			if (collision) {
-				break;
+			// an arena has at most MAX_PLAYERS players, too few for a grid to pay for filling it
+			if (!players_found) {
+				nearby_players.clear();
+				nearby_player_boxes.clear();
+				for (Player* other_player : arena_players) {
+					// the player is skipped rather than removed from what was found
+					if (other_player == player) {
+						continue;
+					}
+					
+					other_player->update_rectangle_points();
+					grid_box box = polygon_box(other_player->body, 0);
+					if (boxes_overlap(box, path)) {
+						nearby_players.push_back(other_player);
+						nearby_player_boxes.push_back(box);
+					}
+				}
+				players_found = true;
 			}
-			
-			for (Player* other_player : arena_players) {
-				// if both players are the same, skip to next iteration
-				if (player->color == other_player->color) {
-					continue;
+			nearby_bodies.clear();
+			for (int j = 0; j < (int) nearby_players.size(); j++) {
+				if (boxes_overlap(nearby_player_boxes[j], reach)) {
+					nearby_bodies.add(nearby_players[j]->body);
 				}
-				
-				other_player->update_rectangle_points();
-				
-				bool c = Collisions::polygon_collision(player->body, other_player->body);
-				if (c) {
-					collision = true;
+			}
+			if (nearby_bodies.size() > 0) {
+				player->update_rectangle_points();
+				if (nearby_bodies.collide(player->body) != 0) {
+					break;
 				}
 			}
 			
-			// break now for efficiency
-			if (collision) {
-				break;
+			if (!walls_found) {
+				if (!wall_grid_ready) {
+					fill_wall_grid();
+					wall_grid_ready = true;
+				}
+				wall_grid.query(path, nearby_walls);
+				nearby_wall_boxes.clear();
+				for (Wall* wall : nearby_walls) {
+					nearby_wall_boxes.push_back(polygon_box(wall->body, 0));
+				}
+				walls_found = true;
 			}
-			
-			for (Wall* wall : wall_manager.walls) {
-				wall->newRotation = wall->rotation;
-				wall->update_points();
-				bool c = Collisions::polygon_collision(player->body, wall->body);
-				if (c) {
-					collision = true;
+			nearby_bodies.clear();
+			for (int j = 0; j < (int) nearby_walls.size(); j++) {
+				if (boxes_overlap(nearby_wall_boxes[j], reach)) {
+					nearby_bodies.add(nearby_walls[j]->body);
 				}
 			}
-			
-			// break now for efficiency
-			if (collision) {
-				break;
+			if (nearby_bodies.size() > 0) {
+				player->update_rectangle_points();
+				if (nearby_bodies.collide(player->body) != 0) {
+					break;
+				}
 			}
 			
-			for (Bomb* bomb : bomb_manager.bombs) {
-				bool c = Collisions::bomb_player_collision(bomb, player->body);
-				if (c) {
-					delete_player = true;
-					collision = true;
+			if (!bombs_found) {
+				if (!bomb_grid_ready) {
+					fill_bomb_grid();
+					bomb_grid_ready = true;
 				}
+				bomb_grid.query(path, nearby_bombs);
+				nearby_bomb_boxes.clear();
+				for (Bomb* bomb : nearby_bombs) {
+					nearby_bomb_boxes.push_back(circle_box(bomb->posX, bomb->posY, bomb->radius));
+				}
+				bombs_found = true;
 			}
-			
-			if (!collision) {
-				// no collision, move the position and rotation in the direction of the velocity
-				player->posX = player->newX;
-				player->posY = player->newY;
-				player->rotation = player->newRotation;
+			for (int j = 0; j < (int) nearby_bombs.size(); j++) {
+				Bomb* bomb = nearby_bombs[j];
+				if (boxes_overlap(nearby_bomb_boxes[j], reach)) {
+					player->update_rectangle_points();
+					if (Collisions::bomb_player_collision(bomb, player->body)) {
+						delete_player = true;
+					}
+				}
+			}
+			if (delete_player) {
+				break;
 			}
-			i++;
+		}
+		
+		// the player is left at the last pose that did not collide
+		if (stop > 0) {
+			player->posX = pose_x[stop - 1];
+			player->posY = pose_y[stop - 1];
+			player->rotation = pose_rotation[stop - 1];
 		}
 		
 		if (delete_player) {
-			arena_players.erase(player);
+			itr = arena_players.erase(itr);
 			dead_players.insert(player);
 			continue;
 		}
 		
-		// if the player has shot a projectile, create the projectile and add it to the set
+		// if the player has shot a projectile, create the projectile and add it to the others
 		if (player->shoot_projectile) {
-			Projectile* projectile = new Projectile(player->posX, player->posY,
-													player->rotation, Player::PLAYER_HEIGHT);
-			projectile->shooter_color = player->color;
-			projectiles.insert(projectile);
+			Projectile projectile(player->posX, player->posY, player->rotation, Player::PLAYER_HEIGHT);
+			projectile.shooter = player->slot;
+			// the shot is lost if the arena has used every projectile id
+			projectiles.add(projectile);
 			player->shoot_projectile = false;
 		}
+		
+		itr++;
 	}
 }
 
-// update the positions and check collisions for each projectile
+/*
+update the positions and check collisions for each projectile
+a projectile moves less than PROJECTILE_SWEEP in a frame, so one query of the grids finds
+everything it could touch during the frame
+	- a projectile with nothing near it cannot collide, every one of these is moved at once by
+	  the projectile manager's vectorized kernel
+	- the others are swept through the frame from one bounce to the next, with the time of each
+	  collision found exactly
+*/
 void Arena::update_projectiles() {
-	for (Projectile* projectile : projectiles) {
+	if (projectiles.empty()) {
+		return;
+	}
+	
+	// the walls and players stay where they are while the projectiles move
+	fill_wall_grid();
+	for (Player* player : arena_players) {
+		// get player ready to find actual rectangle corners
+		player->reset_temp_vars();
+		player->update_rectangle_points();
+	}
+	fill_player_grid();
+	
+	/*
+	the projectiles that could collide are taken through the frame together, against the walls and
+	players near each one, the walls and players are numbered in the order they are added
+	*/
+	contact_batch.clear();
+	batch_players.clear();
+	for (Wall* wall : wall_manager.walls) {
+		contact_batch.add_wall(wall);
+	}
+	for (Player* player : arena_players) {
+		contact_batch.add_player(player->body);
+		batch_players.push_back(player);
+	}
+	
+	// find the projectiles that could touch something this frame, and what each could touch
+	contact_projectiles.clear();
+	sweep_wall_masks.resize(projectiles.size());
+	sweep_player_masks.resize(projectiles.size());
+	for (int i = 0; i < projectiles.size(); i++) {
+		grid_box sweep = circle_box(projectiles.posX[i], projectiles.posY[i], PROJECTILE_SWEEP);
+		wall_grid.query(sweep, nearby_walls);
+		player_grid.query(sweep, nearby_players);
+		if (nearby_walls.empty() && nearby_players.empty()) {
+			continue;
+		}
+		contact_projectiles.push_back(i);
 		
-		int i = 0;
-		bool exit = false;
+		uint32_t wall_mask = 0;
+		for (Wall* wall : nearby_walls) {
+			int w = find(wall_manager.walls.begin(), wall_manager.walls.end(), wall) - wall_manager.walls.begin();
+			wall_mask |= (uint32_t) 1 << w;
+		}
+		uint32_t player_mask = 0;
+		for (Player* player : nearby_players) {
+			// checks to make sure the player isn't killed by the projectile it just fired
+			if ((projectiles.tick_count[i] > 2) || (projectiles.shooter[i] != player->slot)) {
+				int p = find(batch_players.begin(), batch_players.end(), player) - batch_players.begin();
+				player_mask |= (uint32_t) 1 << p;
+			}
+		}
+		sweep_wall_masks[i] = wall_mask;
+		sweep_player_masks[i] = player_mask;
+	}
+	
+	// the projectiles with nothing near them are moved through the frame at once, the contact
+	// projectiles, still in order of index, are put where the batch leaves them below
+	projectiles.move_except(Projectile::PROJECTILE_SPEED, contact_projectiles);
+	
+	// a player in reach of several projectiles is killed by the one fired first, whatever order the
+	// removals have left the projectiles in
+	sort(contact_projectiles.begin(), contact_projectiles.end(),
+		 [this](int a, int b) { return projectiles.fired[a] < projectiles.fired[b]; });
+	
+	contact_results.resize(contact_projectiles.size());
+	for (int j = 0; j < (int) contact_projectiles.size(); j++) {
+		int i = contact_projectiles[j];
+		projectiles.get(i, contact_results[j]);
+		contact_batch.add_projectile(contact_results[j], sweep_wall_masks[i], sweep_player_masks[i]);
+	}
+	contact_batch.run();
+	
+	/*
+	the kills are decided in order, since a kill changes the players the projectiles after it can hit
+	a projectile kills the player still alive that it touched first, the first one added on a tie
+	*/
+	uint32_t alive_players = ((uint32_t) 1 << batch_players.size()) - 1;
+	removed_projectiles.clear();
+	for (int j = 0; j < (int) contact_projectiles.size(); j++) {
 		bool was_deleted = false;
+		if (contact_batch.end_time(j) < Projectile::PROJECTILE_SPEED) {
+			// the projectile hit the end of a wall and no longer exists
+			was_deleted = true;
+		}
 		
-		while ((i < projectile->PROJECTILE_SPEED) && (!exit)) {
-			
-			projectile->posX += projectile->velX;
-			projectile->posY += projectile->velY;
-			
-			/*
-			check boundary collision
-			*/
-			
-			if (projectile->posX <= Projectile::RADIUS) {
-				projectile->velX = abs(projectile->velX);
-			}
-			if (projectile->posX >= (SCREEN_WIDTH - Projectile::RADIUS)) {
-				projectile->velX = - abs(projectile->velX);
-			}
-			if (projectile->posY <= Projectile::RADIUS) {
-				projectile->velY = abs(projectile->velY);
-			}
-			if (projectile->posY >= (SCREEN_HEIGHT - Projectile::RADIUS)) {
-				projectile->velY = - abs(projectile->velY);
-			}
-			
-			/*
-			checks wall collision
-			*/
-			
-			for (Wall* wall : wall_manager.walls) {
-				wall->newRotation = wall->rotation;
-				wall->update_points();
-				// signals that the ball should be deflected on collision
-				bool deflect = true;
-				int c = Collisions::wall_ball_collision(projectile, wall, deflect);
-				if (c == 2) {
-					projectiles.erase(projectile);
-					delete projectile;
-					return;
-				}
-			}
-			
-			/*
-			check player collision
-			*/
-			
-			for (Player* player : arena_players) {
-				// get player ready to find actual rectangle corners
-				player->reset_temp_vars();
-				player->update_rectangle_points();
-				// check collision between the player and the ball
-				bool collision = Collisions::ball_player_collision(projectile, player->body);
-				if (collision) {
-					// checks to make sure the player isn't killed by the projectile it just fired
-					if ((projectile->tick_count > 2) || (projectile->shooter_color != player->color)) {
-						arena_players.erase(player);
-						dead_players.insert(player);
-						projectiles.erase(projectile);
-						delete projectile;
-						was_deleted = true;
-						exit = true;
-						break;
-					}
+		uint32_t hits = contact_batch.player_hits(j) & alive_players;
+		if (hits != 0) {
+			int first = __builtin_ctz(hits);
+			for (uint32_t others = hits & (hits - 1); others != 0; others &= others - 1) {
+				int p = __builtin_ctz(others);
+				if (contact_batch.player_time(j, p) < contact_batch.player_time(j, first)) {
+					first = p;
 				}
 			}
-			
-			i++;
+			Player* player = batch_players[first];
+			arena_players.erase(player);
+			dead_players.insert(player);
+			alive_players &= ~((uint32_t) 1 << first);
+			was_deleted = true;
 		}
 		
-		// if the ball was not deleted after a collision, increment its tick count
-		if (!was_deleted) {
-			projectile->tick_count++;
-			projectile->ticks_since_deflection++;
+		if (was_deleted) {
+			removed_projectiles.push_back(contact_projectiles[j]);
+		} else {
+			contact_batch.get_motion(j, contact_results[j]);
 		}
-		
 	}
+	
+	// the dead players are left out of the player grid
+	if (alive_players != ((uint32_t) 1 << batch_players.size()) - 1) {
+		fill_player_grid();
+	}
+	
+	// the contact projectiles still alive are put where the sweep left them
+	for (int j = 0; j < (int) contact_projectiles.size(); j++) {
+		projectiles.set_motion(contact_projectiles[j], contact_results[j]);
+	}
+	
+	// removing from the back first keeps the indexes still to be removed in place
+	sort(removed_projectiles.begin(), removed_projectiles.end());
+	for (int r = (int) removed_projectiles.size() - 1; r >= 0; r--) {
+		projectiles.remove(removed_projectiles[r]);
+	}
+	
+	// every projectile still alive has lasted another frame
+	projectiles.end_frame();
 }
 
 // check if a wall can rotate and update each wall
 void Arena::update_walls() {
+	// the players and projectiles have finished moving for this frame
+	if (!wall_manager.rotating_walls.empty()) {
+		fill_player_grid();
+		fill_projectile_grid();
+	}
+	
 	// check each rotating wall for the ability to rotate another step
 	for (Wall* wall : wall_manager.rotating_walls) {
 		wall->newRotation = wall->rotation + wall->rotationVel;
 		wall->update_points();
 		wall->can_rotate = true;
 		
+		// only the players and projectiles near the wall's new position are checked
+		grid_box wall_box = polygon_box(wall->body, 0);
+		
 		// check for a collision with a player
-		for (Player* player : arena_players) {
-			bool player_collision = Collisions::polygon_collision(player->body, wall->body);
-			if (player_collision) {
-				wall->can_rotate = false;
-			}
+		player_grid.query(wall_box, nearby_players);
+		nearby_bodies.clear();
+		for (Player* player : nearby_players) {
+			nearby_bodies.add(player->body);
+		}
+		
+		if (nearby_bodies.collide(wall->body) != 0) {
+			wall->can_rotate = false;
 		}
 		
 		// check for a collision with a ball
-		for (Projectile* projectile : projectiles) {
+		// the copies in the grid are only read
+		projectile_grid.query(wall_box, nearby_projectiles);
+		for (Projectile* projectile : nearby_projectiles) {
 			// signals that the ball should not be deflected, only checking for the wall's rotation
 			bool deflect = false;
 			int ball_collision = Collisions::wall_ball_collision(projectile, wall, deflect);
@@ -526,14 +777,104 @@ void Arena::update_walls() {
 	wall_manager.update_walls();
 }
 
+body_cache_stats Arena::count_bodies() {
+	body_cache_stats count;
+	count.rebuilt = 0;
+	count.reused = 0;
+	
+	for (Player* player : arena_players) {
+		count.rebuilt += player->body_rebuilds;
+		count.reused += player->body_reuses;
+		player->body_rebuilds = 0;
+		player->body_reuses = 0;
+	}
+	// a player killed this frame built its body before it died
+	for (Player* player : dead_players) {
+		count.rebuilt += player->body_rebuilds;
+		count.reused += player->body_reuses;
+		player->body_rebuilds = 0;
+		player->body_reuses = 0;
+	}
+	for (Wall* wall : wall_manager.walls) {
+		count.rebuilt += wall->body_rebuilds;
+		count.reused += wall->body_reuses;
+		wall->body_rebuilds = 0;
+		wall->body_reuses = 0;
+	}
+	
+	return count;
+}
+
+
+void Arena::fill_wall_grid() {
+	wall_grid.clear();
+	for (Wall* wall : wall_manager.walls) {
+		// a rotating wall's body is left at the rotation it tried last frame
+		wall->newRotation = wall->rotation;
+		wall->update_points();
+		wall_grid.insert(wall, polygon_box(wall->body, 0));
+	}
+}
+
+// the bodies used for the ball checks are rotated about their centers, so a box around the
+// circle the body turns in is used rather than the box around its corners
+void Arena::fill_player_grid() {
+	player_grid.clear();
+	for (Player* player : arena_players) {
+		player_grid.insert(player, circle_box(player->body.center.x, player->body.center.y, PLAYER_REACH));
+	}
+}
+
+void Arena::fill_bomb_grid() {
+	bomb_grid.clear();
+	for (Bomb* bomb : bomb_manager.bombs) {
+		bomb_grid.insert(bomb, circle_box(bomb->posX, bomb->posY, bomb->radius));
+	}
+}
+
+void Arena::fill_projectile_grid() {
+	projectile_grid.clear();
+	// every copy is made before any is inserted, so the vector does not move under the grid
+	grid_projectiles.resize(projectiles.size());
+	for (int i = 0; i < projectiles.size(); i++) {
+		projectiles.get(i, grid_projectiles[i]);
+	}
+	for (Projectile& projectile : grid_projectiles) {
+		projectile_grid.insert(&projectile, circle_box(projectile.posX, projectile.posY, PROJECTILE_REACH));
+	}
+}
+
 // sends out a message with the color and coordinates of each player to draw
 /*
 example output message (player section only):
 	"blue,100,100,0,green,300,300,90,red,500,500,180"
 */
 void Arena::send_message() {
-	string message = "";
+	// the text is built in the arena's buffer, then copied out at its exact size
+	text_writer.clear();
+	write_text_snapshot(text_writer);
 	
+	// reuse the buffers of a snapshot that has already been sent, once the server has handed some
+	// back every frame, a message is built without allocating
+	snapshot_struct snapshot;
+	{
+		lock_guard<mutex> guard(arena_lock);
+		if (!spare_snapshots.empty()) {
+			snapshot = std::move(spare_snapshots.back());
+			spare_snapshots.pop_back();
+		}
+	}
+	
+	// the same state in both formats, each player is sent the one it asked for
+	snapshot.text.assign(text_writer.data(), text_writer.size());
+	write_snapshot_state(snapshot.state);
+	
+	// send the message to the queue to be sent to players
+	add_to_outgoing_queue(std::move(snapshot));
+}
+
+// writes the text format of the snapshot, the color and coordinates of everything to draw
+void Arena::write_text_snapshot(Text_Writer& writer) {
 	// used for omitting the first comma
 	int i = 0;
 	
@@ -541,71 +882,138 @@ void Arena::send_message() {
 	for (Player* player : arena_players) {
 		// don't add a comma if it is the first element of the message
 		if (i != 0) {
-			message += ",";
+			writer.write_char(',');
 		}
 		
-		// append the message string with the data
-		message += player->color;
-		message += "," + to_string((int) (player->posX + 0.5));
-		message += "," + to_string((int) (player->posY + 0.5));
-		message += "," + to_string(player->rotation);
+		// append the message with the data
+		writer.write_string(player->color);
+		writer.write_char(',');
+		writer.write_int((int) (player->posX + 0.5));
+		writer.write_char(',');
+		writer.write_int((int) (player->posY + 0.5));
+		writer.write_char(',');
+		writer.write_int(player->rotation);
 		
 		i++;
 	}
 	
-	message += "/";
+	writer.write_char('/');
 	i = 0;
 	
 	// add each wall's data to the message
 	for (Wall* wall : wall_manager.walls) {
 		if (i != 0) {
-			message += ",";
+			writer.write_char(',');
 		}
 		
-		message += to_string(wall->posX);
-		message += "," + to_string(wall->posY);
-		message += "," + to_string(wall->rotation);
+		writer.write_int(wall->posX);
+		writer.write_char(',');
+		writer.write_int(wall->posY);
+		writer.write_char(',');
+		writer.write_int(wall->rotation);
 		
 		i++;
 	}
 	
-	message += "/";
+	writer.write_char('/');
 	i = 0;
 	
 	// necessary since there may not be any bombs but there must be something between /'s
-	message += "=====,";
+	writer.write_string(BOMB_PLACEHOLDER);
 	
-	// add each projectile's data to the message
+	// add each bomb's data to the message
 	for (Bomb* bomb : bomb_manager.bombs) {
 		if (i != 0) {
-			message += ",";
+			writer.write_char(',');
 		}
 		
-		message += to_string(bomb->posX);
-		message += "," + to_string(bomb->posY);
-		message += "," + to_string((int) bomb->radius);
-		message += "," + to_string((int) bomb->warning_mode);
+		writer.write_int(bomb->posX);
+		writer.write_char(',');
+		writer.write_int(bomb->posY);
+		writer.write_char(',');
+		writer.write_int((int) bomb->radius);
+		writer.write_char(',');
+		writer.write_int((int) bomb->warning_mode);
 		
 		i++;
 	}
 	
-	message += "/";
+	writer.write_char('/');
 	i = 0;
 	
 	// add each projectile's data to the message
-	for (Projectile* projectile : projectiles) {
+	for (i = 0; i < projectiles.size(); i++) {
 		if (i != 0) {
-			message += ",";
+			writer.write_char(',');
 		}
 		
-		message += to_string((int) (projectile->posX + 0.5));
-		message += "," + to_string((int) (projectile->posY + 0.5));
-		
-		i++;
+		writer.write_int((int) (projectiles.posX[i] + 0.5));
+		writer.write_char(',');
+		writer.write_int((int) (projectiles.posY[i] + 0.5));
+	}
+}
+
+
+// records the data sent by send_message, rounded the same way, for the binary formats
+void Arena::write_snapshot_state(snapshot_state& state) {
+	state.tick = snapshot_tick;
+	snapshot_tick++;
+	
+	// the state may be a recycled one, the sections keep their memory
+	for (int section = 0; section < NUM_SECTIONS; section++) {
+		state.sections[section].clear();
 	}
 	
-	// send the message to the queue to be sent to players
-	add_to_outgoing_queue(message);
+	entity_state entity;
+	
+	vector<entity_state>& players = state.sections[PLAYER_SECTION];
+	players.reserve(arena_players.size());
+	for (Player* player : arena_players) {
+		entity.id = player->slot;
+		entity.fields[0] = quantize_position(player->posX);
+		entity.fields[1] = quantize_position(player->posY);
+		entity.fields[2] = player->rotation;
+		players.push_back(entity);
+	}
+	
+	// the set of walls does not change during a game, so a wall's place in the set is its id
+	vector<entity_state>& walls = state.sections[WALL_SECTION];
+	walls.reserve(wall_manager.walls.size());
+	uint16_t wall_id = 0;
+	for (Wall* wall : wall_manager.walls) {
+		entity.id = wall_id;
+		entity.fields[0] = quantize_position(wall->posX);
+		entity.fields[1] = quantize_position(wall->posY);
+		entity.fields[2] = wall->rotation;
+		walls.push_back(entity);
+		wall_id++;
+	}
+	
+	vector<entity_state>& bombs = state.sections[BOMB_SECTION];
+	bombs.reserve(bomb_manager.bombs.size());
+	for (Bomb* bomb : bomb_manager.bombs) {
+		entity.id = bomb->id;
+		entity.fields[0] = quantize_position(bomb->posX);
+		entity.fields[1] = quantize_position(bomb->posY);
+		entity.fields[2] = (int) bomb->radius;
+		entity.fields[3] = bomb->warning_mode;
+		bombs.push_back(entity);
+	}
+	
+	vector<entity_state>& projectile_states = state.sections[PROJECTILE_SECTION];
+	projectile_states.reserve(projectiles.size());
+	for (int i = 0; i < projectiles.size(); i++) {
+		entity.id = projectiles.id[i];
+		entity.fields[0] = quantize_position(projectiles.posX[i]);
+		entity.fields[1] = quantize_position(projectiles.posY[i]);
+		projectile_states.push_back(entity);
+	}
+	
+	// deltas are built by walking the sections in order of id
+	for (int section = 0; section < NUM_SECTIONS; section++) {
+		sort(state.sections[section].begin(), state.sections[section].end(),
+			 [](const entity_state& a, const entity_state& b) { return a.id < b.id; });
+	}
 }
 
 // locks the arena lock, called by the server
@@ -627,25 +1035,28 @@ void Arena::clean_up() {
 	// player objects are deleted in gameserver after this function has finished
 	arena_players.clear();
 	dead_players.clear();
+	// players that disconnected during the last frame can be deleted now
+	left_players.insert(left_players.end(), leaving_players.begin(), leaving_players.end());
+	leaving_players.clear();
 	
-	// clear the message queue and deallocate the memory for each message
-	while (!incoming_queue.empty()) {
-		message_struct* msg = incoming_queue.front();
-		incoming_queue.pop();
-		msg->player = NULL;
-		delete msg;
+	// clear the message queue and the player slots the messages refer to
+	message_struct msg;
+	while (incoming_queue.try_pop(msg)) {
+		// nothing to do, the message is dropped
+	}
+	for (int i = 0; i < MAX_PLAYERS; i++) {
+		player_slots[i] = NULL;
 	}
 	
 	// nothing to deallocate here, just need to clear the queue
-	while (!outgoing_queue.empty()) {
-		outgoing_queue.pop();
+	// the unsent snapshots are kept as spares for the next game, the lock is already held
+	for (snapshot_struct& snapshot : outgoing_queue) {
+		spare_snapshots.push_back(std::move(snapshot));
 	}
+	outgoing_queue.clear();
 	
-	// remove each projectile from the set and delete it
-	for (Projectile* projectile : projectiles) {
-		projectiles.erase(projectile);
-		delete projectile;
-	}
+	// remove the projectiles, the manager keeps its memory for the next game
+	projectiles.clear();
 	
 	// delete the walls, handled by the wall manager
 	wall_manager.clean_up();
@@ -654,16 +1065,51 @@ void Arena::clean_up() {
 	bomb_manager.clean_up();
 	
 	// signal to gameserver that the arena is done being cleaned
+	// new players are not accepted until the gameserver has cleared the old connections
 	ready_to_reset = true;
 	ready_to_start = false;
 	num_players = 0;
-	color_index = 0;
-	accepting_players = true;
+	accepting_players = false;
 	
 	// release the arena lock
 	unlock_mutex();
 	
+	// let the gameserver know the arena is ready to be reset
+	if (outgoing_callback) {
+		outgoing_callback();
+	}
 }
 
+// called by the gameserver once it has cleared the arena's connections, opens the arena to new players
+void Arena::finish_reset() {
+	{
+		lock_guard<mutex> guard(arena_lock);
+		
+		ready_to_reset = false;
+		accepting_players = true;
+	}
+	
+	// tick the arena so it goes back to its lobby
+	if (wake_callback) {
+		wake_callback();
+	}
+}
+
+// shut down an empty arena that is waiting for players
+bool Arena::stop() {
+	lock_guard<mutex> guard(arena_lock);
+	
+	// only an empty, open lobby can be stopped, a player may have just been added
+	if (!accepting_players || (num_players > 0) || ready_to_reset || stopped) {
+		return false;
+	}
+	
+	// the next tick, if there is one, parks the arena for good
+	stopped = true;
+	accepting_players = false;
+	return true;
+}
+
+
 
 
@@ -10,31 +10,56 @@ single game instance.
 #ifndef ARENA_H
 #define ARENA_H
 
-// websocketpp library
-#include <websocketpp/server.hpp>
-#include <websocketpp/config/asio_no_tls.hpp>
-
 // include game files
 #include "player.h"
 #include "message_struct.h"
 #include "projectile.h"
+#include "projectile_manager.h"
 #include "wall.h"
 #include "wall_manager.h"
 #include "bomb.h"
 #include "bomb_manager.h"
+#include "frame_scheduler.h"
+#include "spsc_queue.h"
+#include "snapshot.h"
+#include "text_writer.h"
+#include "spatial_grid.h"
+#include "polygon_batch.h"
+#include "projectile_batch.h"
 
 // include other dependencies
-#include <queue>
 #include <set>
+#include <vector>
 #include <string>
 #include <mutex>
-
-using websocketpp::connection_hdl;
+#include <atomic>
+#include <functional>
+#include <chrono>
 
 using namespace std;
 
-// defines the type of the set of connections
-typedef set<connection_hdl, owner_less<connection_hdl>> connection_list;
+
+/*
+How many times the collision bodies of the players and walls were rebuilt during a frame, and how
+many times one was asked for again without having moved and was kept instead.
+*/
+typedef struct body_cache_stats {
+	int rebuilt;
+	int reused;
+} body_cache_stats;
+
+
+// the stages an arena goes through, over and over, until it is stopped
+enum arena_state {
+	// gathering players for the next game
+	LOBBY,
+	// a game is running, one frame each tick
+	PLAYING,
+	// the game is over, waiting for the gameserver to reset the arena
+	RESETTING,
+	// shut down by the gameserver, never ticked again
+	STOPPED
+};
 
 
 class Arena {
@@ -44,7 +69,8 @@ public:
 	~Arena();
 	
 	// signals to the gameserver to reset the arena and prepare it for a new game
-	bool ready_to_reset;
+	// read by the gameserver without the arena lock
+	atomic<bool> ready_to_reset;
 	
 	// dimensions of the game screen
 	static const int SCREEN_WIDTH = 960;
@@ -52,17 +78,38 @@ public:
 	
 	// adds a player to the arena, returns true if successful
 	bool add_player(Player* player);
-	// remove a player after they have disconnected
-	void remove_player(Player* player);
+	// remove a player after they have disconnected, returns true if the arena has let go of the player
+	// during a game the player is dropped at the start of the next frame instead, and handed back by
+	// take_left_players, the player must not be deleted before then
+	// seat_freed is set if the player left the lobby, the arena then accepts another player in its place
+	bool remove_player(Player* player, bool& seat_freed);
+	// moves the players the arena has let go of since the last call into left, they can then be deleted
+	void take_left_players(vector<Player*>& left);
+	
+	/*
+	does whatever the arena needs to do now, never blocks
+		- in the lobby, starts the game once the arena is full or has waited long enough
+		- during a game, runs one frame
+		- once the game is over, cleans up and waits to be reset
+	returns the time tick should next be called, or PARKED if the arena has nothing to do
+	until it is woken up (by a player joining or the arena being reset)
+	called by one of the scheduler's workers, never by two at once
+	*/
+	chrono::steady_clock::time_point tick(chrono::steady_clock::time_point now);
+	// returned by tick when the arena is waiting to be woken up
+	static const chrono::steady_clock::time_point PARKED;
 	
-	// game start loop, waits until game is ready to begin, then calls main loop
-	void start();
-	// runs right before the game loop begins to get everything initialized correctly
+	// runs right before the game begins to get everything initialized correctly
 	void setup();
-	// main game loop
-	void game_loop();
+	// runs one frame of the game
+	void run_frame();
 	// clean up the arena, free memory, and prepare for a new game
 	void clean_up();
+	// reopen the arena to new players, called by the gameserver after it has been reset
+	void finish_reset();
+	// shut down an empty arena, it is no longer ticked and no more players are accepted
+	// returns false if the arena has players or is not waiting in its lobby
+	bool stop();
 	
 	// assigns positions to the players before the game starts
 	void init_player_positions();
@@ -85,58 +132,187 @@ public:
 	// adds a message to the outgoing queue with the color and coordinateds of each player to draw
 	void send_message();
 	
-	// add a new message passed from the server to the queue to be processed
-	void add_to_incoming_queue(message_struct* new_message);
+	// counts the bodies rebuilt and kept since the last count, and starts counting again
+	body_cache_stats count_bodies();
+	// the bodies rebuilt and kept during the latest frame, only used on the arena's thread
+	body_cache_stats frame_bodies;
+	// writes the text format of the message sent by send_message
+	void write_text_snapshot(Text_Writer& writer);
+	// records the state sent by send_message, used to build the binary versions of the message
+	void write_snapshot_state(snapshot_state& state);
+	
+	// decode a new message passed from the server and add it to the queue to be processed
+	void add_to_incoming_queue(Player* player, const string& message_text);
 	
 	// add a new message produced by the arena to the queue to be sent
-	void add_to_outgoing_queue(string message);
+	void add_to_outgoing_queue(snapshot_struct snapshot);
+	// hands back the snapshots the server has sent, their buffers are reused by later messages
+	// the vector is left empty, keeping its memory
+	void recycle_snapshots(vector<snapshot_struct>& sent);
+	
+	// sets the function called whenever there is something new for the gameserver to send or reset
+	void set_outgoing_callback(function<void()> callback);
+	// sets the function called when a parked arena has something to do, set by the scheduler
+	void set_wake_callback(function<void()> callback);
 	
 	// the list of players in the arena
 	set<Player*> arena_players;
 	// set to add players to when they die so they are accounted for but not displayed
 	set<Player*> dead_players;
 		
-	// queue of messages received from the server
-	queue<message_struct*> incoming_queue;
-	// queue of messages for the server to send
-	queue<string> outgoing_queue;
+	// the number of decoded messages that can be waiting to be processed
+	static const int INCOMING_QUEUE_CAPACITY = 256;
+	// queue of decoded messages received from the server, filled by the action thread
+	// and drained by the arena thread without taking the arena lock
+	SPSC_Queue<message_struct> incoming_queue;
+	// the number of input messages dropped because they were malformed or out of range
+	// written by the action thread, can be read from any thread
+	atomic<unsigned long> rejected_messages;
+	// queue of messages for the server to send, each in the text format and as the state the
+	// binary formats are built from, oldest first
+	// the server swaps it for an empty vector of its own, so neither one gives up its memory
+	vector<snapshot_struct> outgoing_queue;
+	// snapshots the server has finished sending, send_message fills one of these instead of
+	// allocating a new one, only accessed while holding the arena lock
+	vector<snapshot_struct> spare_snapshots;
 	
-	// number of players currently in the arena
+	// number of players currently in the arena, only accessed while holding the arena lock
 	int num_players;
 	// maximum number of players allowed in an arena
 	static const int MAX_PLAYERS = 4;
+	// the amount of time (seconds) to wait after the first player joins before the arena starts partially filled
+	static constexpr int WAITING_LIMIT = 40;
+	
+	// desired time (in milliseconds) of each frame
+	static const int FRAME_TIME_MS = 25;
+	// keeps the deadlines of the frames, also keeps statistics about how late frames have been
+	Frame_Scheduler frame_scheduler;
 	
 	// functions to lock and unlock the arena lock, called by the server
 	void lock_mutex();
 	void unlock_mutex();
 
 private:
+	// the headless benchmarks drive the individual phases of the game loop directly
+	friend class Arena_Bench;
+	friend class Snapshot_Bench;
+	friend class Broadphase_Bench;
+	friend class Movement_Bench;
+	
+	// the stage the arena is in, only changed by tick
+	arena_state state;
+	// when the lobby stops waiting for more players, set once the first player has joined and
+	// cleared if every player leaves, only accessed while holding the arena lock
+	bool lobby_deadline_set;
+	chrono::steady_clock::time_point lobby_deadline;
+	
+	// the following flags are only accessed while holding the arena lock
 	// true while the arena is still gathering players and has not exceeded maximum
 	// set to false when the max is reached or when the game starts
 	bool accepting_players;
 	// indicates when the game is ready to begin, start loop will terminate and call game loop
 	bool ready_to_start;
+	// set once the arena has been shut down by the gameserver, it is never reopened
+	bool stopped;
+	
+	// called after a message is added to the outgoing queue or the arena is ready to reset
+	// wakes up the gameserver's action thread, must not be called while holding the arena lock
+	function<void()> outgoing_callback;
+	
+	// called after a player joins or the arena is reset, lets the scheduler know to tick the arena
+	// must not be called while holding the arena lock
+	function<void()> wake_callback;
 	
 	// used for locking access to the arena's resources
 	mutex arena_lock;
 	
-	// used for assigning colors to the players
+	// used for assigning colors to the players, by slot
 	static const string color_list[];
-	// the index of the color to be given to a new player
-	int color_index;
+	// the players in the arena, indexed by slot, used to find the sender of an input message
+	// cleared when a player disconnects, so it is read and written from different threads
+	atomic<Player*> player_slots[MAX_PLAYERS];
+	// players that disconnected during a game, still in the sets until the start of the next frame,
+	// and players the arena has let go of, waiting to be taken back by the gameserver
+	// only accessed while holding the arena lock
+	vector<Player*> leaving_players;
+	vector<Player*> left_players;
+	// drops the players that disconnected since the last frame from the sets
+	void drop_leaving_players();
 	
 	// pixels to move and degrees to rotate each frame
 	// for players only
 	static const int MOVEMENT_PER_FRAME = 5;
 	
-	// list of projectiles
-	set<Projectile*> projectiles;
+	// the live projectiles
+	Projectile_Manager projectiles;
+	
+	/*
+	broadphase, only the objects found near each other in these grids are checked for collisions
+	each grid is filled again at the start of the phase that uses it
+	*/
+	// the size (pixels) of each cell of the grids, 15 by 10 cells cover the field
+	static const int GRID_CELL_SIZE = 64;
+	// the furthest a corner of a player's rectangle can be from its center (70.7), rounding included
+	static const int PLAYER_REACH = 74;
+	// how far outside the edge of a projectile its collision checks can find something, rounding included
+	static const int PROJECTILE_REACH = Projectile::RADIUS + 2;
+	Spatial_Grid<Wall> wall_grid;
+	Spatial_Grid<Player> player_grid;
+	Spatial_Grid<Bomb> bomb_grid;
+	Spatial_Grid<Projectile> projectile_grid;
+	// the results of the latest query of each grid, kept to reuse their memory
+	vector<Wall*> nearby_walls;
+	vector<Player*> nearby_players;
+	vector<Bomb*> nearby_bombs;
+	vector<Projectile*> nearby_projectiles;
+	// the bodies of the nearby players or walls, tested against one body at once
+	Polygon_Batch nearby_bodies;
+	// while the players move, the boxes around the players, walls and bombs near a player's path,
+	// a pose is only tested against the ones whose boxes reach it
+	vector<grid_box> nearby_player_boxes;
+	vector<grid_box> nearby_wall_boxes;
+	vector<grid_box> nearby_bomb_boxes;
+	// copies of the projectiles for the projectile grid, which holds pointers into it
+	vector<Projectile> grid_projectiles;
+	
+	// how far from where it starts a frame a projectile's collision checks can find something
+	// it moves one pixel each step, plus a pixel for rounding
+	static const int PROJECTILE_SWEEP = PROJECTILE_REACH + Projectile::PROJECTILE_SPEED + 1;
+	// the projectiles that could touch something this frame, by index, copies of them as they
+	// are moved, and the indexes of those that hit something and are removed
+	vector<int> contact_projectiles;
+	vector<Projectile> contact_results;
+	vector<int> removed_projectiles;
+	// the walls and players found near each contact projectile, by the projectile's index, as bits
+	// numbered like the walls and players in the batch
+	vector<uint32_t> sweep_wall_masks;
+	vector<uint32_t> sweep_player_masks;
+	// the narrowphase for those projectiles, and the players in it, in the order they were added
+	Projectile_Batch contact_batch;
+	vector<Player*> batch_players;
+	
+	// moves every wall's collision body to its current rotation and fills the wall grid
+	void fill_wall_grid();
+	// fills the player grid with each player's current collision body
+	void fill_player_grid();
+	// fills the bomb grid
+	void fill_bomb_grid();
+	// fills the projectile grid
+	void fill_projectile_grid();
 	
 	// handles wall updates
 	Wall_Manager wall_manager;
 	
 	// handles bombs
 	Bomb_Manager bomb_manager;
+	
+	// reused by send_message to build the text format without allocating
+	Text_Writer text_writer;
+	// written in place of the bombs so there is always something between the /'s
+	static const string BOMB_PLACEHOLDER;
+	
+	// the tick of the next snapshot, never reset so ticks stay unique across games
+	uint32_t snapshot_tick;
 
 };
 
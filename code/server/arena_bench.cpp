@@ -0,0 +1,381 @@
+/*
+Arena benchmark
+
+Chaos The Game
+
+Runs an arena without a server or a socket and times each phase of the game loop.
+Frames are not throttled, so every tick runs back to back. A set of stress scenarios
+is run one after another, and for each one the average time and the average number
+of heap allocations per tick are printed for every phase, along with the number of collision
+bodies rebuilt and kept each tick.
+
+usage: ./bench.out [ticks per scenario]
+*/
+
+// include game files
+#include "arena.h"
+#include "player.h"
+#include "message_struct.h"
+#include "projectile.h"
+#include "wall.h"
+#include "wall_manager.h"
+#include "bomb.h"
+#include "bomb_manager.h"
+
+// include other dependencies
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <new>
+// used for printing and random number generation
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+/*
+allocation counting
+every call into the global allocator made by this program goes through these operators
+*/
+
+// total number of allocations since the program started
+static unsigned long allocation_count = 0;
+
+void* operator new(size_t size) {
+	allocation_count++;
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
+
+
+// the stress scenarios that can be run
+enum scenario_type {
+	// all four players rotate, drive, and fire as fast as the game allows
+	FIRING,
+	// hundreds of projectiles are kept alive, bouncing off the walls and the screen edges
+	PROJECTILES,
+	// every interior wall rotates at the same time, back and forth
+	ROTATING_WALLS,
+	// the walls have closed and the outer ring is covered in detonated bombs
+	BOMBS
+};
+
+// the phases of the game loop, in the order they run each frame
+enum phase_type {
+	PROCESS_MESSAGES,
+	UPDATE_PLAYER_POSITIONS,
+	UPDATE_PROJECTILES,
+	UPDATE_WALLS,
+	UPDATE_BOMBS,
+	SEND_MESSAGE,
+	NUM_PHASES
+};
+
+const char* phase_names[] = {"process_messages", "update_player_positions", "update_projectiles",
+							 "update_walls", "update_bombs", "send_message"};
+
+
+class Arena_Bench {
+
+public:
+	Arena_Bench(scenario_type type, int ticks);
+	~Arena_Bench();
+
+	// set up the arena and run every tick of the scenario
+	void run();
+	// print the per-phase results of the run
+	void print_results(const char* name);
+
+private:
+	// the scenario being run and its length
+	scenario_type type;
+	int ticks;
+
+	// the arena being measured and the players that were added to it
+	Arena arena;
+	vector<Player*> players;
+
+	// total time (nanoseconds) and allocations spent in each phase
+	long long phase_ns[NUM_PHASES];
+	unsigned long phase_allocations[NUM_PHASES];
+
+	// sum of the number of live projectiles at the start of each tick
+	long long projectile_total;
+	// sums of the collision bodies rebuilt and kept each tick
+	long long bodies_rebuilt;
+	long long bodies_reused;
+
+	// the number of projectiles kept alive in the projectile scenario
+	static const int LIVE_PROJECTILES = 400;
+	// the number of bombs kept in the outer ring in the bomb scenario
+	static const int LIVE_BOMBS = 48;
+
+	// untimed work done before each tick to keep the scenario in its stressed state
+	void prepare_tick(int tick);
+	// queue one input message for each player
+	void queue_input(const string& text);
+	// put players killed in the last tick back into the game at their starting corners
+	void revive_players();
+	// top up the projectiles to LIVE_PROJECTILES
+	void refill_projectiles();
+	// send every wall rotating, turning it around once it reaches its target
+	void rotate_all_walls();
+	// move every wall to its final rotation
+	void close_all_walls();
+	// top up the bombs to LIVE_BOMBS and keep them detonated
+	void refill_bombs();
+
+	// time one phase of the game loop
+	template <typename F>
+	void run_phase(phase_type phase, F function);
+
+};
+
+
+Arena_Bench::Arena_Bench(scenario_type type, int ticks) : type(type), ticks(ticks) {
+	for (int i = 0; i < NUM_PHASES; i++) {
+		phase_ns[i] = 0;
+		phase_allocations[i] = 0;
+	}
+	projectile_total = 0;
+	bodies_rebuilt = 0;
+	bodies_reused = 0;
+
+	// fill the arena
+	for (int i = 0; i < Arena::MAX_PLAYERS; i++) {
+		Player* player = new Player();
+		arena.add_player(player);
+		players.push_back(player);
+	}
+}
+
+Arena_Bench::~Arena_Bench() {
+	// the arena does not own its players, the server normally deletes them
+	arena.clean_up();
+	for (Player* player : players) {
+		delete player;
+	}
+}
+
+void Arena_Bench::run() {
+	arena.setup();
+	arena.outgoing_queue.clear();
+
+	if (type == ROTATING_WALLS) {
+		rotate_all_walls();
+	} else if (type == BOMBS) {
+		close_all_walls();
+	}
+
+	for (int tick = 0; tick < ticks; tick++) {
+		prepare_tick(tick);
+		projectile_total += arena.projectiles.size();
+
+		run_phase(PROCESS_MESSAGES, [&]() { arena.process_messages(); });
+		run_phase(UPDATE_PLAYER_POSITIONS, [&]() { arena.update_player_positions(); });
+		run_phase(UPDATE_PROJECTILES, [&]() { arena.update_projectiles(); });
+		run_phase(UPDATE_WALLS, [&]() { arena.update_walls(); });
+		run_phase(UPDATE_BOMBS, [&]() { arena.bomb_manager.update_bombs(); });
+		run_phase(SEND_MESSAGE, [&]() { arena.send_message(); });
+
+		body_cache_stats bodies = arena.count_bodies();
+		bodies_rebuilt += bodies.rebuilt;
+		bodies_reused += bodies.reused;
+
+		// nobody is listening, hand the snapshot straight back the way the server does once it is sent
+		arena.recycle_snapshots(arena.outgoing_queue);
+	}
+}
+
+template <typename F>
+void Arena_Bench::run_phase(phase_type phase, F function) {
+	unsigned long allocations = allocation_count;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	function();
+
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+	phase_ns[phase] += chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+	phase_allocations[phase] += allocation_count - allocations;
+}
+
+void Arena_Bench::print_results(const char* name) {
+	printf("%s: %d ticks, %.1f live projectiles, %zu bombs, %zu rotating walls at the end\n",
+		   name, ticks, (double) projectile_total / ticks, arena.bomb_manager.bombs.size(),
+		   arena.wall_manager.rotating_walls.size());
+	printf("  %-26s %14s %14s\n", "phase", "ns/tick", "allocs/tick");
+
+	double total_ns = 0.0;
+	double total_allocations = 0.0;
+	for (int i = 0; i < NUM_PHASES; i++) {
+		double ns = (double) phase_ns[i] / ticks;
+		double allocations = (double) phase_allocations[i] / ticks;
+		printf("  %-26s %14.0f %14.2f\n", phase_names[i], ns, allocations);
+		total_ns += ns;
+		total_allocations += allocations;
+	}
+	printf("  %-26s %14.0f %14.2f\n", "total", total_ns, total_allocations);
+	printf("  collision bodies per tick: %.1f rebuilt, %.1f kept\n\n", (double) bodies_rebuilt / ticks,
+		   (double) bodies_reused / ticks);
+}
+
+void Arena_Bench::prepare_tick(int tick) {
+	revive_players();
+
+	if (type == FIRING) {
+		// press and release the space bar every other frame, the fastest possible rate of fire
+		if (tick % 2 == 0) {
+			queue_input("1,-1,1");
+		} else {
+			queue_input("1,-1,0");
+		}
+	} else if (type == PROJECTILES) {
+		queue_input("0,0,0");
+		refill_projectiles();
+	} else if (type == ROTATING_WALLS) {
+		queue_input("1,0,0");
+		rotate_all_walls();
+	} else if (type == BOMBS) {
+		queue_input("1,-1,0");
+		refill_bombs();
+	}
+}
+
+void Arena_Bench::queue_input(const string& text) {
+	for (Player* player : arena.arena_players) {
+		arena.add_to_incoming_queue(player, text);
+	}
+}
+
+void Arena_Bench::revive_players() {
+	const int corners[4][2] = {{140, 160}, {820, 480}, {140, 480}, {820, 160}};
+
+	for (Player* player : arena.dead_players) {
+		int i = rand() % 4;
+		player->posX = corners[i][0];
+		player->posY = corners[i][1];
+		player->rotation = 0;
+		arena.arena_players.insert(player);
+	}
+	arena.dead_players.clear();
+}
+
+void Arena_Bench::refill_projectiles() {
+	while (arena.projectiles.size() < LIVE_PROJECTILES) {
+		// spawn in the open area between the player corners, heading in a random direction
+		arena.projectiles.add(Projectile(rand() % 500 + 230, rand() % 400 + 120, rand() % 360, 0));
+	}
+}
+
+void Arena_Bench::rotate_all_walls() {
+	Wall_Manager& manager = arena.wall_manager;
+
+	for (Wall* wall : manager.unrotated_walls) {
+		manager.rotating_walls.push_back(wall);
+	}
+	manager.unrotated_walls.clear();
+
+	// send finished walls back the way they came
+	for (Wall* wall : manager.finished_rotating_walls) {
+		if (wall->target_rotation == 0) {
+			wall->target_rotation = 90;
+			wall->rotationVel = 1;
+		} else {
+			wall->target_rotation = 0;
+			wall->rotationVel = -1;
+		}
+		manager.rotating_walls.push_back(wall);
+	}
+	manager.finished_rotating_walls.clear();
+}
+
+void Arena_Bench::close_all_walls() {
+	Wall_Manager& manager = arena.wall_manager;
+
+	for (Wall* wall : manager.walls) {
+		wall->rotation = wall->target_rotation;
+		wall->newRotation = wall->target_rotation;
+		wall->update_points();
+		manager.finished_rotating_walls.push_back(wall);
+	}
+	manager.unrotated_walls.clear();
+	manager.rotating_walls.clear();
+}
+
+void Arena_Bench::refill_bombs() {
+	Bomb_Manager& manager = arena.bomb_manager;
+
+	while (manager.bombs.size() < LIVE_BOMBS) {
+		// spread the bombs evenly around the outer ring
+		int i = manager.bombs.size();
+		int x, y;
+		if (i % 4 == 0) {
+			x = 90 + (i * 67) % 780;
+			y = 70;
+		} else if (i % 4 == 1) {
+			x = 90 + (i * 67) % 780;
+			y = 570;
+		} else if (i % 4 == 2) {
+			x = 90;
+			y = 70 + (i * 41) % 500;
+		} else {
+			x = 870;
+			y = 70 + (i * 41) % 500;
+		}
+		manager.add_bomb(x, y);
+	}
+
+	// keep every bomb past its warning time but short of its destroy time
+	chrono::time_point<chrono::system_clock> detonated = chrono::system_clock::now() - chrono::seconds(5);
+	for (Bomb* bomb : manager.bombs) {
+		bomb->start_time = detonated;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	int ticks = 1000;
+	if (argc > 1) {
+		ticks = atoi(argv[1]);
+	}
+	if (ticks <= 0) {
+		printf("usage: %s [ticks per scenario]\n", argv[0]);
+		return 1;
+	}
+
+	const char* names[] = {"firing", "projectiles", "rotating walls", "bombs"};
+	scenario_type scenarios[] = {FIRING, PROJECTILES, ROTATING_WALLS, BOMBS};
+
+	for (int i = 0; i < 4; i++) {
+		Arena_Bench bench(scenarios[i], ticks);
+		bench.run();
+		bench.print_results(names[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,367 @@
+/*
+Arena scheduler class file
+Runs the ticks of every arena on a fixed pool of worker threads
+
+Chaos The Game
+*/
+
+#include "arena_scheduler.h"
+#include "arena.h"
+
+#include <vector>
+#include <map>
+#include <queue>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+
+Arena_Scheduler::Arena_Scheduler(int num_workers) {
+	// hardware_concurrency returns 0 if the number of cores is unknown
+	if (num_workers <= 0) {
+		num_workers = max(1, (int) thread::hardware_concurrency());
+	}
+
+	for (int i = 0; i < num_workers; i++) {
+		unique_ptr<worker> new_worker(new worker());
+		new_worker->ticks = 0;
+		new_worker->steals = 0;
+		new_worker->busy_ns = 0;
+		new_worker->sleeps = 0;
+		new_worker->idle = false;
+		new_worker->signalled = false;
+		workers.push_back(std::move(new_worker));
+	}
+
+	running = false;
+	next_worker = 0;
+}
+
+Arena_Scheduler::~Arena_Scheduler() {
+	stop();
+}
+
+void Arena_Scheduler::start() {
+	start_time = chrono::steady_clock::now();
+	running = true;
+
+	for (int i = 0; i < (int) workers.size(); i++) {
+		workers[i]->worker_thread = thread(&Arena_Scheduler::run_worker, this, i);
+	}
+}
+
+void Arena_Scheduler::stop() {
+	running = false;
+
+	for (unique_ptr<worker>& w : workers) {
+		{
+			// taking the lock ensures the worker is either asleep or will see running is false
+			lock_guard<mutex> guard(w->lock);
+			w->signalled = true;
+			w->condition.notify_one();
+		}
+		if (w->worker_thread.joinable()) {
+			w->worker_thread.join();
+		}
+	}
+}
+
+void Arena_Scheduler::add(Arena* arena) {
+	shared_ptr<scheduled_arena> entry = make_shared<scheduled_arena>();
+	entry->arena = arena;
+	entry->running = false;
+	entry->woken = false;
+	entry->removed = false;
+	entry->generation = 0;
+
+	{
+		lock_guard<mutex> guard(arenas_lock);
+		arenas[arena] = entry;
+		entry->worker = next_worker;
+		next_worker = (next_worker + 1) % workers.size();
+	}
+
+	// the arena lets the scheduler know when it has been woken up
+	arena->set_wake_callback([this, arena]() { wake(arena); });
+
+	lock_guard<mutex> guard(entry->lock);
+	queue_arena(entry, chrono::steady_clock::now(), true);
+}
+
+void Arena_Scheduler::remove(Arena* arena) {
+	shared_ptr<scheduled_arena> entry;
+	{
+		lock_guard<mutex> guard(arenas_lock);
+		map<Arena*, shared_ptr<scheduled_arena>>::iterator itr = arenas.find(arena);
+		if (itr == arenas.end()) {
+			return;
+		}
+		entry = itr->second;
+		arenas.erase(itr);
+	}
+
+	// any task still on a queue is thrown away when it reaches the front
+	unique_lock<mutex> lock(entry->lock);
+	entry->removed = true;
+	entry->condition.wait(lock, [&entry] { return !entry->running; });
+	lock.unlock();
+
+	arena->set_wake_callback(function<void()>());
+}
+
+void Arena_Scheduler::wake(Arena* arena) {
+	shared_ptr<scheduled_arena> entry;
+	{
+		lock_guard<mutex> guard(arenas_lock);
+		map<Arena*, shared_ptr<scheduled_arena>>::iterator itr = arenas.find(arena);
+		if (itr == arenas.end()) {
+			return;
+		}
+		entry = itr->second;
+	}
+
+	lock_guard<mutex> guard(entry->lock);
+	if (entry->removed) {
+		return;
+	}
+
+	// the worker running the arena queues it again as soon as its tick finishes
+	if (entry->running) {
+		entry->woken = true;
+		return;
+	}
+
+	// replaces any later task the arena already has
+	queue_arena(entry, chrono::steady_clock::now(), true);
+}
+
+frame_stats Arena_Scheduler::get_frame_stats() {
+	frame_stats total = frame_stats();
+
+	// an arena is only deleted once it has been removed, so it cannot go away while the lock is held
+	lock_guard<mutex> guard(arenas_lock);
+	for (pair<Arena* const, shared_ptr<scheduled_arena>>& entry : arenas) {
+		frame_stats stats = entry.first->frame_scheduler.get_stats();
+		total.frames += stats.frames;
+		total.late_frames += stats.late_frames;
+		total.skipped_frames += stats.skipped_frames;
+		total.total_lateness_us += stats.total_lateness_us;
+		total.max_lateness_us = max(total.max_lateness_us, stats.max_lateness_us);
+	}
+	return total;
+}
+
+int Arena_Scheduler::get_num_workers() {
+	return workers.size();
+}
+
+vector<worker_stats> Arena_Scheduler::get_stats() {
+	double elapsed_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start_time).count();
+
+	vector<worker_stats> stats;
+	for (unique_ptr<worker>& w : workers) {
+		worker_stats current;
+		current.ticks = w->ticks;
+		current.steals = w->steals;
+		current.busy_ns = w->busy_ns;
+		current.sleeps = w->sleeps;
+		current.utilization = (elapsed_ns > 0) ? current.busy_ns / elapsed_ns : 0.0;
+		stats.push_back(current);
+	}
+	return stats;
+}
+
+
+/*
+each worker runs every task that is due, earliest first, then sleeps until its next deadline
+the worker is marked idle before it last looks for a task to steal, so a task that becomes overdue
+on another worker after that signals it, and it looks again instead of sleeping
+*/
+void Arena_Scheduler::run_worker(int index) {
+	worker& self = *workers[index];
+	arena_task task;
+
+	while (running) {
+		{
+			lock_guard<mutex> guard(self.lock);
+			self.idle = true;
+			self.signalled = false;
+		}
+
+		if (take_task(index, task, chrono::steady_clock::now())) {
+			{
+				lock_guard<mutex> guard(self.lock);
+				self.idle = false;
+			}
+			run_task(index, task);
+			// release the arena now rather than holding it until the next task
+			task.entry.reset();
+			continue;
+		}
+
+		unique_lock<mutex> lock(self.lock);
+		// an empty queue sleeps until a task is added or the worker is signalled to steal one
+		drop_stale_tasks(self);
+		if (running && !self.signalled) {
+			self.sleeps.fetch_add(1, memory_order_relaxed);
+			if (self.tasks.empty()) {
+				self.condition.wait(lock, [this, &self] { return self.signalled || !running; });
+			} else {
+				// a copy, the queue can change while the worker sleeps
+				chrono::steady_clock::time_point deadline = self.tasks.top().deadline;
+				self.condition.wait_until(lock, deadline, [this, &self] { return self.signalled || !running; });
+			}
+		}
+		self.idle = false;
+	}
+}
+
+bool Arena_Scheduler::take_task(int index, arena_task& task, chrono::steady_clock::time_point now) {
+	worker& self = *workers[index];
+
+	{
+		lock_guard<mutex> guard(self.lock);
+		drop_stale_tasks(self);
+		if (!self.tasks.empty() && (self.tasks.top().deadline <= now)) {
+			task = self.tasks.top();
+			self.tasks.pop();
+			return true;
+		}
+	}
+
+	// nothing due here, look for an overdue task on the other workers, starting with the next one
+	for (int i = 1; i < (int) workers.size(); i++) {
+		worker& victim = *workers[(index + i) % workers.size()];
+
+		// skip a worker that is busy with its queue rather than waiting for it
+		unique_lock<mutex> lock(victim.lock, try_to_lock);
+		if (!lock.owns_lock()) {
+			continue;
+		}
+		drop_stale_tasks(victim);
+		if (!victim.tasks.empty() && (victim.tasks.top().deadline <= now)) {
+			task = victim.tasks.top();
+			victim.tasks.pop();
+			self.steals.fetch_add(1, memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Arena_Scheduler::run_task(int index, arena_task& task) {
+	shared_ptr<scheduled_arena>& entry = task.entry;
+
+	{
+		lock_guard<mutex> guard(entry->lock);
+		// the arena has been removed, or has been queued again since this task was added
+		if (entry->removed || (task.generation != entry->generation)) {
+			return;
+		}
+		entry->running = true;
+		// the arena is queued on this worker from now on
+		entry->worker = index;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	chrono::steady_clock::time_point next = entry->arena->tick(start);
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	worker& self = *workers[index];
+	self.ticks.fetch_add(1, memory_order_relaxed);
+	self.busy_ns.fetch_add(chrono::duration_cast<chrono::nanoseconds>(end - start).count(), memory_order_relaxed);
+
+	bool backlog = false;
+	{
+		lock_guard<mutex> guard(entry->lock);
+		entry->running = false;
+
+		if (entry->removed) {
+			// remove() is waiting for the tick to finish
+			entry->condition.notify_all();
+			return;
+		}
+
+		// woken up during the tick, it may have something to do right away
+		if (entry->woken) {
+			entry->woken = false;
+			next = end;
+		}
+
+		if (next != Arena::PARKED) {
+			// this worker is running, no need to wake it up
+			queue_arena(entry, next, false);
+		}
+	}
+
+	// more is due here than this worker can run right now, signal an idle worker to steal some of it
+	{
+		lock_guard<mutex> guard(self.lock);
+		drop_stale_tasks(self);
+		backlog = (self.tasks.size() > 1) && (self.tasks.top().deadline <= end);
+	}
+	if (backlog) {
+		signal_idle_worker(index);
+	}
+}
+
+void Arena_Scheduler::queue_arena(shared_ptr<scheduled_arena>& entry, chrono::steady_clock::time_point deadline,
+								  bool notify) {
+	entry->generation++;
+
+	arena_task task;
+	task.deadline = deadline;
+	task.entry = entry;
+	task.generation = entry->generation;
+
+	worker& w = *workers[entry->worker];
+	bool busy;
+	{
+		lock_guard<mutex> guard(w.lock);
+		// only wake the worker if this task is now the first on its queue
+		bool earliest = w.tasks.empty() || (deadline < w.tasks.top().deadline);
+		w.tasks.push(task);
+		busy = !w.idle;
+		if (notify && earliest) {
+			w.signalled = true;
+			w.condition.notify_one();
+		}
+	}
+
+	// the worker is in the middle of a tick, another one can run the arena now
+	if (notify && busy && (deadline <= chrono::steady_clock::now())) {
+		signal_idle_worker(entry->worker);
+	}
+}
+
+void Arena_Scheduler::drop_stale_tasks(worker& w) {
+	// the arena's latest task is checked again under its lock before it is run
+	while (!w.tasks.empty()) {
+		const arena_task& top = w.tasks.top();
+		if (!top.entry->removed && (top.generation == top.entry->generation)) {
+			break;
+		}
+		w.tasks.pop();
+	}
+}
+
+void Arena_Scheduler::signal_idle_worker(int index) {
+	for (int i = 1; i < (int) workers.size(); i++) {
+		worker& w = *workers[(index + i) % workers.size()];
+		lock_guard<mutex> guard(w.lock);
+		if (w.idle) {
+			// only one task is waiting to be stolen, the next signal goes to another worker
+			w.idle = false;
+			w.signalled = true;
+			w.condition.notify_one();
+			return;
+		}
+	}
+}
@@ -0,0 +1,172 @@
+/*
+Arena scheduler class header file
+Runs the ticks of every arena on a fixed pool of worker threads
+
+Chaos The Game
+
+Arenas do not have threads of their own. Each arena is ticked by whichever worker picks it up,
+and its tick returns when it next needs to run (see Arena::tick).
+	- each worker has its own queue of arenas ordered by deadline, and runs the earliest one
+	  once its deadline has passed
+	- an arena is put back on the queue of the worker that last ran it, so it tends to stay
+	  on the same core
+	- a worker with nothing due sleeps until its next deadline, or until it is signalled, it does not
+	  poll the other queues
+	- a worker that falls behind, or is busy when an arena it runs is woken up, signals an idle
+	  worker, which steals the overdue arenas, so one busy worker does not hold back its arenas
+	- a parked arena is not on any queue until it is woken up
+An arena is never ticked by two workers at once.
+*/
+
+#ifndef ARENA_SCHEDULER_H
+#define ARENA_SCHEDULER_H
+
+#include "arena.h"
+#include "frame_scheduler.h"
+
+#include <vector>
+#include <map>
+#include <queue>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+using namespace std;
+
+
+/*
+Statistics about one worker since the scheduler started.
+*/
+typedef struct worker_stats {
+	// number of ticks run
+	long long ticks;
+	// number of those ticks taken from another worker's queue
+	long long steals;
+	// number of times the worker went to sleep with nothing due
+	long long sleeps;
+	// total time spent running ticks (nanoseconds)
+	long long busy_ns;
+	// the fraction of the time since the scheduler started that was spent running ticks
+	double utilization;
+} worker_stats;
+
+
+class Arena_Scheduler {
+
+public:
+	// uses one worker for each core if num_workers is 0
+	Arena_Scheduler(int num_workers);
+	~Arena_Scheduler();
+
+	// starts the workers
+	void start();
+	// stops the workers and waits for them to finish their current ticks
+	void stop();
+
+	// adds an arena, its first tick runs right away
+	void add(Arena* arena);
+	// removes an arena, waits if it is being ticked, it is never ticked again
+	void remove(Arena* arena);
+	// ticks the arena as soon as possible, called by the arena when it has something to do
+	void wake(Arena* arena);
+
+	int get_num_workers();
+	// returns a copy of every worker's statistics, safe to call from any thread
+	vector<worker_stats> get_stats();
+	// the frame statistics of every arena the scheduler runs, added up, safe to call from any thread
+	// the maximum lateness is the largest of any arena
+	frame_stats get_frame_stats();
+
+private:
+	/*
+	an arena known to the scheduler
+	the lock orders what the workers and wake() do to the arena, it is always taken before a worker's lock
+	*/
+	struct scheduled_arena {
+		Arena* arena;
+		mutex lock;
+		// signalled when a tick finishes, remove() waits on it
+		condition_variable condition;
+		// true while a worker is running the arena's tick
+		bool running;
+		// set if the arena was woken up while its tick was running, it is ticked again right away
+		bool woken;
+		// set once the arena has been removed
+		// read without the lock to throw away the arena's tasks, once set it is never cleared
+		atomic<bool> removed;
+		// counts up every time the arena is put on a queue, only the latest task is run
+		// older tasks are left on their queues and thrown away when they reach the front
+		// read without the lock for the same reason, it only ever counts up
+		atomic<uint64_t> generation;
+		// the worker that last ran the arena, it is queued there again
+		int worker;
+	};
+
+	// a turn for an arena, at its deadline
+	struct arena_task {
+		chrono::steady_clock::time_point deadline;
+		shared_ptr<scheduled_arena> entry;
+		uint64_t generation;
+	};
+
+	// orders the queues so the earliest deadline is on top
+	struct later_deadline {
+		bool operator()(const arena_task& a, const arena_task& b) const {
+			return a.deadline > b.deadline;
+		}
+	};
+
+	struct worker {
+		mutex lock;
+		// signalled when an earlier task is added, or another worker has more due than it can run
+		condition_variable condition;
+		priority_queue<arena_task, vector<arena_task>, later_deadline> tasks;
+		// set while the worker has nothing due and is looking for work or asleep, only accessed
+		// while holding the worker's lock
+		bool idle;
+		// set when the worker is signalled, it looks for work again instead of going to sleep
+		bool signalled;
+		thread worker_thread;
+
+		// statistics, written by the worker and read by get_stats
+		atomic<long long> ticks;
+		atomic<long long> steals;
+		atomic<long long> busy_ns;
+		atomic<long long> sleeps;
+	};
+
+	vector<unique_ptr<worker>> workers;
+	// cleared to make the workers exit
+	atomic<bool> running;
+	// when the workers were started, used for utilization
+	chrono::steady_clock::time_point start_time;
+
+	// every arena that has been added and not removed
+	map<Arena*, shared_ptr<scheduled_arena>> arenas;
+	// used for locking access to the map of arenas
+	mutex arenas_lock;
+	// new arenas are spread across the workers
+	int next_worker;
+
+	// the loop each worker runs
+	void run_worker(int index);
+	// takes a task that is due from the worker's own queue, or steals one from another worker
+	bool take_task(int index, arena_task& task, chrono::steady_clock::time_point now);
+	// ticks the task's arena and puts it back on a queue if it has more to do
+	void run_task(int index, arena_task& task);
+	// puts the arena on a worker's queue, must be called while holding the arena's lock
+	void queue_arena(shared_ptr<scheduled_arena>& entry, chrono::steady_clock::time_point deadline, bool notify);
+	// throws away the tasks at the front of the worker's queue that will never run, must be called
+	// while holding the worker's lock
+	void drop_stale_tasks(worker& w);
+	// signals an idle worker other than the given one to steal an overdue task, if one is idle
+	// must not be called while holding a worker's lock
+	void signal_idle_worker(int index);
+
+};
+
+#endif
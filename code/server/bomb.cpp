@@ -22,6 +22,8 @@ Bomb::Bomb(int x, int y) : posX(x), posY(y) {
 	destroy_time = 10.0;
 	
 	start_time = chrono::system_clock::now();
+	
+	id = 0;
 }
 
 // nothing was created that must be deallocated
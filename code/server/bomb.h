@@ -9,6 +9,7 @@ Chaos The Game
 #define BOMB_H
 
 #include <chrono>
+#include <stdint.h>
 
 using namespace std;
 
@@ -47,6 +48,9 @@ public:
 	
 	// update the bomb each frame
 	void update();
+	
+	// identifies the bomb in binary snapshots, given by the bomb manager
+	uint16_t id;
 
 };
 
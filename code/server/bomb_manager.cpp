@@ -8,8 +8,9 @@ Chaos the Game
 #include "bomb_manager.h"
 
 #include "bomb.h"
+#include "object_pool.h"
 
-#include <set>
+#include <vector>
 #include <chrono>
 // used for random number generation
 #include <stdio.h>
@@ -17,8 +18,10 @@ Chaos the Game
 #include <time.h>
 
 
-Bomb_Manager::Bomb_Manager() {
+Bomb_Manager::Bomb_Manager() : bomb_pool(BOMB_CAPACITY) {
 	waiting_time = 3.0;
+	next_id = 0;
+	bombs.reserve(BOMB_CAPACITY);
 }
 
 Bomb_Manager::~Bomb_Manager() {
@@ -33,13 +36,19 @@ void Bomb_Manager::start() {
 
 // update each bomb and possibly create or destroy bombs
 void Bomb_Manager::update_bombs() {
-	for (Bomb* bomb : bombs) {
+	// the bombs that are kept are moved down over the destroyed ones, keeping their order
+	int kept = 0;
+	for (int i = 0; i < (int) bombs.size(); i++) {
+		Bomb* bomb = bombs[i];
 		bomb->update();
 		if (bomb->destroy) {
-			bombs.erase(bomb);
-			delete bomb;
+			bomb_pool.destroy(bomb);
+		} else {
+			bombs[kept] = bomb;
+			kept++;
 		}
 	}
+	bombs.resize(kept);
 	
 	chrono::time_point<chrono::system_clock> current = chrono::system_clock::now();
 	chrono::duration<double> elapsed_seconds;
@@ -75,21 +84,28 @@ void Bomb_Manager::update_bombs() {
 			}
 		}
 		
-		Bomb* bomb = new Bomb(x, y);
-		bombs.insert(bomb);
+		add_bomb(x, y);
 		
 		// update the timer
 		start_time += chrono::milliseconds((int) waiting_time * 1000);
 	}
 }
 
+Bomb* Bomb_Manager::add_bomb(int x, int y) {
+	Bomb* bomb = bomb_pool.create(x, y);
+	bomb->id = next_id++;
+	bombs.push_back(bomb);
+	return bomb;
+}
+
 // prepare for the arena to be reset and free memory
 void Bomb_Manager::clean_up() {
-	// remove each bomb from the set and delete the bomb object
+	// return each bomb to the pool, then empty the list
 	for (Bomb* bomb : bombs) {
-		bombs.erase(bomb);
-		delete bomb;
+		bomb_pool.destroy(bomb);
 	}
+	bombs.clear();
+	next_id = 0;
 }
 
 
@@ -9,8 +9,9 @@ Chaos the Game
 #define BOMB_MANAGER_H
 
 #include "bomb.h"
+#include "object_pool.h"
 
-#include <set>
+#include <vector>
 #include <chrono>
 // used for random number generation
 #include <stdio.h>
@@ -28,18 +29,30 @@ public:
 	
 	// start the timer and start creating bombs
 	void start();
-	// update each bomb in the set
+	// update each bomb in the list
 	void update_bombs();
+	// creates a bomb from the pool and adds it to the list
+	Bomb* add_bomb(int x, int y);
 	
 	// free memory and prepare for the arena to be reset
 	void clean_up();
 	
-	set<Bomb*> bombs;
+	// bombs last 10 seconds and one is created every 3, so only a few are alive at once
+	static const int BOMB_CAPACITY = 16;
+	// the bombs are created in the pool, declared before the list so it outlives it
+	Object_Pool<Bomb> bomb_pool;
+	// the live bombs, in the order they were created
+	vector<Bomb*> bombs;
 	
 	chrono::time_point<chrono::system_clock> start_time;
 	
 	// the amount of time to wait between creating bombs
 	double waiting_time;
+	
+	// the id given to the next bomb, starts again when the arena is reset
+	// the live bombs were created a few seconds apart, so their ids are a few numbers in a row and
+	// never repeat even after the ids wrap around
+	uint16_t next_id;
 
 };
 
@@ -0,0 +1,39 @@
+/*
+Broadcast file
+Frames a message once so the same buffer can be sent to every connection in an arena
+
+Chaos The Game
+*/
+
+#include "broadcast.h"
+
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+
+// builds a prepared frame around the payload, to be shared by every connection it is sent to
+broadcast_message::ptr frame_broadcast_message(string&& payload, websocketpp::frame::opcode::value opcode) {
+	uint64_t size = payload.size();
+	
+	// the message is not tied to any connection's message manager
+	broadcast_message::ptr message = make_shared<broadcast_message>(broadcast_message::con_msg_man_ptr(), opcode, 0);
+	
+	// take over the payload's buffer instead of copying it
+	message->get_raw_payload() = std::move(payload);
+	
+	// a single, final, unmasked, uncompressed frame
+	websocketpp::frame::basic_header header(opcode, size, true, false);
+	websocketpp::frame::extended_header extended_header(size);
+	message->set_header(websocketpp::frame::prepare_header(header, extended_header));
+	
+	// tells websocketpp that the message is already framed
+	message->set_prepared(true);
+	
+	return message;
+}
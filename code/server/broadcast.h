@@ -0,0 +1,31 @@
+/*
+Broadcast header file
+Frames a message once so the same buffer can be sent to every connection in an arena
+
+Chaos The Game
+*/
+
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+// this project uses the websocketpp library to handle WebSocket communication
+#include <websocketpp/server.hpp>
+// uses insecure websockets, proxy handles security with SSL
+#include <websocketpp/config/asio_no_tls.hpp>
+
+#include <string>
+
+using namespace std;
+
+// the websocketpp message type used by the server's connections
+typedef websocketpp::config::asio::message_type broadcast_message;
+
+
+/*
+Builds a complete, ready-to-send websocket frame around the payload, which is moved into the frame
+without being copied. Server frames are never masked, so the frame does not depend on the connection
+it is sent to, and websocketpp sends a prepared message as-is instead of framing its own copy.
+*/
+broadcast_message::ptr frame_broadcast_message(string&& payload, websocketpp::frame::opcode::value opcode);
+
+#endif
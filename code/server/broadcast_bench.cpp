@@ -0,0 +1,166 @@
+/*
+Broadcast benchmark
+
+Chaos The Game
+
+Compares the cost of sending one arena snapshot to many connections in two ways:
+	- per connection: what websocketpp does for send(handler, string, opcode), once for every
+	  connection; the payload is copied into a new message, then copied again into a framed message
+	- shared: the snapshot is framed once by frame_broadcast_message and the same message is
+	  handed to every connection
+Only the work done on the action thread is measured, no sockets are used. The messages are kept
+in a list for each connection, standing in for the connection's send queue.
+
+usage: ./broadcast_bench.out [broadcasts per run]
+*/
+
+#include "broadcast.h"
+#include "arena.h"
+#include "player.h"
+
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <utility>
+// used for printing
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+// the results of one run
+typedef struct broadcast_result {
+	// average time per broadcast (nanoseconds)
+	double ns;
+	// average payload and header bytes copied per broadcast
+	double bytes_copied;
+} broadcast_result;
+
+
+// builds a real snapshot from a full arena at the start of a game
+string make_snapshot() {
+	Arena arena;
+	vector<Player*> players;
+	for (int i = 0; i < Arena::MAX_PLAYERS; i++) {
+		players.push_back(new Player());
+		arena.add_player(players.back());
+	}
+
+	arena.setup();
+	string snapshot = arena.outgoing_queue.front().text;
+
+	arena.clean_up();
+	for (Player* player : players) {
+		delete player;
+	}
+	return snapshot;
+}
+
+// frames the snapshot separately for every connection, the way the server used to
+broadcast_result run_per_connection(const string& snapshot, int recipients, int broadcasts) {
+	vector<vector<broadcast_message::ptr>> send_queues(recipients);
+	long long bytes = 0;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	for (int b = 0; b < broadcasts; b++) {
+		// the gameserver copied the snapshot off the arena's outgoing queue
+		string message = snapshot;
+		bytes += message.size();
+
+		for (int r = 0; r < recipients; r++) {
+			// send(handler, string, opcode) copies the payload into a new message
+			broadcast_message::ptr msg = make_shared<broadcast_message>(broadcast_message::con_msg_man_ptr(),
+																		websocketpp::frame::opcode::text, message.size());
+			msg->set_payload(message);
+
+			// then frames it by copying the payload again into an outgoing message with a header
+			broadcast_message::ptr outgoing = make_shared<broadcast_message>(broadcast_message::con_msg_man_ptr(),
+																			 websocketpp::frame::opcode::text, message.size());
+			outgoing->set_payload(msg->get_payload());
+			websocketpp::frame::basic_header header(websocketpp::frame::opcode::text, message.size(), true, false);
+			websocketpp::frame::extended_header extended_header(message.size());
+			outgoing->set_header(websocketpp::frame::prepare_header(header, extended_header));
+			outgoing->set_prepared(true);
+
+			bytes += 2 * message.size() + outgoing->get_header().size();
+			send_queues[r].push_back(outgoing);
+		}
+
+		// the connections finish writing before the next frame
+		for (vector<broadcast_message::ptr>& send_queue : send_queues) {
+			send_queue.clear();
+		}
+	}
+
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	broadcast_result result;
+	result.ns = (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / broadcasts;
+	result.bytes_copied = (double) bytes / broadcasts;
+	return result;
+}
+
+// frames the snapshot once and shares it with every connection
+broadcast_result run_shared(const string& snapshot, int recipients, int broadcasts) {
+	vector<vector<broadcast_message::ptr>> send_queues(recipients);
+	long long bytes = 0;
+
+	// the arena produces a new snapshot string every frame, which the gameserver takes over
+	vector<string> snapshots(broadcasts, snapshot);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	for (int b = 0; b < broadcasts; b++) {
+		broadcast_message::ptr message = frame_broadcast_message(std::move(snapshots[b]), websocketpp::frame::opcode::text);
+		bytes += message->get_header().size();
+
+		for (int r = 0; r < recipients; r++) {
+			send_queues[r].push_back(message);
+		}
+
+		// the connections finish writing before the next frame
+		for (vector<broadcast_message::ptr>& send_queue : send_queues) {
+			send_queue.clear();
+		}
+	}
+
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	broadcast_result result;
+	result.ns = (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / broadcasts;
+	result.bytes_copied = (double) bytes / broadcasts;
+	return result;
+}
+
+
+int main(int argc, char** argv) {
+	int broadcasts = 2000;
+	if (argc > 1) {
+		broadcasts = atoi(argv[1]);
+	}
+	if (broadcasts <= 0) {
+		printf("usage: %s [broadcasts per run]\n", argv[0]);
+		return 1;
+	}
+
+	string snapshot = make_snapshot();
+	printf("snapshot of %zu bytes, %d broadcasts per run\n", snapshot.size(), broadcasts);
+	printf("%10s %18s %18s %18s %18s\n", "recipients", "per conn (ns)", "per conn (bytes)",
+		   "shared (ns)", "shared (bytes)");
+
+	int recipient_counts[] = {4, 64, 512};
+	for (int recipients : recipient_counts) {
+		broadcast_result per_connection = run_per_connection(snapshot, recipients, broadcasts);
+		broadcast_result shared = run_shared(snapshot, recipients, broadcasts);
+		printf("%10d %18.0f %18.0f %18.0f %18.0f\n", recipients, per_connection.ns, per_connection.bytes_copied,
+			   shared.ns, shared.bytes_copied);
+	}
+
+	return 0;
+}
@@ -0,0 +1,231 @@
+/*
+Broadphase benchmark
+
+Chaos The Game
+
+Keeps a set number of projectiles alive in an arena of four players with every wall rotating, and
+times the phases that check for collisions, for numbers of projectiles from 10 to 5000. With the
+grids, the time for each projectile should stay about the same however many there are.
+After every tick the grids are checked against every wall and player: any object the exact
+collision check finds touching a projectile must also have been found by the grid.
+
+usage: ./broadphase_bench.out [ticks per size]
+*/
+
+// include game files
+#include "arena.h"
+#include "player.h"
+#include "projectile.h"
+#include "wall.h"
+#include "wall_manager.h"
+#include "collisions.h"
+#include "spatial_grid.h"
+
+// include other dependencies
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <chrono>
+// used for printing and random number generation
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+// the numbers of live projectiles to run
+static const int PROJECTILE_COUNTS[] = {10, 50, 100, 500, 1000, 2000, 5000};
+
+
+class Broadphase_Bench {
+
+public:
+	Broadphase_Bench(int num_projectiles, int ticks);
+	~Broadphase_Bench();
+
+	// runs every tick, returns false if the grids missed a collision
+	bool run();
+	void print_results();
+
+private:
+	int num_projectiles;
+	int ticks;
+
+	Arena arena;
+	vector<Player*> players;
+
+	// total time (nanoseconds) in each timed phase
+	long long player_ns;
+	long long projectile_ns;
+	long long wall_ns;
+	// the number of collisions the check looked for the grids to find
+	long long checked_hits;
+
+	// top up the projectiles, put killed players back, and keep every wall rotating
+	void prepare_tick();
+	// checks that the grids find everything touching each projectile
+	bool check_grids();
+
+};
+
+
+Broadphase_Bench::Broadphase_Bench(int num_projectiles, int ticks) : num_projectiles(num_projectiles), ticks(ticks) {
+	player_ns = 0;
+	projectile_ns = 0;
+	wall_ns = 0;
+	checked_hits = 0;
+
+	for (int i = 0; i < Arena::MAX_PLAYERS; i++) {
+		Player* player = new Player();
+		arena.add_player(player);
+		players.push_back(player);
+	}
+}
+
+Broadphase_Bench::~Broadphase_Bench() {
+	// the arena does not own its players, the server normally deletes them
+	arena.clean_up();
+	for (Player* player : players) {
+		delete player;
+	}
+}
+
+bool Broadphase_Bench::run() {
+	arena.setup();
+	arena.outgoing_queue.clear();
+	bool correct = true;
+
+	for (int tick = 0; tick < ticks; tick++) {
+		prepare_tick();
+		arena.process_messages();
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		arena.update_player_positions();
+		chrono::steady_clock::time_point players_done = chrono::steady_clock::now();
+		arena.update_projectiles();
+		chrono::steady_clock::time_point projectiles_done = chrono::steady_clock::now();
+		arena.update_walls();
+		chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+		player_ns += chrono::duration_cast<chrono::nanoseconds>(players_done - start).count();
+		projectile_ns += chrono::duration_cast<chrono::nanoseconds>(projectiles_done - players_done).count();
+		wall_ns += chrono::duration_cast<chrono::nanoseconds>(end - projectiles_done).count();
+
+		if (!check_grids()) {
+			correct = false;
+		}
+	}
+
+	return correct;
+}
+
+void Broadphase_Bench::print_results() {
+	double player = (double) player_ns / ticks;
+	double projectile = (double) projectile_ns / ticks;
+	double wall = (double) wall_ns / ticks;
+	printf("%-12d %16.0f %16.0f %16.0f %16.1f %12lld\n", num_projectiles, player, projectile, wall,
+		   (projectile + wall) / num_projectiles, checked_hits);
+}
+
+void Broadphase_Bench::prepare_tick() {
+	const int corners[4][2] = {{140, 160}, {820, 480}, {140, 480}, {820, 160}};
+
+	for (Player* player : arena.dead_players) {
+		int i = rand() % 4;
+		player->posX = corners[i][0];
+		player->posY = corners[i][1];
+		player->rotation = 0;
+		arena.arena_players.insert(player);
+	}
+	arena.dead_players.clear();
+
+	// the players drive in circles
+	for (Player* player : arena.arena_players) {
+		arena.add_to_incoming_queue(player, "1,1,0");
+	}
+
+	while (arena.projectiles.size() < num_projectiles) {
+		arena.projectiles.add(Projectile(rand() % 900 + 30, rand() % 580 + 30, rand() % 360, 0));
+	}
+
+	// send every wall rotating, turning it around once it reaches its target
+	Wall_Manager& manager = arena.wall_manager;
+	for (Wall* wall : manager.unrotated_walls) {
+		manager.rotating_walls.push_back(wall);
+	}
+	manager.unrotated_walls.clear();
+	for (Wall* wall : manager.finished_rotating_walls) {
+		wall->target_rotation = (wall->target_rotation == 0) ? 90 : 0;
+		wall->rotationVel = -wall->rotationVel;
+		manager.rotating_walls.push_back(wall);
+	}
+	manager.finished_rotating_walls.clear();
+}
+
+bool Broadphase_Bench::check_grids() {
+	bool correct = true;
+
+	// the grids as update_projectiles fills them, with the walls and players where they are now
+	arena.fill_wall_grid();
+	for (Player* player : arena.arena_players) {
+		player->reset_temp_vars();
+		player->update_rectangle_points();
+	}
+	arena.fill_player_grid();
+
+	Projectile projectile;
+	for (int i = 0; i < arena.projectiles.size(); i++) {
+		arena.projectiles.get(i, projectile);
+		grid_box box = circle_box(projectile.posX, projectile.posY, Arena::PROJECTILE_REACH);
+
+		arena.wall_grid.query(box, arena.nearby_walls);
+		for (Wall* wall : arena.wall_manager.walls) {
+			// a projectile touching a wall
+			if (Collisions::wall_ball_collision(&projectile, wall, false) != 0) {
+				checked_hits++;
+				if (find(arena.nearby_walls.begin(), arena.nearby_walls.end(), wall) == arena.nearby_walls.end()) {
+					correct = false;
+				}
+			}
+		}
+
+		arena.player_grid.query(box, arena.nearby_players);
+		for (Player* player : arena.arena_players) {
+			if (Collisions::ball_player_collision(&projectile, player->body)) {
+				checked_hits++;
+				if (find(arena.nearby_players.begin(), arena.nearby_players.end(), player) == arena.nearby_players.end()) {
+					correct = false;
+				}
+			}
+		}
+	}
+
+	return correct;
+}
+
+
+int main(int argc, char** argv) {
+	int ticks = 200;
+	if (argc > 1) {
+		ticks = atoi(argv[1]);
+	}
+	if (ticks <= 0) {
+		printf("usage: %s [ticks per size]\n", argv[0]);
+		return 1;
+	}
+
+	bool correct = true;
+	printf("%-12s %16s %16s %16s %16s %12s\n", "projectiles", "players ns/tick", "shots ns/tick", "walls ns/tick",
+		   "ns/projectile", "hits");
+	for (int num_projectiles : PROJECTILE_COUNTS) {
+		Broadphase_Bench bench(num_projectiles, ticks);
+		if (!bench.run()) {
+			correct = false;
+		}
+		bench.print_results();
+	}
+
+	printf("\n%s\n", correct ? "the grids found every collision" : "CHECK FAILED: the grids missed a collision");
+	return correct ? 0 : 1;
+}
@@ -12,6 +12,7 @@ Chaos the Game
 #include "point_vect_struct.h"
 #include "wall.h"
 #include "bomb.h"
+#include "rotation_table.h"
 
 #include <iostream>
 #include <vector>
@@ -30,25 +31,26 @@ Collisions::~Collisions() {
 }
 
 // check for collision between two polygons using separating axis theorem
-bool Collisions::polygon_collision(Polygon a, Polygon b) {
-	vector<Polygon> polygons = {a, b};
+bool Collisions::polygon_collision(const Polygon& a, const Polygon& b) {
+	const Polygon* polygons[2] = {&a, &b};
 	
-	for (Polygon polygon : polygons) {
+	for (const Polygon* polygon : polygons) {
 		// iterate over each point and connect to the next point to check each edge
-		for (int i1 = 0; i1 < polygon.points.size(); i1++) {
-			int i2 = (i1 + 1) % polygon.points.size();
+		for (int i1 = 0; i1 < polygon->num_points; i1++) {
+			int i2 = (i1 + 1) % polygon->num_points;
 			
-			point p1 = polygon.points[i1];
-			point p2 = polygon.points[i2];
+			point p1 = polygon->points[i1];
+			point p2 = polygon->points[i2];
 			
 			// find the vector normal to the edge
 			vect normal(p2.y - p1.y, p1.x - p2.x);
 			
 			// find the projection of each point in both polygons onto the normal vector
 			double minA = numeric_limits<double>::max();
-			double maxA = numeric_limits<double>::min();
+			double maxA = numeric_limits<double>::lowest();
 			
-			for (point p : a.points) {
+			for (int i = 0; i < a.num_points; i++) {
+				point p = a.points[i];
 				double projection = (normal.x * p.x) + (normal.y * p.y);
 				
 				if (projection < minA) {
@@ -61,9 +63,10 @@ bool Collisions::polygon_collision(Polygon a, Polygon b) {
 			
 			
 			double minB = numeric_limits<double>::max();
-			double maxB = numeric_limits<double>::min();
+			double maxB = numeric_limits<double>::lowest();
 			
-			for (point p : b.points) {
+			for (int i = 0; i < b.num_points; i++) {
+				point p = b.points[i];
 				double projection = (normal.x * p.x) + (normal.y * p.y);
 				
 				if (projection < minB) {
@@ -86,13 +89,13 @@ bool Collisions::polygon_collision(Polygon a, Polygon b) {
 }
 
 // check for a collision between a ball and a player
-bool Collisions::ball_player_collision(Projectile* ball, Polygon polygon) {
+bool Collisions::ball_player_collision(const Projectile* ball, const Polygon& polygon) {
 	point circle(ball->posX, ball->posY);
 	return circle_player_collision(circle, ball->RADIUS, polygon);
 }
 
 // check for a collision between a bomb and a player
-bool Collisions::bomb_player_collision(Bomb* bomb, Polygon polygon) {
+bool Collisions::bomb_player_collision(const Bomb* bomb, const Polygon& polygon) {
 	if (bomb->warning_mode) {
 		return false;
 	}
@@ -101,14 +104,14 @@ bool Collisions::bomb_player_collision(Bomb* bomb, Polygon polygon) {
 }
 
 // used for ball-player collisions and bomb-player collisions
-bool Collisions::circle_player_collision(point circle, int radius, Polygon polygon) {
+bool Collisions::circle_player_collision(point circle, int radius, const Polygon& polygon) {
 	// find the location of the point after the entire frame has been rotated
+	double sine = Rotation_Table::sine(polygon.rect_rot);
+	double cosine = Rotation_Table::cosine(polygon.rect_rot);
 	point unrotated_circle;
-	unrotated_circle.x = (cos(polygon.rect_rot * (M_PI / 180)) * (circle.x - polygon.center.x)) -
-						 (sin(polygon.rect_rot * (M_PI / 180)) * (circle.y - polygon.center.y)) +
+	unrotated_circle.x = (cosine * (circle.x - polygon.center.x)) - (sine * (circle.y - polygon.center.y)) +
 						 polygon.center.x;
-	unrotated_circle.y = (sin(polygon.rect_rot * (M_PI / 180)) * (circle.x - polygon.center.x)) +
-						 (cos(polygon.rect_rot * (M_PI / 180)) * (circle.y - polygon.center.y)) +
+	unrotated_circle.y = (sine * (circle.x - polygon.center.x)) + (cosine * (circle.y - polygon.center.y)) +
 						 polygon.center.y;
 	
 	// calculate a reference point on the rectangle
@@ -150,7 +153,7 @@ bool Collisions::circle_player_collision(point circle, int radius, Polygon polyg
 1 - collision with body, signal not to rotate wall (only used for wall rotations)
 2 - collision with end, signal to delete projectile
 */
-int Collisions::wall_ball_collision(Projectile* ball, Wall* wall, bool deflect) {
+int Collisions::wall_ball_collision(Projectile* ball, const Wall* wall, bool deflect) {
 	
 	// check for collision with rectangle
 	
@@ -181,7 +184,7 @@ int Collisions::wall_ball_collision(Projectile* ball, Wall* wall, bool deflect)
 1 - collision that is not on an endpoint, deflect the ball
 2 - collision on endpoint, delete the ball
 */
-int Collisions::line_circle_collision(point a, point b, Projectile* ball) {
+int Collisions::line_circle_collision(point a, point b, const Projectile* ball) {
 	// calculate the length of the line
 	int dx = b.x - a.x;
 	int dy = b.y - a.y;
@@ -221,6 +224,198 @@ int Collisions::line_circle_collision(point a, point b, Projectile* ball) {
 	}
 }
 
+/*
+helpers for the swept collisions
+a moving point is inside a shape from an enter time to a leave time, which can be before time 0
+*/
+
+// narrows the times to when the point is between low and high along one axis
+static inline void slab_interval(double position, double velocity, double low, double high, double& enter,
+								 double& leave) {
+	if (velocity == 0) {
+		if ((position < low) || (position > high)) {
+			// never between them
+			enter = HUGE_VAL;
+			leave = - HUGE_VAL;
+		}
+		return;
+	}
+	double to_low = (low - position) / velocity;
+	double to_high = (high - position) / velocity;
+	enter = max(enter, min(to_low, to_high));
+	leave = min(leave, max(to_low, to_high));
+}
+
+// narrows the times to when the point is within radius of the center, false if it never is
+static inline bool circle_interval(vect start, vect velocity, double centerX, double centerY, double radius,
+								   double& enter, double& leave) {
+	vect center_to_start((start.x - centerX), (start.y - centerY));
+	// solve |center_to_start + (velocity * t)| = radius for t
+	double a = Collisions::dot_product(velocity, velocity);
+	double b = Collisions::dot_product(center_to_start, velocity);
+	double c = Collisions::dot_product(center_to_start, center_to_start) - (radius * radius);
+	if (a == 0) {
+		return c <= 0;
+	}
+	double discriminant = (b * b) - (a * c);
+	if (discriminant < 0) {
+		return false;
+	}
+	double root = sqrt(discriminant);
+	enter = max(enter, (- b - root) / a);
+	leave = min(leave, (- b + root) / a);
+	return true;
+}
+
+// the first time from 0 up to max_time that is between enter and leave, false if there is none
+static inline bool first_time(double enter, double leave, double max_time, double& time) {
+	if ((enter > leave) || (leave < 0) || (enter > max_time)) {
+		return false;
+	}
+	time = max(enter, 0.0);
+	return true;
+}
+
+// the time a moving circle first touches one end of a line, beyond the line on the side outward points to
+// sliding is set when the circle reaches the end by sliding off the body, at that time it is still on the body
+static bool swept_end_collision(point end, vect outward, vect start, vect velocity, int radius, double max_time,
+								double& time, bool& sliding) {
+	double enter = - HUGE_VAL;
+	double leave = HUGE_VAL;
+	if (!circle_interval(start, velocity, end.x, end.y, radius, enter, leave)) {
+		return false;
+	}
+
+	// the distance past the end, along the line, changes at a steady rate
+	double beyond = ((start.x - end.x) * outward.x) + ((start.y - end.y) * outward.y);
+	double speed = Collisions::dot_product(velocity, outward);
+	sliding = false;
+	if (speed == 0) {
+		if (beyond <= 0) {
+			return false;
+		}
+	} else if (speed > 0) {
+		double crossing = - beyond / speed;
+		sliding = (beyond <= 0) && (crossing >= enter);
+		// a circle that only touches the end as it slides off the body is touching the body
+		if (sliding && (leave <= crossing)) {
+			return false;
+		}
+		enter = max(enter, crossing);
+	} else {
+		// a circle on the end moving back along the line is touching the body, not the end
+		if (beyond <= 0) {
+			return false;
+		}
+		leave = min(leave, - beyond / speed);
+	}
+	return first_time(enter, leave, max_time, time);
+}
+
+// find the time a moving circle first touches a line
+/* return values
+0 - no contact before max_time
+1 - contact that is not on an endpoint, deflect the ball at time
+2 - contact on an endpoint, delete the ball at time
+3 - the ball slides off the body onto an endpoint, delete the ball just after time, so anything else
+	that happens at time happens first
+*/
+int Collisions::swept_line_circle_collision(point a, point b, vect start, vect velocity, int radius, double max_time,
+											double& time) {
+	vect line((b.x - a.x), (b.y - a.y));
+	vect a_to_start((start.x - a.x), (start.y - a.y));
+	double length_squared = dot_product(line, line);
+	int ret = 0;
+
+	// the distance from the line changes at a steady rate, so the circle reaches it radius away at one time
+	vect normal = calculate_unit_normal_vector(line);
+	double distance = dot_product(a_to_start, normal);
+	double speed = dot_product(velocity, normal);
+	if ((distance * speed) < 0) {
+		double t = max((abs(distance) - radius) / abs(speed), 0.0);
+		// the closest point on the line at that time must be within the line segment
+		double along = (dot_product(a_to_start, line) + (t * dot_product(velocity, line))) / length_squared;
+		if ((t <= max_time) && (along >= 0) && (along <= 1)) {
+			time = t;
+			ret = 1;
+		}
+	}
+
+	// past either end, the circle touches the endpoint instead, the body is touched first on a tie
+	double end_time;
+	bool sliding;
+	if (swept_end_collision(a, vect(- line.x, - line.y), start, velocity, radius, max_time, end_time, sliding) &&
+		((ret == 0) || (end_time < time))) {
+		time = end_time;
+		ret = sliding ? 3 : 2;
+	}
+	if (swept_end_collision(b, line, start, velocity, radius, max_time, end_time, sliding) &&
+		((ret == 0) || (end_time < time))) {
+		time = end_time;
+		ret = sliding ? 3 : 2;
+	}
+
+	return ret;
+}
+
+// find the time a moving circle first touches a player's rectangle
+bool Collisions::swept_circle_player_collision(vect start, vect velocity, int radius, const Polygon& polygon,
+											   double max_time, double& time) {
+	// turn the path with the frame until the rectangle is upright, the same as circle_player_collision
+	double sine = Rotation_Table::sine(polygon.rect_rot);
+	double cosine = Rotation_Table::cosine(polygon.rect_rot);
+	vect unrotated_start;
+	unrotated_start.x = (cosine * (start.x - polygon.center.x)) - (sine * (start.y - polygon.center.y)) +
+						polygon.center.x;
+	unrotated_start.y = (sine * (start.x - polygon.center.x)) + (cosine * (start.y - polygon.center.y)) +
+						polygon.center.y;
+	vect unrotated_velocity((cosine * velocity.x) - (sine * velocity.y), (sine * velocity.x) + (cosine * velocity.y));
+
+	double left = polygon.center.x - (polygon.rect_width / 2);
+	double top = polygon.center.y - (polygon.rect_height / 2);
+	double right = left + polygon.rect_width;
+	double bottom = top + polygon.rect_height;
+
+	/*
+	the circle touches the rectangle while its center is inside the rectangle grown by the radius with
+	rounded corners, which is the rectangle grown sideways, the rectangle grown up and down, and a circle
+	around each corner, the first of these it enters is the first touch
+	*/
+	bool touches = false;
+	double enter, leave, t;
+
+	enter = - HUGE_VAL;
+	leave = HUGE_VAL;
+	slab_interval(unrotated_start.x, unrotated_velocity.x, left - radius, right + radius, enter, leave);
+	slab_interval(unrotated_start.y, unrotated_velocity.y, top, bottom, enter, leave);
+	if (first_time(enter, leave, max_time, t)) {
+		time = t;
+		touches = true;
+	}
+
+	enter = - HUGE_VAL;
+	leave = HUGE_VAL;
+	slab_interval(unrotated_start.x, unrotated_velocity.x, left, right, enter, leave);
+	slab_interval(unrotated_start.y, unrotated_velocity.y, top - radius, bottom + radius, enter, leave);
+	if (first_time(enter, leave, max_time, t) && (!touches || (t < time))) {
+		time = t;
+		touches = true;
+	}
+
+	double corners[4][2] = {{left, top}, {right, top}, {right, bottom}, {left, bottom}};
+	for (int i = 0; i < 4; i++) {
+		enter = - HUGE_VAL;
+		leave = HUGE_VAL;
+		if (circle_interval(unrotated_start, unrotated_velocity, corners[i][0], corners[i][1], radius, enter, leave) &&
+			first_time(enter, leave, max_time, t) && (!touches || (t < time))) {
+			time = t;
+			touches = true;
+		}
+	}
+
+	return touches;
+}
+
 // check if a point is within the bounding rectangle of a line segment
 bool Collisions::is_within_segment(point line1, point line2, point p) {
 	int xMin, xMax;
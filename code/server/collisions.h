@@ -23,27 +23,47 @@ public:
 	Collisions();
 	~Collisions();
 	
+	// polygons are passed by reference and projectiles, walls and bombs by pointer, so no check copies or
+	// allocates anything
+	
 	// check for collision between two polygons using separating axis theorem
-	static bool polygon_collision(Polygon a, Polygon b);
+	static bool polygon_collision(const Polygon& a, const Polygon& b);
 	
 	// check for collision between ball and wall
-	static int wall_ball_collision(Projectile* ball, Wall* wall, bool deflect);
+	static int wall_ball_collision(Projectile* ball, const Wall* wall, bool deflect);
 	
 	// calculate the new velocity vector of a ball after colliding with a wall
 	static void calculate_deflection(Projectile* ball, vect wall_vect);
 	
 	// check for collision between ball and player, calls circle_player_collision
-	static bool ball_player_collision(Projectile* ball, Polygon polygon);
+	static bool ball_player_collision(const Projectile* ball, const Polygon& polygon);
 	
 	// check for collision between bomb and player, calls circle_player_collision
-	static bool bomb_player_collision(Bomb* bomb, Polygon polygon);
+	static bool bomb_player_collision(const Bomb* bomb, const Polygon& polygon);
 	
 	// check for collision between circle (projectile or bomb) and player
-	static bool circle_player_collision(point circle, int radius, Polygon polygon);
+	static bool circle_player_collision(point circle, int radius, const Polygon& polygon);
 	
 	// check for collision between a line and a ball
-	static int line_circle_collision(point a, point b, Projectile* ball);
-	
+	static int line_circle_collision(point a, point b, const Projectile* ball);
+
+	/*
+	swept collisions, for a circle moving from start along velocity, a step of velocity for each unit of time
+	each finds the time the circle first touches the object, from 0 up to max_time, so a projectile is taken
+	through a frame in one move instead of a check after every step
+	a circle that already touches the object touches it at time 0
+	*/
+
+	// find the time a moving circle first touches a line, the return values are the same as line_circle_collision,
+	// and 3 for a circle sliding off the body onto an end, which is deleted just after the time
+	// a circle only touches the body of the line while moving towards it, so once deflected it moves away freely
+	static int swept_line_circle_collision(point a, point b, vect start, vect velocity, int radius, double max_time,
+										   double& time);
+
+	// find the time a moving circle first touches a player's rectangle
+	static bool swept_circle_player_collision(vect start, vect velocity, int radius, const Polygon& polygon,
+											  double max_time, double& time);
+
 	// check if a point is within the bounding rectangle of a line segment
 	static bool is_within_segment(point line1, point line2, point p);
 	
@@ -0,0 +1,90 @@
+/*
+Frame scheduler class file
+Keeps the deadlines of a game's frames a fixed frame time apart, and records how late each frame starts
+
+Chaos The Game
+*/
+
+#include "frame_scheduler.h"
+
+#include <chrono>
+#include <mutex>
+
+using namespace std;
+
+
+Frame_Scheduler::Frame_Scheduler(int frame_time_ms) {
+	frame_time = chrono::milliseconds(frame_time_ms);
+	
+	stats.frames = 0;
+	stats.late_frames = 0;
+	stats.skipped_frames = 0;
+	stats.total_lateness_us = 0;
+	stats.max_lateness_us = 0;
+}
+
+// nothing to deallocate
+Frame_Scheduler::~Frame_Scheduler() {
+
+}
+
+// sets the deadline of the first frame
+void Frame_Scheduler::start(chrono::steady_clock::time_point now) {
+	deadline = now + frame_time;
+}
+
+// the steady clock is used since it cannot jump if the system time is changed
+chrono::steady_clock::time_point Frame_Scheduler::next_deadline() {
+	return deadline;
+}
+
+/*
+the deadlines are always a whole number of frames apart, so the frame rate does not drift
+	- if the previous frame finished early, the next one is run at its deadline
+	- if it overran, the next deadline has already passed, so the next frame runs right away and
+	  the game catches up over the next few frames
+	- if it is too far behind to catch up, drop the missed frames and start counting again from now
+*/
+void Frame_Scheduler::begin_frame(chrono::steady_clock::time_point current) {
+	long long lateness_us = chrono::duration_cast<chrono::microseconds>(current - deadline).count();
+	
+	// find how many whole frames have been missed
+	long long frames_behind = (current - deadline) / frame_time;
+	
+	{
+		lock_guard<mutex> guard(stats_lock);
+		stats.frames++;
+		stats.total_lateness_us += lateness_us;
+		if (lateness_us > stats.max_lateness_us) {
+			stats.max_lateness_us = lateness_us;
+		}
+		if (lateness_us > 1000) {
+			stats.late_frames++;
+		}
+		if (frames_behind > MAX_CATCH_UP_FRAMES) {
+			stats.skipped_frames += frames_behind;
+		}
+	}
+	
+	if (frames_behind > MAX_CATCH_UP_FRAMES) {
+		// too far behind, skip ahead so the next frame is one frame from now
+		deadline += frame_time * frames_behind;
+	}
+	
+	deadline += frame_time;
+}
+
+// returns a copy of the statistics
+frame_stats Frame_Scheduler::get_stats() {
+	lock_guard<mutex> guard(stats_lock);
+	return stats;
+}
+
+// the average lateness of every frame (milliseconds)
+double Frame_Scheduler::average_lateness_ms() {
+	frame_stats current = get_stats();
+	if (current.frames == 0) {
+		return 0.0;
+	}
+	return (double) current.total_lateness_us / current.frames / 1000;
+}
@@ -0,0 +1,71 @@
+/*
+Frame scheduler class header file
+Keeps the deadlines of a game's frames a fixed frame time apart, and records how late each frame starts
+
+Chaos The Game
+*/
+
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <chrono>
+#include <mutex>
+
+using namespace std;
+
+
+/*
+Statistics about how closely the frames have kept to their deadlines.
+Lateness is how long after its deadline a frame was started.
+*/
+typedef struct frame_stats {
+	// number of frames started
+	long long frames;
+	// number of frames that started more than a millisecond after their deadline
+	long long late_frames;
+	// number of frames dropped after falling too far behind
+	long long skipped_frames;
+	// the sum and the maximum of the lateness of every frame (microseconds)
+	long long total_lateness_us;
+	long long max_lateness_us;
+} frame_stats;
+
+
+class Frame_Scheduler {
+
+public:
+	Frame_Scheduler(int frame_time_ms);
+	~Frame_Scheduler();
+	
+	// the furthest behind (in frames) the loop can fall before frames are skipped instead of caught up
+	static const int MAX_CATCH_UP_FRAMES = 4;
+	
+	// sets the deadline of the first frame to one frame after now
+	void start(chrono::steady_clock::time_point now);
+	
+	// the time the next frame should start
+	chrono::steady_clock::time_point next_deadline();
+	
+	// records that the next frame has started at now and moves the deadline on to the frame after it
+	void begin_frame(chrono::steady_clock::time_point now);
+	
+	// returns a copy of the statistics, safe to call from another thread
+	frame_stats get_stats();
+	
+	// the average lateness of every frame (milliseconds)
+	double average_lateness_ms();
+
+private:
+	// the time between frames
+	chrono::steady_clock::duration frame_time;
+	
+	// the time the next frame should start
+	chrono::steady_clock::time_point deadline;
+	
+	frame_stats stats;
+	// used for locking access to the statistics
+	mutex stats_lock;
+
+};
+
+#endif
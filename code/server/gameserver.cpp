@@ -21,16 +21,21 @@ to port 8080, where this program is listening.
 #include "gameserver.h"
 
 // include other server files
-#include "arena.h"
-#include "player.h"
-#include "message_struct.h"
+#include "action_shard.h"
+#include "matchmaker.h"
+#include "shard_placement.h"
+#include "snapshot.h"
+#include "server_config.h"
+#include "arena_scheduler.h"
 
 // include other dependencies
 #include <iostream>
 #include <string>
-#include <set>
-#include <map>
-#include <mutex>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <stdint.h>
 
 using namespace std;
 
@@ -43,14 +48,35 @@ using websocketpp::lib::placeholders::_2;
 using websocketpp::lib::bind;
 
 
-// handled all activity associated with an arena thread
-void run_arena_thread(Arena* arena);
-
-
 // constructor, initializes server and sets callback functions
-gameserver::gameserver() {
-	// signals that arenas should not be acted upon until they have been fully set up
-	arenas_ready = false;
+gameserver::gameserver(const server_config& config) : m_scheduler(config.worker_threads) {
+	// hardware_concurrency returns 0 if the number of cores is unknown
+	io_threads = config.io_threads;
+	if (io_threads <= 0) {
+		io_threads = max(1, (int) thread::hardware_concurrency());
+	}
+	
+	/*
+	one shard for each I/O thread, the arenas kept running are split evenly between them
+	the placement gives each new connection a seat in whichever shard's arena opened first, and the shards
+	take the arenas they grow by from the same maximum, so players are matched across every shard
+	a shard only has work while it runs an arena, so there are never more shards than max_arenas, the
+	other I/O threads only carry websocket traffic
+	*/
+	int num_shards = min(io_threads, config.max_arenas);
+	m_placement.reset(new Shard_Placement(num_shards, config.max_arenas));
+	for (int i = 0; i < num_shards; i++) {
+		int shard_min = config.min_arenas / num_shards + ((i < config.min_arenas % num_shards) ? 1 : 0);
+		// the object pools are sized for an even share of the pool, a busier shard allocates the rest
+		int shard_share = config.max_arenas / num_shards + ((i < config.max_arenas % num_shards) ? 1 : 0);
+		m_shards.push_back(unique_ptr<Action_Shard>(new Action_Shard(m_server, m_scheduler, *m_placement, i, shard_min,
+																	 shard_share, config.idle_timeout_s)));
+	}
+	
+	// the statistics cover the whole server, so only the first shard's action loop logs them
+	if (config.stats_interval_s > 0) {
+		m_shards[0]->set_stats_callback(bind(&gameserver::log_stats, this), config.stats_interval_s);
+	}
 	
 	// initialize boost::asio connection functionality
 	m_server.init_asio();
@@ -63,270 +89,167 @@ gameserver::gameserver() {
 	m_server.set_open_handler(bind(&gameserver::on_open, this, ::_1));
 	m_server.set_close_handler(bind(&gameserver::on_close, this, ::_1));
 	m_server.set_message_handler(bind(&gameserver::on_message, this, ::_1, ::_2));
+	m_server.set_validate_handler(bind(&gameserver::on_validate, this, ::_1));
 }
 
 // destructor
 gameserver::~gameserver() {
-	// empty all data structures
+	// no arena can be ticked while the shards delete them
+	m_scheduler.stop();
 	
-	while (!m_actions.empty()) {
-		m_actions.pop();
-	}
-	
-	while (arenas.size() > 0) {
-		Arena* arena = arenas[0];
-		arenas.erase(arenas.begin());
-		delete arena;
+	// each shard stops its action loop and deletes its arenas and players
+	m_shards.clear();
+}
+
+// callback function for the opening handshake, before the connection is created
+// accepts a binary snapshot subprotocol if the client requested one
+bool gameserver::on_validate(connection_hdl handler) {
+	server::connection_ptr con = m_server.get_con_from_hdl(handler);
+	
+	// prefer the newest format the client supports
+	bool version_1 = false;
+	bool version_2 = false;
+	for (const string& protocol : con->get_requested_subprotocols()) {
+		if (protocol == BINARY_SNAPSHOT_PROTOCOL_1) {
+			version_1 = true;
+		} else if (protocol == BINARY_SNAPSHOT_PROTOCOL_2) {
+			version_2 = true;
+		}
 	}
 	
-	for (connection_hdl handler : m_connections) {
-		remove_connection(handler);
+	if (version_2) {
+		con->select_subprotocol(BINARY_SNAPSHOT_PROTOCOL_2);
+	} else if (version_1) {
+		con->select_subprotocol(BINARY_SNAPSHOT_PROTOCOL_1);
 	}
 	
-	arena_players_map.clear();
-	
-	m_player_map.clear();
+	// every connection is accepted, clients that did not ask for binary are sent text
+	return true;
 }
 
 // callback function for when a new connection is created
-// signals for a new player to be created and added to an arena
+// the placement picks the arena the player will join and pins the connection to the shard that owns it,
+// then signals that shard to create a player and add it to the arena
 void gameserver::on_open(connection_hdl handler) {
-	// locks the action queue so an action can be pushed
-	websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_action_lock);
-	m_actions.push(action(CONNECT, handler));
+	int shard = m_placement->connect(handler);
+	m_shards[shard]->push_action(action(CONNECT, handler));
 }
 
 // callback function for when a connection is closed
+// every event of a connection is queued on the shard it was pinned to, in the order websocketpp delivers them
 void gameserver::on_close(connection_hdl handler) {
-	// locks the action queue so an action can be pushed
-	websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_action_lock);
-	m_actions.push(action(DISCONNECT, handler));
+	int shard = m_placement->disconnect(handler);
+	if (shard >= 0) {
+		m_shards[shard]->push_action(action(DISCONNECT, handler));
+	}
 }
 
 // callback function for when a message is received by the server
 // creates a message struct and adds the message to the message queue of the appropriate arena
 void gameserver::on_message(connection_hdl handler, server::message_ptr message) {
-	// locks the action queue so an action can be pushed
-	websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_action_lock);
-	m_actions.push(action(MESSAGE, handler, message));
+	int shard = m_placement->find(handler);
+	if (shard >= 0) {
+		m_shards[shard]->push_action(action(MESSAGE, handler, message));
+	}
 }
 
 // starts the server
 // the port is a 16 bit integer (0 to 65535)
 void gameserver::run(uint16_t port) {
-	// arena should be created before listening begins, in case of an immediate connection
-	// create the arena to be run in the thread
-	for (int i = 0; i < num_arenas; i++) {
-		Arena* arena = new Arena();
-		connection_list arena_connections;
-		arena_players_map.insert(pair<Arena*, connection_list>(arena, arena_connections));
-		arenas.push_back(arena);
-	}
+	// the workers run the arenas' ticks, an arena does nothing until a player joins
+	m_scheduler.start();
 	
-	arenas_ready = true;
-	
-	// create a new thread for each arena
-	thread a0(run_arena_thread, arenas[0]);
-	thread a1(run_arena_thread, arenas[1]);
-	thread a2(run_arena_thread, arenas[2]);
+	// arenas should be created before listening begins, in case of an immediate connection
+	for (unique_ptr<Action_Shard>& shard : m_shards) {
+		shard->start();
+	}
 	
 	// begin listening for connections on the port given
 	m_server.listen(port);
 	// begin accepting connections
 	m_server.start_accept();
-	// begin the main event loop
-	m_server.run();
-	
-	a2.join();
-	a1.join();
-	a0.join();
 	
-}
-
-/*
-the main event loop of the server
-runs in a separate thread from the event listeners
-sends out all messages in the outgoing queue, then processes actions from the action queue
-*/
-void gameserver::process_actions() {
-	while (true) {
-		
-		// each iteration, send all messages before processing any action
-		send_messages();
-		
-		// if there are no actions to be taken, continue to the next iteration
-		// cannot wait for the condition to be notified because then outgoing messages
-		// 		would be delayed until a new message is received
-		if (m_actions.empty()) {
-			continue;
-		}
-		
-		// locks the action queue
-		websocketpp::lib::unique_lock<websocketpp::lib::mutex> lock(m_action_lock);
-		
-		// pop the top action off the queue
-		action a = m_actions.front();
-		m_actions.pop();
-		
-		// release the lock to the action queue
-		lock.unlock();
-		
-		// handle each type of action
-		if (a.type == CONNECT) {
-			// adds a new player
-			add_connection(a.handler);
-		} else if (a.type == DISCONNECT) {
-			// removes a player
-			remove_connection(a.handler);
-		} else if (a.type == MESSAGE) {
-			// route an incoming message to the appropriate arena
-			process_incoming_message(a.handler, a.message);
-		}
+	// run the main event loop on every I/O thread, this thread is one of them
+	// websocketpp keeps the events of each connection in order, even across threads
+	vector<thread> threads;
+	for (int i = 1; i < io_threads; i++) {
+		threads.push_back(thread([this]() { m_server.run(); }));
 	}
-}
-
-// adds the new connection to the list of connections, creates a player, and assigns the player to the arena
-void gameserver::add_connection(connection_hdl handler) {
-	// locks the connections list so one can be added
-	{
-		websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_connection_lock);
-		// add the connection handler to the set of connections
-		m_connections.insert(handler);
+	m_server.run();
+	for (thread& io_thread : threads) {
+		io_thread.join();
 	}
 	
-	// create a new player identifier
-	player_id* new_player = new player_id;
-	
-	// add a new player object to the identifier
-	new_player->player = new Player();
-	
-	// add the connection handler and the player identifier to the map of players
-	m_player_map.insert(pair<connection_hdl, player_id*>(handler, new_player));
-	
-	// assign the player to an arena, fills the parent_arena field in the playeridentifier
-	assign_to_arena(new_player, handler);
-}
-
-// removes the connection from the list of connections
-// will need to do more once there are multiple arenas
-void gameserver::remove_connection(connection_hdl handler) {
-	// locks the connections list so one can be removed
-	{
-		websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_connection_lock);
-		// remove a connection from the list
-		m_connections.erase(handler);
+	// the shards stop sending before the arenas stop ticking
+	for (unique_ptr<Action_Shard>& shard : m_shards) {
+		shard->stop();
 	}
-	
-	// deletes the player
-	player_id* player_id = m_player_map[handler];
-	player_id->parent_arena->remove_player(player_id->player);
-	player_id->parent_arena = NULL;
-	delete player_id->player;
-	delete player_id;
-}
-
-// receives a new message and sends the message to the arena
-void gameserver::process_incoming_message(connection_hdl handler, server::message_ptr message) {
-	// creates a new message struct
-	message_struct* msg = new message_struct;
-	
-	// connect the message with the player that sent it, based on player's connection handler
-	msg->player = m_player_map[handler]->player;
-	
-	// set the message text to the body of the received message
-	msg->message_text = message->get_payload();
-	
-	// add the message to the arena's message queue
-	// the arena handles locking
-	m_player_map[handler]->parent_arena->add_to_incoming_queue(msg);
+	m_scheduler.stop();
 }
 
-
-// sends a message from the arena to all members of the arena
-void gameserver::send_messages() {
-	// ensures the arenas are not accessed until they have been properly set up
-	if (!arenas_ready) {
-		return;
-	}
-	
-	for (Arena* arena : arenas) {
-		// check if the arena's game has finished and needs to be reset
-		// exists here because the arena's connection list cannot be accessed from static method
-		if (arena->ready_to_reset) {
-			reset_arena(arena);
-			continue;
-		}
-		
-		// lock the arena outgoing queue
-		arena->lock_mutex();
-		
-		// send all messages in the queue
-		while (!arena->outgoing_queue.empty()) {
-			// pop the top message off the queue
-			string message = arena->outgoing_queue.front();
-			arena->outgoing_queue.pop();
-			
-			// send message to all connections in the arena
-			for (connection_hdl handler : arena_players_map[arena]) {
-				try {
-					// sends the message to the player, sets opcode to 1 for text data
-					m_server.send(handler, message, websocketpp::frame::opcode::value(1));
-				} catch (exception e) {
-					// error sending message
-				}
-			}
-		}
-		
-		// release the arena lock
-		arena->unlock_mutex();
-	}
+// statistics for each of the scheduler's workers, safe to call from any thread
+vector<worker_stats> gameserver::get_worker_stats() {
+	return m_scheduler.get_stats();
 }
 
-
-// adds a new player to the arena, locking is handled by the arena
-void gameserver::assign_to_arena(player_id* new_player, connection_hdl handler) {
-	// check for first open arena
-	for (Arena* arena : arenas) {
-		if (arena->add_player(new_player->player)) {
-			// assigns the arena to the player identifier
-			new_player->parent_arena = arena;
-
-			// locks the connections list so one can be added
-			{
-				websocketpp::lib::lock_guard<websocketpp::lib::mutex> guard(m_connection_lock);
-				// add the connection handler to the set of connections
-				arena_players_map[arena].insert(handler);
-			}
-			
-			// added to an arena, do not add to multiple arenas
-			break;
-		}
+// matchmaking statistics for the whole server, safe to call from any thread
+// the queue depth and open arenas are the current totals, the peak depth is the sum of each shard's peak
+matchmaking_stats gameserver::get_matchmaking_stats() {
+	matchmaking_stats total = matchmaking_stats();
+	for (unique_ptr<Action_Shard>& shard : m_shards) {
+		matchmaking_stats stats = shard->get_matchmaking_stats();
+		total.matches += stats.matches;
+		total.queue_depth += stats.queue_depth;
+		total.max_queue_depth += stats.max_queue_depth;
+		total.open_arenas += stats.open_arenas;
+		total.total_wait_us += stats.total_wait_us;
+		total.max_wait_us = max(total.max_wait_us, stats.max_wait_us);
 	}
+	return total;
 }
 
-// prepares the arena for a new game
-// clears the connection list for the arena
-void gameserver::reset_arena(Arena* arena) {
-	// removes each connection from the arena
-	arena_players_map[arena].clear();
+// frame statistics of every arena the scheduler runs, safe to call from any thread
+frame_stats gameserver::get_frame_stats() {
+	return m_scheduler.get_frame_stats();
 }
 
-
-// function to run the arena thread
-void run_arena_thread(Arena* arena) {
-	// calls the arenas start loop, will begin game loop when ready
-	arena->start();
+// writes the statistics to standard output, one line for the arenas and the matchmakers and one for each worker
+// called from the first shard's action loop, every stats interval
+void gameserver::log_stats() {
+	frame_stats frames = get_frame_stats();
+	matchmaking_stats matching = get_matchmaking_stats();
+	vector<worker_stats> workers = get_worker_stats();
+	
+	double average_lateness_ms = (frames.frames > 0) ? (double) frames.total_lateness_us / frames.frames / 1000 : 0.0;
+	double average_wait_ms = (matching.matches > 0) ? (double) matching.total_wait_us / matching.matches / 1000 : 0.0;
+	cout << "stats: " << frames.frames << " frames, " << frames.late_frames << " late, " << frames.skipped_frames
+		 << " skipped, lateness " << average_lateness_ms << " ms average " << frames.max_lateness_us / 1000.0
+		 << " ms max; " << matching.matches << " players placed, " << matching.queue_depth << " waiting (peak "
+		 << matching.max_queue_depth << "), " << matching.open_arenas << " arenas open, time to match "
+		 << average_wait_ms << " ms average " << matching.max_wait_us / 1000.0 << " ms max" << endl;
+	for (int i = 0; i < (int) workers.size(); i++) {
+		cout << "stats: worker " << i << ": " << workers[i].ticks << " ticks, " << workers[i].steals << " stolen, "
+			 << workers[i].sleeps << " sleeps, " << workers[i].utilization * 100 << "% busy" << endl;
+	}
 }
 
 
-int main() {
+int main(int argc, char** argv) {
+	// read the settings from the command line and the config file
+	server_config config;
+	string error;
+	if (!load_server_config(argc, argv, config, error)) {
+		cerr << error << endl;
+		cerr << "usage: " << argv[0] << " [--config <path>] [--min-arenas <n>] [--max-arenas <n>] "
+			 << "[--idle-timeout <seconds>] [--workers <n>] [--io-threads <n>] [--port <n>] "
+			 << "[--stats-interval <seconds>]" << endl;
+		return 1;
+	}
+	
 	// create the game server
-	gameserver gs;
-	// create a new thread to perform actions loaded onto the action queue
-	websocketpp::lib::thread action_thread(bind(&gameserver::process_actions, &gs));
+	gameserver gs(config);
 	// run the main event loop on the server to listen for events
-	gs.run(8080);
-	// end the action processing thread when the server stops running
-	action_thread.join();
+	// each shard runs its own thread to perform the actions loaded onto its action queue
+	gs.run(config.port);
 }
 
@@ -6,6 +6,12 @@ Chaos The Game
 This server will accept WebSocket connections from multiple clients and allow
 the clients to communicate with each other by displaying messages sent from any
 individual one.
+
+The websocketpp event loop runs on several I/O threads at once. Connections are split between
+shards (see action_shard.h). The shard placement (see shard_placement.h) picks the arena a new
+connection joins, out of every shard's arenas, and pins the connection to the shard that owns it,
+so the I/O threads only meet on the placement's lock when a connection opens or closes, and on a
+shard's lock-free action queue.
 */
 
 #ifndef GAMESERVER_H
@@ -17,124 +23,60 @@ individual one.
 #include <websocketpp/config/asio_no_tls.hpp>
 
 // include other server files
-#include "arena.h"
-#include "player.h"
-#include "message_struct.h"
+#include "action_shard.h"
+#include "shard_placement.h"
+#include "server_config.h"
+#include "arena_scheduler.h"
 
 // include other dependencies
 #include <iostream>
 #include <string>
-#include <set>
-#include <map>
-#include <mutex>
+#include <vector>
+#include <memory>
 
 using namespace std;
 
 // connection handler
 using websocketpp::connection_hdl;
 
-// defines the server type used by websocketpp
-typedef websocketpp::server<websocketpp::config::asio> server;
-// defines the type of the set of connections
-typedef set<connection_hdl, owner_less<connection_hdl>> connection_list;
-
-
-/*
-This is a struct to contain a player and the arena it belongs to.
-Used in the map of connection handlers to players, allows for efficient routing of
-incoming messages to the corresponding arena (since map find() is log(n) complexity).
-*/
-typedef struct player_id {
-	// a pointer to the player object that is used in the arena
-	Player* player;
-	// a pointer to the arena that the player belongs to
-	Arena* parent_arena;
-} player_id;
-
-
-// the different types of actions the server can perform
-enum action_type {
-	CONNECT,
-	DISCONNECT,
-	MESSAGE
-};
-
-/*
-A struct for an individual action that the server can take
-Constructors only initialize values
-*/
-struct action {
-	// constructor for connect and disconnect actions
-	action(action_type t, connection_hdl h) : type(t), handler(h) {}
-	// constructor for incoming and outgoing messages
-	action(action_type t, connection_hdl h, server::message_ptr m)
-		: type(t), handler(h), message(m) {}
-	
-	// the action to be taken
-	action_type type;
-	// the unique identifier of the player to communicate with
-	connection_hdl handler;
-	// the message, if it is a message action
-	server::message_ptr message;
-};
-
 
 class gameserver {
 
 public:
-	gameserver();
+	gameserver(const server_config& config);
 	~gameserver();
 	
 	// callback functions
+	bool on_validate(connection_hdl handler);
 	void on_open(connection_hdl handler);
 	void on_close(connection_hdl handler);
 	void on_message(connection_hdl handler, server::message_ptr message);
 	
-	// runs the main server loop
+	// runs the main server loop on every I/O thread, returns once the server stops
 	void run(uint16_t port);
 	
-	// assigns a new player to the arena
-	void assign_to_arena(player_id* new_player, connection_hdl handler);
-	
-	// action loop, runs in separate thread from listener event loop
-	void process_actions();
-	
-	// add a player to the list of connections and add to an arena
-	void add_connection(connection_hdl handler);
-	// remove a player from the list of connections
-	void remove_connection(connection_hdl handler);
-	// route received messages to the arena
-	void process_incoming_message(connection_hdl handler, server::message_ptr message);
-	// send messages that have been added to the arena's outgoing message queue
-	void send_messages();
-	
-	// after an arena's game has terminated, reset the arena to prepare for a new game
-	void reset_arena(Arena* arena);
+	// statistics for each of the scheduler's workers
+	vector<worker_stats> get_worker_stats();
+	// matchmaking statistics, added up over every shard
+	matchmaking_stats get_matchmaking_stats();
+	// how late the frames of every running arena have been, added up
+	frame_stats get_frame_stats();
+	// writes the worker, matchmaking and frame statistics to the log
+	void log_stats();
 	
 
 private:
-	// the main websocketpp server object
+	// the main websocketpp server object, shared by every I/O thread
 	server m_server;
-	// the list of all currently open connections
-	connection_list m_connections;
-	// number of arenas to run simulataneously
-	static const int num_arenas = 3;
-	// the arena for the game, only one for now, will become a group of arenas later
-	vector<Arena*> arenas;
-	// a map of arenas to the players in the arena
-	map<Arena*, connection_list> arena_players_map;
-	// signals that the message processor is ready to go
-	bool arenas_ready;
-	// a map of connection identifiers to a struct containing players and their arena
-	// allows an incoming message to be efficiently routed to the appropriate arena
-	map<connection_hdl, player_id*, owner_less<connection_hdl>> m_player_map;
-	
-	// action queue, added to by listeners and processed by action loop
-	queue<action> m_actions;
-	// used for locking access to the action queue
-	websocketpp::lib::mutex m_action_lock;
-	// used for locking access to the connection list
-	websocketpp::lib::mutex m_connection_lock;
+	// runs the ticks of every arena on a fixed pool of worker threads
+	Arena_Scheduler m_scheduler;
+	// the number of threads running the websocketpp event loop
+	int io_threads;
+	// picks the shard of each connection, created before the shards, which publish their seats to it
+	unique_ptr<Shard_Placement> m_placement;
+	// one shard for each I/O thread, up to one for each arena the pool can grow to,
+	// each with its own action loop, connections, arenas and matchmaker
+	vector<unique_ptr<Action_Shard>> m_shards;
 
 };
 
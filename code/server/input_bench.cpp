@@ -0,0 +1,323 @@
+/*
+Input parser benchmark
+
+Chaos The Game
+
+Checks and times parse_input_message, which decodes the input messages sent by the clients.
+	- fuzzing: millions of random and mutated messages are decoded three ways: by the parser,
+	  by a simple reference written from the message format, and by the old decoder
+	  (boost::split and stoi). The parser must agree with the reference on every message, and
+	  every message it accepts must decode to the same values with the old decoder. The program
+	  fails on the first disagreement.
+	- timing: a million messages shaped like the ones the client sends are decoded by the parser
+	  and by the old decoder, and the average time and heap allocations per message are printed
+
+usage: ./input_bench.out [fuzzed messages]
+*/
+
+// include game files
+#include "input_parser.h"
+#include "message_struct.h"
+
+// include other dependencies
+#include <string>
+#include <vector>
+#include <chrono>
+#include <new>
+#include <exception>
+// used for printing and random number generation
+#include <stdio.h>
+#include <stdlib.h>
+
+// include boost string splitter, only for the old decoder
+#include <boost/algorithm/string.hpp>
+
+using namespace std;
+
+
+/*
+allocation counting, the same as the arena benchmark
+every call into the global allocator made by this program goes through these operators
+*/
+
+// total number of allocations since the program started
+static unsigned long allocation_count = 0;
+
+void* operator new(size_t size) {
+	allocation_count++;
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
+
+
+// the number of messages timed, standing in for a recording of client input
+static const int TIMED_MESSAGES = 1000000;
+
+
+// the way Arena::add_to_incoming_queue used to decode a message
+bool legacy_decode(const string& message_text, message_struct& msg) {
+	// the container to be used for the pieces of data in the message
+	vector<string> data;
+	// split the message at each comma to obtain individual values to be used
+	boost::split(data, message_text, boost::is_any_of(","));
+	
+	// malformed messages are dropped
+	if (data.size() < 3) {
+		return false;
+	}
+	try {
+		msg.rotationVel = stoi(data[0]);
+		msg.vel = stoi(data[1]);
+		msg.fire = (stoi(data[2]) == 1);
+	} catch (exception& e) {
+		return false;
+	}
+	return true;
+}
+
+/*
+decodes a message by following the format in input_parser.h one character at a time
+slow, but simple enough to check by reading
+*/
+bool reference_decode(const string& text, message_struct& msg) {
+	const int minimum[3] = {-1, -1, 0};
+	const int maximum[3] = {1, 1, 1};
+	int values[3];
+	size_t position = 0;
+	
+	for (int field = 0; field < 3; field++) {
+		if (field > 0) {
+			if ((position >= text.size()) || (text[position] != ',')) {
+				return false;
+			}
+			position++;
+		}
+		
+		bool negative = false;
+		if ((position < text.size()) && ((text[position] == '+') || (text[position] == '-'))) {
+			negative = (text[position] == '-');
+			position++;
+		}
+		
+		// accumulate in a wide type so huge values are still seen as out of range
+		long long value = 0;
+		int digits = 0;
+		while ((position < text.size()) && (text[position] >= '0') && (text[position] <= '9')) {
+			if (value < 1000) {
+				value = value * 10 + (text[position] - '0');
+			}
+			position++;
+			digits++;
+		}
+		if (digits == 0) {
+			return false;
+		}
+		if ((position < text.size()) && (text[position] != ',')) {
+			return false;
+		}
+		
+		if (negative) {
+			value = -value;
+		}
+		if ((value < minimum[field]) || (value > maximum[field])) {
+			return false;
+		}
+		values[field] = value;
+	}
+	
+	msg.rotationVel = values[0];
+	msg.vel = values[1];
+	msg.fire = (values[2] == 1);
+	return true;
+}
+
+
+// the characters random messages are made of, mostly ones that appear in real messages
+static const char ALPHABET[] = ",,,,----++0000111122223456789  \tx.e";
+
+// a message the client could send
+string random_valid_message() {
+	string message = to_string(rand() % 3 - 1) + "," + to_string(rand() % 3 - 1) + "," + to_string(rand() % 2);
+	// version 2 clients add the tick they have acknowledged
+	if (rand() % 2 == 0) {
+		message += "," + to_string(rand());
+	}
+	return message;
+}
+
+// a message for the fuzzer, either random characters or a client message with a few mistakes
+string random_fuzz_message() {
+	int kind = rand() % 4;
+	
+	if (kind == 0) {
+		string message;
+		int length = rand() % 16;
+		for (int i = 0; i < length; i++) {
+			message += ALPHABET[rand() % (sizeof(ALPHABET) - 1)];
+		}
+		return message;
+	}
+	
+	string message = random_valid_message();
+	if (kind == 1) {
+		// unchanged
+		return message;
+	}
+	if (kind == 2) {
+		// values far outside the allowed range, some too big for an int
+		const char* huge[] = {"2", "-2", "10", "2147483647", "-2147483648", "2147483648", "99999999999999999999",
+							  "001", "-0", "+1", "+-1"};
+		int field = rand() % 3;
+		size_t start = 0;
+		for (int i = 0; i < field; i++) {
+			start = message.find(',', start) + 1;
+		}
+		size_t end = message.find(',', start);
+		if (end == string::npos) {
+			end = message.size();
+		}
+		return message.substr(0, start) + huge[rand() % 11] + message.substr(end);
+	}
+	
+	// insert, delete, or replace a few characters
+	int edits = rand() % 3 + 1;
+	for (int i = 0; i < edits; i++) {
+		size_t position = message.empty() ? 0 : rand() % (message.size() + 1);
+		char c = ALPHABET[rand() % (sizeof(ALPHABET) - 1)];
+		int edit = rand() % 3;
+		if (edit == 0) {
+			message.insert(message.begin() + position, c);
+		} else if ((edit == 1) && (position < message.size())) {
+			message.erase(position, 1);
+		} else if (position < message.size()) {
+			message[position] = c;
+		}
+	}
+	return message;
+}
+
+bool same_values(const message_struct& a, const message_struct& b) {
+	return (a.rotationVel == b.rotationVel) && (a.vel == b.vel) && (a.fire == b.fire);
+}
+
+// returns false and prints the message on the first disagreement
+bool fuzz(int messages) {
+	long long accepted = 0;
+	
+	for (int i = 0; i < messages; i++) {
+		string message = random_fuzz_message();
+		
+		message_struct parsed = {0, 7, 7, false};
+		message_struct reference = {0, 7, 7, false};
+		message_struct legacy = {0, 7, 7, false};
+		bool parser_accepts = parse_input_message(message, parsed);
+		bool reference_accepts = reference_decode(message, reference);
+		bool legacy_accepts = legacy_decode(message, legacy);
+		
+		if (parser_accepts != reference_accepts) {
+			printf("parser %s \"%s\", the reference %s it\n", parser_accepts ? "accepts" : "rejects",
+				   message.c_str(), reference_accepts ? "accepts" : "rejects");
+			return false;
+		}
+		if (parser_accepts && !same_values(parsed, reference)) {
+			printf("parser and the reference decode \"%s\" differently\n", message.c_str());
+			return false;
+		}
+		if (parser_accepts && (!legacy_accepts || !same_values(parsed, legacy))) {
+			printf("parser accepts \"%s\", which the old decoder %s\n", message.c_str(),
+				   legacy_accepts ? "decodes differently" : "rejects");
+			return false;
+		}
+		// rejected messages must leave the struct alone
+		if (!parser_accepts && ((parsed.rotationVel != 7) || (parsed.vel != 7))) {
+			printf("parser changed the struct while rejecting \"%s\"\n", message.c_str());
+			return false;
+		}
+		
+		if (parser_accepts) {
+			accepted++;
+		}
+	}
+	
+	printf("fuzzing: %d messages agree, %lld accepted and %lld rejected\n", messages, accepted,
+		   messages - accepted);
+	return true;
+}
+
+// times one decoder over every message, prints the average time and allocations
+template <typename F>
+void time_decoder(const char* name, const vector<string>& messages, F decode) {
+	long long accepted = 0;
+	message_struct msg;
+	unsigned long allocations = allocation_count;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	for (const string& message : messages) {
+		if (decode(message, msg)) {
+			accepted++;
+		}
+	}
+	
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+	double ns = (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / messages.size();
+	double allocs = (double) (allocation_count - allocations) / messages.size();
+	printf("%-16s %12.1f %14.2f %12lld\n", name, ns, allocs, accepted);
+}
+
+
+int main(int argc, char** argv) {
+	int messages = 2000000;
+	if (argc > 1) {
+		messages = atoi(argv[1]);
+	}
+	if (messages <= 0) {
+		printf("usage: %s [fuzzed messages]\n", argv[0]);
+		return 1;
+	}
+	
+	srand(1);
+	if (!fuzz(messages)) {
+		return 1;
+	}
+	
+	// the messages a client sends as its keys go up and down, with a few broken ones mixed in
+	vector<string> recorded;
+	recorded.reserve(TIMED_MESSAGES);
+	for (int i = 0; i < TIMED_MESSAGES; i++) {
+		if (rand() % 100 == 0) {
+			recorded.push_back(random_fuzz_message());
+		} else {
+			recorded.push_back(random_valid_message());
+		}
+	}
+	
+	printf("\n%d messages\n", TIMED_MESSAGES);
+	printf("%-16s %12s %14s %12s\n", "decoder", "ns/message", "allocs/message", "accepted");
+	time_decoder("boost::split", recorded, legacy_decode);
+	time_decoder("from_chars", recorded, parse_input_message);
+	
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+Input parser file
+Decodes the input messages sent by the clients
+
+Chaos The Game
+*/
+
+#include "input_parser.h"
+#include "message_struct.h"
+
+#include <string>
+#include <charconv>
+
+using namespace std;
+
+
+// the allowed range of each value, in the order they are sent
+static const int FIELD_MIN[INPUT_FIELDS] = {-1, -1, 0};
+static const int FIELD_MAX[INPUT_FIELDS] = {1, 1, 1};
+
+/*
+reads one value starting at first, which must be followed by a comma or the end of the message
+from_chars does not accept a leading '+', so it is skipped here
+*/
+static bool parse_field(const char*& first, const char* last, int& value) {
+	if ((first != last) && (*first == '+')) {
+		first++;
+		// "+-1" is not a number
+		if ((first != last) && (*first == '-')) {
+			return false;
+		}
+	}
+	
+	from_chars_result result = from_chars(first, last, value);
+	if ((result.ec != errc()) || (result.ptr == first)) {
+		return false;
+	}
+	if ((result.ptr != last) && (*result.ptr != ',')) {
+		return false;
+	}
+	
+	first = result.ptr;
+	return true;
+}
+
+bool parse_input_message(const string& text, message_struct& msg) {
+	const char* position = text.data();
+	const char* last = text.data() + text.size();
+	int values[INPUT_FIELDS];
+	
+	for (int i = 0; i < INPUT_FIELDS; i++) {
+		// every value after the first follows a comma
+		if (i > 0) {
+			if ((position == last) || (*position != ',')) {
+				return false;
+			}
+			position++;
+		}
+		
+		if (!parse_field(position, last, values[i])) {
+			return false;
+		}
+		if ((values[i] < FIELD_MIN[i]) || (values[i] > FIELD_MAX[i])) {
+			return false;
+		}
+	}
+	
+	msg.rotationVel = values[0];
+	msg.vel = values[1];
+	msg.fire = (values[2] == 1);
+	return true;
+}
@@ -0,0 +1,34 @@
+/*
+Input parser header file
+Decodes the input messages sent by the clients
+
+Chaos The Game
+
+An input message is the text "rotation,velocity,space", for example "1,-1,0":
+	- rotation: -1, 0, or 1, the direction to turn
+	- velocity: -1, 0, or 1, forward or backward
+	- space: 1 while the space bar is held down, 0 otherwise
+Each value is an integer with an optional sign and nothing else around it. Clients may add
+more values after the third (version 2 clients add the tick they have acknowledged), those
+are left for whoever needs them.
+*/
+
+#ifndef INPUT_PARSER_H
+#define INPUT_PARSER_H
+
+#include "message_struct.h"
+
+#include <string>
+
+using namespace std;
+
+
+// the number of values every input message must start with
+static const int INPUT_FIELDS = 3;
+
+// decodes the first three values of an input message into msg, does not set the player slot
+// returns false without changing msg if a value is missing, malformed, or out of range
+// never allocates or throws
+bool parse_input_message(const string& text, message_struct& msg);
+
+#endif
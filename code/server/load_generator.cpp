@@ -0,0 +1,163 @@
+/*
+Load generator
+
+Chaos The Game
+
+Opens many websocket connections to a running gameserver and has each of them send input the
+way a browser client would, while counting every message that comes back. After the run, the
+messages sent and received each second are printed, which is how far the server kept up.
+Every connection joins an arena like a real player, so the server should be started with
+enough arenas for all of them (--min-arenas or --max-arenas of at least connections / 4).
+
+usage: ./load_generator.out [uri] [connections] [threads] [input interval ms] [seconds]
+*/
+
+// the client side of the websocketpp library
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+
+// include other dependencies
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+// used for printing
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+// defines the client type used by websocketpp
+typedef websocketpp::client<websocketpp::config::asio_client> client;
+
+using websocketpp::connection_hdl;
+
+
+// the sockets of every connection, run on all of the threads
+client load_client;
+// the time between input messages on each connection (milliseconds)
+int input_interval_ms = 50;
+
+// counters shared by every thread
+atomic<long long> opened(0);
+atomic<long long> failed(0);
+atomic<long long> sent(0);
+atomic<long long> received(0);
+// cleared once the run is over, connections stop sending
+atomic<bool> running(true);
+
+
+// sends one input message and schedules the next one
+// the values change every message so the server has new input to act on
+void send_input(connection_hdl handler, int count) {
+	if (!running) {
+		return;
+	}
+
+	int rotation = (count % 3) - 1;
+	int velocity = ((count / 3) % 3) - 1;
+	int shooting = (count / 9) % 2;
+	string message = to_string(rotation) + "," + to_string(velocity) + "," + to_string(shooting);
+
+	websocketpp::lib::error_code ec;
+	load_client.send(handler, message, websocketpp::frame::opcode::text, ec);
+	if (ec) {
+		// the connection has closed
+		return;
+	}
+	sent.fetch_add(1, memory_order_relaxed);
+
+	load_client.set_timer(input_interval_ms, [handler, count](const websocketpp::lib::error_code& timer_ec) {
+		if (!timer_ec) {
+			send_input(handler, count + 1);
+		}
+	});
+}
+
+
+int main(int argc, char** argv) {
+	string uri = "ws://localhost:8080";
+	int num_connections = 400;
+	int num_threads = 1;
+	int seconds = 10;
+	if (argc > 1) {
+		uri = argv[1];
+	}
+	if (argc > 2) {
+		num_connections = atoi(argv[2]);
+	}
+	if (argc > 3) {
+		num_threads = atoi(argv[3]);
+	}
+	if (argc > 4) {
+		input_interval_ms = atoi(argv[4]);
+	}
+	if (argc > 5) {
+		seconds = atoi(argv[5]);
+	}
+	if ((num_connections <= 0) || (num_threads <= 0) || (input_interval_ms <= 0) || (seconds <= 0)) {
+		printf("usage: %s [uri] [connections] [threads] [input interval ms] [seconds]\n", argv[0]);
+		return 1;
+	}
+
+	// logging every frame would cost more than the load itself
+	load_client.clear_access_channels(websocketpp::log::alevel::all);
+	load_client.clear_error_channels(websocketpp::log::elevel::all);
+	load_client.init_asio();
+
+	load_client.set_open_handler([](connection_hdl handler) {
+		opened.fetch_add(1, memory_order_relaxed);
+		send_input(handler, 0);
+	});
+	load_client.set_fail_handler([](connection_hdl) {
+		failed.fetch_add(1, memory_order_relaxed);
+	});
+	load_client.set_message_handler([](connection_hdl, client::message_ptr) {
+		received.fetch_add(1, memory_order_relaxed);
+	});
+
+	for (int i = 0; i < num_connections; i++) {
+		websocketpp::lib::error_code ec;
+		client::connection_ptr con = load_client.get_connection(uri, ec);
+		if (ec) {
+			printf("could not connect to %s: %s\n", uri.c_str(), ec.message().c_str());
+			return 1;
+		}
+		load_client.connect(con);
+	}
+
+	printf("%d connections to %s on %d threads, input every %d ms, for %d seconds\n", num_connections, uri.c_str(),
+		   num_threads, input_interval_ms, seconds);
+
+	// the counters are read once every connection has had time to open
+	chrono::steady_clock::time_point start;
+	long long start_sent = 0;
+	long long start_received = 0;
+	load_client.set_timer(1000, [&](const websocketpp::lib::error_code&) {
+		start = chrono::steady_clock::now();
+		start_sent = sent;
+		start_received = received;
+	});
+	load_client.set_timer(1000 + seconds * 1000, [](const websocketpp::lib::error_code&) {
+		running = false;
+		load_client.stop();
+	});
+
+	vector<thread> threads;
+	for (int i = 1; i < num_threads; i++) {
+		threads.push_back(thread([]() { load_client.run(); }));
+	}
+	load_client.run();
+	for (thread& load_thread : threads) {
+		load_thread.join();
+	}
+
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	printf("%lld connections opened, %lld failed\n", (long long) opened, (long long) failed);
+	printf("sent:     %12.0f messages/sec\n", (sent - start_sent) / elapsed);
+	printf("received: %12.0f messages/sec\n", (received - start_received) / elapsed);
+
+	return 0;
+}
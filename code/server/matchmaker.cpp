@@ -0,0 +1,196 @@
+/*
+Matchmaker class file
+Places new players in arenas without searching the arena pool
+
+Chaos The Game
+*/
+
+#include "matchmaker.h"
+#include "arena.h"
+#include "player.h"
+
+#include <deque>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+
+Matchmaker::Matchmaker() {
+	matches = 0;
+	queue_depth = 0;
+	max_queue_depth = 0;
+	open_arenas = 0;
+	total_wait_us = 0;
+	max_wait_us = 0;
+}
+
+Matchmaker::~Matchmaker() {
+	// the players and arenas belong to the shard
+}
+
+void Matchmaker::open_arena(Arena* arena, vector<player_id*>& placed, chrono::steady_clock::time_point now) {
+	arena_entry& entry = arena_entries[arena];
+	entry.seats_taken = 0;
+	if (!entry.ready) {
+		entry.ready = true;
+		entry.opened_at = now;
+		ready_arenas.push_back(arena);
+	}
+
+	place_waiting(entry, placed, now);
+}
+
+void Matchmaker::close_arena(Arena* arena) {
+	arena_entries.erase(arena);
+
+	// arenas are rarely shut down, so searching the queue here keeps joining simple
+	deque<Arena*>::iterator itr = find(ready_arenas.begin(), ready_arenas.end(), arena);
+	if (itr != ready_arenas.end()) {
+		ready_arenas.erase(itr);
+	}
+	open_arenas = ready_arenas.size();
+}
+
+bool Matchmaker::join(player_id* player, chrono::steady_clock::time_point now) {
+	player->queued_at = now;
+	player->waiting = false;
+
+	// players already waiting go first, a new player only gets a seat if nobody is ahead of it
+	if (waiting_players.empty() && place(player, now)) {
+		open_arenas = ready_arenas.size();
+		return true;
+	}
+
+	player->waiting = true;
+	player->queue_position = waiting_players.insert(waiting_players.end(), player);
+
+	queue_depth = waiting_players.size();
+	if (queue_depth > max_queue_depth) {
+		max_queue_depth = queue_depth.load();
+	}
+	open_arenas = ready_arenas.size();
+	return false;
+}
+
+bool Matchmaker::leave(player_id* player, vector<player_id*>& placed, chrono::steady_clock::time_point now) {
+	if (player->waiting) {
+		waiting_players.erase(player->queue_position);
+		player->waiting = false;
+		queue_depth = waiting_players.size();
+		return true;
+	}
+
+	// players whose game has ended are no longer in an arena
+	Arena* arena = player->parent_arena;
+	if (arena == NULL) {
+		return true;
+	}
+	player->parent_arena = NULL;
+
+	bool seat_freed;
+	bool released = arena->remove_player(player->player, seat_freed);
+	unordered_map<Arena*, arena_entry>::iterator itr = arena_entries.find(arena);
+	if (seat_freed && (itr != arena_entries.end())) {
+		arena_entry& entry = itr->second;
+		entry.seats_taken--;
+		if (!entry.ready) {
+			entry.ready = true;
+			entry.opened_at = now;
+			ready_arenas.push_back(arena);
+		}
+		place_waiting(entry, placed, now);
+	}
+	return released;
+}
+
+int Matchmaker::get_queue_depth() {
+	return waiting_players.size();
+}
+
+void Matchmaker::get_open_seats(vector<open_seats>& seats) {
+	seats.clear();
+	for (Arena* arena : ready_arenas) {
+		arena_entry& entry = arena_entries[arena];
+		open_seats open;
+		open.arena = arena;
+		open.seats = Arena::MAX_PLAYERS - entry.seats_taken;
+		open.opened_at = entry.opened_at;
+		seats.push_back(open);
+	}
+}
+
+matchmaking_stats Matchmaker::get_stats() {
+	matchmaking_stats stats;
+	stats.matches = matches;
+	stats.queue_depth = queue_depth;
+	stats.max_queue_depth = max_queue_depth;
+	stats.open_arenas = open_arenas;
+	stats.total_wait_us = total_wait_us;
+	stats.max_wait_us = max_wait_us;
+	return stats;
+}
+
+
+/*
+offers the player to the arena at the front of the ready queue
+an arena that turns the player away has started its game or been stopped, it is dropped from the
+queue until it is opened again, so each arena is only tried once
+*/
+bool Matchmaker::place(player_id* player, chrono::steady_clock::time_point now) {
+	while (!ready_arenas.empty()) {
+		Arena* arena = ready_arenas.front();
+		arena_entry& entry = arena_entries[arena];
+
+		if (!arena->add_player(player->player)) {
+			entry.ready = false;
+			ready_arenas.pop_front();
+			continue;
+		}
+
+		player->parent_arena = arena;
+		// acknowledgements from another arena do not apply to this one
+		player->has_acked_tick = false;
+		record_match(player, now);
+
+		// the arena stops accepting players once it is full
+		entry.seats_taken++;
+		if (entry.seats_taken >= Arena::MAX_PLAYERS) {
+			entry.ready = false;
+			ready_arenas.pop_front();
+		}
+		return true;
+	}
+
+	return false;
+}
+
+void Matchmaker::place_waiting(arena_entry& entry, vector<player_id*>& placed, chrono::steady_clock::time_point now) {
+	// the players that have waited longest are placed first
+	while (!waiting_players.empty() && entry.ready) {
+		player_id* player = waiting_players.front();
+		if (!place(player, now)) {
+			break;
+		}
+		waiting_players.pop_front();
+		player->waiting = false;
+		placed.push_back(player);
+	}
+
+	queue_depth = waiting_players.size();
+	open_arenas = ready_arenas.size();
+}
+
+void Matchmaker::record_match(player_id* player, chrono::steady_clock::time_point now) {
+	long long wait_us = chrono::duration_cast<chrono::microseconds>(now - player->queued_at).count();
+
+	matches.fetch_add(1, memory_order_relaxed);
+	total_wait_us.fetch_add(wait_us, memory_order_relaxed);
+	if (wait_us > max_wait_us) {
+		max_wait_us = wait_us;
+	}
+}
@@ -0,0 +1,158 @@
+/*
+Matchmaker class header file
+Places new players in arenas without searching the arena pool
+
+Chaos The Game
+
+The matchmaker keeps two queues.
+	- the ready queue holds the arenas that have open seats, in the order they opened, a new player
+	  is offered to the arena at the front
+	- the waiting queue holds the players that arrived when no arena had a seat, they are placed,
+	  oldest first, as soon as an arena opens
+An arena leaves the ready queue once its seats are filled, or when it turns a player away because
+its game has started, and comes back when it is reset, or when a player leaves its lobby. So joining
+only looks at the front of the ready queue, and each arena is turned away from at most once for each
+game it plays.
+The matchmaker is only used by the action loop of the shard that owns it.
+*/
+
+#ifndef MATCHMAKER_H
+#define MATCHMAKER_H
+
+// the websocketpp connection handler, without the rest of the library
+#include <websocketpp/common/connection_hdl.hpp>
+
+#include "arena.h"
+#include "player.h"
+
+#include <deque>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+using namespace std;
+
+using websocketpp::connection_hdl;
+
+
+/*
+This is a struct to contain a player and the arena it belongs to.
+Used in the map of connection handlers to players, allows for efficient routing of
+incoming messages to the corresponding arena (since map find() is log(n) complexity).
+*/
+typedef struct player_id {
+	// a pointer to the player object that is used in the arena
+	Player* player;
+	// a pointer to the arena that the player belongs to, NULL while waiting for one or after its game ends
+	Arena* parent_arena;
+	// the connection the player is on
+	connection_hdl handler;
+	// the binary snapshot format the client asked for when it connected, 0 for text
+	int snapshot_version;
+	// the latest snapshot tick the client has acknowledged, deltas are built against it
+	// only used with version 2 snapshots
+	bool has_acked_tick;
+	uint32_t acked_tick;
+	// set while the player is on the matchmaker's waiting queue, and where it is on the queue
+	bool waiting;
+	list<player_id*>::iterator queue_position;
+	// when the player asked for an arena, used for the time to match
+	chrono::steady_clock::time_point queued_at;
+} player_id;
+
+
+/*
+Statistics about the matchmaker since it was created.
+*/
+typedef struct matchmaking_stats {
+	// number of players placed in an arena
+	long long matches;
+	// players waiting for an arena right now, and the most that have been waiting at once
+	long long queue_depth;
+	long long max_queue_depth;
+	// arenas on the ready queue right now
+	long long open_arenas;
+	// the sum and the maximum of the time from asking for an arena to being placed (microseconds)
+	long long total_wait_us;
+	long long max_wait_us;
+} matchmaking_stats;
+
+
+/*
+An arena on the ready queue and the seats it has left.
+*/
+typedef struct open_seats {
+	Arena* arena;
+	int seats;
+	// when the arena went on the ready queue, arenas are filled in this order
+	chrono::steady_clock::time_point opened_at;
+} open_seats;
+
+
+class Matchmaker {
+
+public:
+	Matchmaker();
+	~Matchmaker();
+
+	// adds an arena that is open to new players, when it is created or has just been reset
+	// players on the waiting queue are placed in it first, and added to placed
+	void open_arena(Arena* arena, vector<player_id*>& placed, chrono::steady_clock::time_point now);
+	// takes an arena out of matchmaking before it is shut down
+	void close_arena(Arena* arena);
+
+	// places the player in the arena at the front of the ready queue and returns true
+	// returns false and puts the player on the waiting queue if no arena has a seat
+	bool join(player_id* player, chrono::steady_clock::time_point now);
+	// when a player disconnects, takes it off the waiting queue, or out of its arena
+	// a player leaving an arena's lobby gives its seat back, the arena goes back on the ready queue
+	// and the players on the waiting queue are placed first, and added to placed
+	// returns true if the player object can be deleted, otherwise its arena hands it back later
+	bool leave(player_id* player, vector<player_id*>& placed, chrono::steady_clock::time_point now);
+
+	// the number of players waiting for an arena
+	int get_queue_depth();
+	// replaces seats with the arenas on the ready queue, front first, and the seats each has left
+	// an arena that has started its game is listed until a player is turned away from it
+	void get_open_seats(vector<open_seats>& seats);
+	// returns a copy of the statistics, safe to call from any thread
+	matchmaking_stats get_stats();
+
+private:
+	// an arena known to the matchmaker
+	struct arena_entry {
+		// players placed since the arena opened, the arena closes itself to new players once it is full
+		int seats_taken;
+		// true while the arena is on the ready queue, and when it last went on it
+		bool ready;
+		chrono::steady_clock::time_point opened_at;
+	};
+
+	// tries to place the player in the arenas on the ready queue, front first
+	bool place(player_id* player, chrono::steady_clock::time_point now);
+	// places the players on the waiting queue, oldest first, while the arena has seats
+	void place_waiting(arena_entry& entry, vector<player_id*>& placed, chrono::steady_clock::time_point now);
+	// records the time the player waited
+	void record_match(player_id* player, chrono::steady_clock::time_point now);
+
+	// the arenas with open seats, oldest first
+	deque<Arena*> ready_arenas;
+	// every open or busy arena, closed arenas are removed
+	unordered_map<Arena*, arena_entry> arena_entries;
+	// the players without an arena, oldest first
+	list<player_id*> waiting_players;
+
+	// statistics, written by the action loop and read by get_stats
+	atomic<long long> matches;
+	atomic<long long> queue_depth;
+	atomic<long long> max_queue_depth;
+	atomic<long long> open_arenas;
+	atomic<long long> total_wait_us;
+	atomic<long long> max_wait_us;
+
+};
+
+#endif
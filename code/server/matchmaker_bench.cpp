@@ -0,0 +1,390 @@
+/*
+Matchmaker benchmark
+
+Chaos The Game
+
+Fills a pool of empty arenas with players, first the way assign_to_arena used to, offering each
+player to every arena in turn until one takes it, then with the matchmaker. The average time of
+a join is printed for each, for several pool sizes. Afterwards more players than there are seats
+are sent to the matchmaker, and it is checked that they wait, that they are placed oldest first
+once new arenas open, and that a player leaving a lobby gives its seat to the next one waiting.
+Last, connections are spread over several shards' matchmakers by the shard placement, and it is
+checked that they fill the lobbies in the order the arenas opened, over every shard, the way a
+single matchmaker would, and that the shards never run more arenas between them than the maximum.
+
+usage: ./matchmaker_bench.out
+*/
+
+// include game files
+#include "arena.h"
+#include "player.h"
+#include "matchmaker.h"
+#include "shard_placement.h"
+
+// include other dependencies
+#include <vector>
+#include <memory>
+#include <chrono>
+// used for printing
+#include <stdio.h>
+
+using namespace std;
+
+
+// the pool sizes to run
+static const int POOL_SIZES[] = {10, 100, 1000, 4000};
+// the shards the placement is checked with, and the most arenas they can run between them
+static const int PLACEMENT_SHARDS = 4;
+static const int PLACEMENT_ARENAS = 16;
+
+
+// a player that has not joined an arena yet
+player_id* new_player() {
+	player_id* player = new player_id;
+	player->player = new Player();
+	player->parent_arena = NULL;
+	player->snapshot_version = 0;
+	player->has_acked_tick = false;
+	player->acked_tick = 0;
+	player->waiting = false;
+	return player;
+}
+
+void delete_players(vector<player_id*>& players) {
+	for (player_id* player : players) {
+		delete player->player;
+		delete player;
+	}
+	players.clear();
+}
+
+void delete_arenas(vector<Arena*>& arenas) {
+	for (Arena* arena : arenas) {
+		delete arena;
+	}
+	arenas.clear();
+}
+
+// the average time (nanoseconds) to fill every seat of the pool, offering each player to every arena in turn
+double time_linear_scan(int num_arenas) {
+	vector<Arena*> arenas;
+	vector<player_id*> players;
+	for (int i = 0; i < num_arenas; i++) {
+		arenas.push_back(new Arena());
+	}
+	for (int i = 0; i < num_arenas * Arena::MAX_PLAYERS; i++) {
+		players.push_back(new_player());
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (player_id* player : players) {
+		for (Arena* arena : arenas) {
+			if (arena->add_player(player->player)) {
+				player->parent_arena = arena;
+				break;
+			}
+		}
+	}
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	delete_arenas(arenas);
+	delete_players(players);
+	return (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / (num_arenas * Arena::MAX_PLAYERS);
+}
+
+// the average time (nanoseconds) to fill every seat of the pool with the matchmaker
+// also checks that every player got a seat and no arena was given too many players
+double time_matchmaker(int num_arenas, bool& correct) {
+	Matchmaker matchmaker;
+	vector<Arena*> arenas;
+	vector<player_id*> players;
+	vector<player_id*> placed;
+	for (int i = 0; i < num_arenas; i++) {
+		arenas.push_back(new Arena());
+		matchmaker.open_arena(arenas[i], placed, chrono::steady_clock::now());
+	}
+	for (int i = 0; i < num_arenas * Arena::MAX_PLAYERS; i++) {
+		players.push_back(new_player());
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (player_id* player : players) {
+		if (!matchmaker.join(player, start)) {
+			correct = false;
+		}
+	}
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	// each arena should have exactly MAX_PLAYERS players, in the order they joined
+	for (int i = 0; i < (int) players.size(); i++) {
+		if (players[i]->parent_arena != arenas[i / Arena::MAX_PLAYERS]) {
+			correct = false;
+		}
+	}
+	matchmaking_stats stats = matchmaker.get_stats();
+	if ((stats.open_arenas != 0) || (stats.queue_depth != 0) || (stats.matches != (long long) players.size())) {
+		correct = false;
+	}
+
+	delete_arenas(arenas);
+	delete_players(players);
+	return (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / (num_arenas * Arena::MAX_PLAYERS);
+}
+
+// sends players to a matchmaker with no seats, then opens arenas for them
+bool check_waiting_queue() {
+	bool correct = true;
+	Matchmaker matchmaker;
+	vector<Arena*> arenas;
+	vector<player_id*> players;
+	vector<player_id*> placed;
+
+	// three arenas' worth of players, one of whom leaves while waiting
+	int num_players = 3 * Arena::MAX_PLAYERS;
+	for (int i = 0; i < num_players; i++) {
+		players.push_back(new_player());
+		if (matchmaker.join(players[i], chrono::steady_clock::now())) {
+			correct = false;
+		}
+	}
+	player_id* leaver = players[1];
+	if (!matchmaker.leave(leaver, placed, chrono::steady_clock::now()) || !placed.empty()) {
+		correct = false;
+	}
+	if (matchmaker.get_queue_depth() != num_players - 1) {
+		correct = false;
+	}
+
+	// the arenas open a little later, so the players have waited
+	chrono::steady_clock::time_point later = chrono::steady_clock::now() + chrono::milliseconds(5);
+	for (int i = 0; i < 3; i++) {
+		arenas.push_back(new Arena());
+		matchmaker.open_arena(arenas[i], placed, later);
+	}
+
+	// everyone but the leaver is placed, oldest first
+	vector<player_id*> expected;
+	for (player_id* player : players) {
+		if (player != leaver) {
+			expected.push_back(player);
+		}
+	}
+	if (placed != expected) {
+		correct = false;
+	}
+	for (int i = 0; i < (int) placed.size(); i++) {
+		if (placed[i]->parent_arena != arenas[i / Arena::MAX_PLAYERS]) {
+			correct = false;
+		}
+	}
+	if (leaver->parent_arena != NULL) {
+		correct = false;
+	}
+
+	// the last arena has one seat left for the next player
+	player_id* late = new_player();
+	players.push_back(late);
+	if (!matchmaker.join(late, later) || (late->parent_arena != arenas[2])) {
+		correct = false;
+	}
+
+	// every seat is taken, the next player waits until a player leaves the lobby of the first arena,
+	// then takes the seat and the slot that player had
+	player_id* next = new_player();
+	players.push_back(next);
+	if (matchmaker.join(next, later)) {
+		correct = false;
+	}
+	player_id* seated = expected[0];
+	int seat = seated->player->slot;
+	vector<player_id*> seat_placed;
+	if (!matchmaker.leave(seated, seat_placed, later) || (seated->parent_arena != NULL) ||
+		(seat_placed.size() != 1) || (seat_placed[0] != next) || (next->parent_arena != arenas[0]) ||
+		(next->player->slot != seat)) {
+		correct = false;
+	}
+
+	matchmaking_stats stats = matchmaker.get_stats();
+	printf("waiting queue: %lld players placed, peak queue depth %lld, time to match %.3f ms average, %.3f ms max\n",
+		   stats.matches, stats.max_queue_depth, (double) stats.total_wait_us / stats.matches / 1000,
+		   (double) stats.max_wait_us / 1000);
+	if ((stats.queue_depth != 0) || (stats.max_queue_depth != num_players) || (stats.open_arenas != 0) ||
+		(stats.matches != num_players + 1)) {
+		correct = false;
+	}
+
+	delete_arenas(arenas);
+	delete_players(players);
+	return correct;
+}
+
+
+/*
+a shard as the placement sees it, the action loop is left out
+*/
+struct bench_shard {
+	Matchmaker matchmaker;
+	vector<Arena*> arenas;
+	// the connections taken since the shard last published its seats
+	int connections_taken;
+};
+
+// takes a connection the placement sent to the shard, the way the shard's add_connection does
+void take_connection(Shard_Placement& placement, bench_shard& shard, player_id* player) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	if (!shard.matchmaker.join(player, now) && placement.take_arena()) {
+		vector<player_id*> placed;
+		shard.arenas.push_back(new Arena());
+		shard.matchmaker.open_arena(shard.arenas.back(), placed, now);
+	}
+	shard.connections_taken++;
+}
+
+void publish_seats(Shard_Placement& placement, vector<bench_shard>& shards, int shard) {
+	vector<open_seats> seats;
+	shards[shard].matchmaker.get_open_seats(seats);
+	placement.publish(shard, seats, shards[shard].matchmaker.get_queue_depth(), shards[shard].connections_taken);
+	shards[shard].connections_taken = 0;
+}
+
+/*
+a burst of connections arrives before any shard has taken one, then connections arrive one at a time
+until every arena the shards can run between them is full, then a few more that have to wait
+*/
+bool check_shard_placement() {
+	bool correct = true;
+	Shard_Placement placement(PLACEMENT_SHARDS, PLACEMENT_ARENAS);
+	vector<bench_shard> shards(PLACEMENT_SHARDS);
+	vector<player_id*> players;
+	// the connections the players are on, and the shard each was pinned to
+	vector<shared_ptr<int>> connections;
+	vector<int> pinned;
+
+	// each shard starts with one arena, they open in the order of the shards
+	for (int i = 0; i < PLACEMENT_SHARDS; i++) {
+		vector<player_id*> placed;
+		shards[i].connections_taken = 0;
+		placement.take_arena();
+		shards[i].arenas.push_back(new Arena());
+		shards[i].matchmaker.open_arena(shards[i].arenas[0], placed, chrono::steady_clock::now());
+		publish_seats(placement, shards, i);
+	}
+
+	// every connection of the burst is promised a seat before any shard takes one
+	int burst = 2 * Arena::MAX_PLAYERS + 2;
+	for (int i = 0; i < burst; i++) {
+		connections.push_back(make_shared<int>(i));
+		players.push_back(new_player());
+		pinned.push_back(placement.connect(connections[i]));
+	}
+	for (int i = 0; i < burst; i++) {
+		take_connection(placement, shards[pinned[i]], players[i]);
+	}
+	for (int i = 0; i < PLACEMENT_SHARDS; i++) {
+		publish_seats(placement, shards, i);
+		if (placement.get_pending(i) != 0) {
+			correct = false;
+		}
+	}
+
+	// the burst fills the arenas that opened first, one after the other, like a single matchmaker
+	int burst_arenas = 0;
+	for (int i = 0; i < burst; i++) {
+		if (players[i]->parent_arena != shards[i / Arena::MAX_PLAYERS].arenas[0]) {
+			correct = false;
+		}
+		if ((i % Arena::MAX_PLAYERS) == 0) {
+			burst_arenas++;
+		}
+	}
+
+	// one at a time until every seat the pool can hold is taken
+	for (int i = burst; i < PLACEMENT_ARENAS * Arena::MAX_PLAYERS; i++) {
+		connections.push_back(make_shared<int>(i));
+		players.push_back(new_player());
+		pinned.push_back(placement.connect(connections[i]));
+		take_connection(placement, shards[pinned[i]], players[i]);
+		publish_seats(placement, shards, pinned[i]);
+	}
+
+	// the pool is at its maximum, the next players wait, each on the shard with the fewest waiting
+	for (int i = 0; i < PLACEMENT_SHARDS - 1; i++) {
+		int index = connections.size();
+		connections.push_back(make_shared<int>(index));
+		players.push_back(new_player());
+		pinned.push_back(placement.connect(connections[index]));
+		take_connection(placement, shards[pinned[index]], players[index]);
+		publish_seats(placement, shards, pinned[index]);
+		if (players[index]->parent_arena != NULL) {
+			correct = false;
+		}
+	}
+
+	// every arena the pool can hold is full, and no shard has more than one player waiting
+	int num_arenas = 0;
+	int waiting = 0;
+	for (bench_shard& shard : shards) {
+		for (Arena* arena : shard.arenas) {
+			int seated = 0;
+			for (player_id* player : players) {
+				if (player->parent_arena == arena) {
+					seated++;
+				}
+			}
+			if (seated != Arena::MAX_PLAYERS) {
+				correct = false;
+			}
+		}
+		num_arenas += shard.arenas.size();
+		waiting += shard.matchmaker.get_queue_depth();
+		if (shard.matchmaker.get_queue_depth() > 1) {
+			correct = false;
+		}
+	}
+	if ((num_arenas != PLACEMENT_ARENAS) || (waiting != PLACEMENT_SHARDS - 1) || placement.take_arena()) {
+		correct = false;
+	}
+
+	// every connection stays pinned to its shard until it closes
+	for (int i = 0; i < (int) connections.size(); i++) {
+		if (placement.find(connections[i]) != pinned[i]) {
+			correct = false;
+		}
+	}
+	if ((placement.disconnect(connections[0]) != pinned[0]) || (placement.find(connections[0]) != -1) ||
+		(placement.disconnect(connections[0]) != -1)) {
+		correct = false;
+	}
+
+	printf("shard placement: a burst of %d players filled %d arenas, %d players filled %d arenas over %d shards, "
+		   "%d waiting\n", burst, burst_arenas, (int) players.size() - waiting, num_arenas, PLACEMENT_SHARDS, waiting);
+
+	for (bench_shard& shard : shards) {
+		delete_arenas(shard.arenas);
+	}
+	delete_players(players);
+	return correct;
+}
+
+
+int main() {
+	bool correct = true;
+
+	printf("%-8s %18s %18s\n", "arenas", "linear scan ns", "matchmaker ns");
+	for (int num_arenas : POOL_SIZES) {
+		double linear_ns = time_linear_scan(num_arenas);
+		double matchmaker_ns = time_matchmaker(num_arenas, correct);
+		printf("%-8d %18.0f %18.0f\n", num_arenas, linear_ns, matchmaker_ns);
+	}
+	printf("\n");
+
+	if (!check_waiting_queue()) {
+		correct = false;
+	}
+	if (!check_shard_placement()) {
+		correct = false;
+	}
+
+	printf("%s\n", correct ? "all checks passed" : "CHECK FAILED");
+	return correct ? 0 : 1;
+}
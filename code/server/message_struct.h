@@ -11,14 +11,19 @@ Chaos The Game
 
 
 /*
-This is a struct to contain an individual message to be passed to the arena.
-It contains the player that sent the message and the message string itself.
+This is a struct to contain an individual input message to be passed to the arena.
+The message text is decoded before it is queued, so the struct has a fixed size and
+can be stored directly in the arena's input ring without allocating.
 */
 typedef struct message_struct {
-	// a pointer to the player who sent the message
-	Player* player;
-	// the text of the message
-	std::string message_text;
+	// the slot of the player who sent the message within its arena
+	int player_slot;
+	// direction of rotation (-1, 0, or 1)
+	int rotationVel;
+	// velocity in the forward/backward direction (-1, 0, or 1)
+	int vel;
+	// true while the space bar is held down
+	bool fire;
 } message_struct;
 
 #endif
@@ -0,0 +1,426 @@
+/*
+Player movement benchmark
+
+Chaos The Game
+
+Runs two arenas side by side with the same input. One moves its players with
+update_player_positions. The other moves them step by step the way the arena used to: a pose at a
+time, with every pose checked against the screen edges, every other player, every wall and every
+bomb. After every tick the players' positions, rotations and deaths, the projectiles they fired,
+and the snapshot each arena sends must be exactly the same.
+Each scenario is run for several seeds, with the players holding random input for a few ticks at a
+time and put back at random places once killed. The time each way of moving the players takes
+each tick is printed.
+
+usage: ./movement_bench.out [ticks per seed]
+*/
+
+// include game files
+#include "arena.h"
+#include "player.h"
+#include "projectile.h"
+#include "wall.h"
+#include "wall_manager.h"
+#include "bomb.h"
+#include "bomb_manager.h"
+#include "collisions.h"
+#include "rotation_table.h"
+
+// include other dependencies
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+// used for printing and random number generation
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+// the scenarios that are run
+enum scenario_type {
+	// the walls stay where they start
+	OPEN,
+	// every interior wall rotates at the same time, back and forth
+	ROTATING_WALLS,
+	// the walls have closed and detonated bombs are spread over the field
+	BOMBS
+};
+
+// the seeds each scenario is run with
+static const int SEEDS = 20;
+// the detonated bombs kept in the bomb scenario
+static const int LIVE_BOMBS = 24;
+
+
+class Movement_Bench {
+
+public:
+	Movement_Bench(scenario_type type, unsigned int seed);
+	~Movement_Bench();
+
+	// runs the ticks, returns false at the first tick the two arenas differ
+	bool run(int ticks);
+
+	// the time (nanoseconds) each way of moving the players took, and the players killed by bombs
+	long long moved_ns;
+	long long stepped_ns;
+	long long deaths;
+
+private:
+	scenario_type type;
+	unsigned int seed;
+
+	// moved with update_player_positions, and step by step, with players in the same slots
+	// an arena goes through its players in the order of their addresses, so each arena's players are
+	// kept in an array, in the order of their slots
+	Arena arena;
+	Arena reference;
+	Player* player_array;
+	Player* reference_array;
+	vector<Player*> players;
+	vector<Player*> reference_players;
+
+	// the input each player holds, and the tick it changes
+	vector<string> input;
+	vector<int> input_until;
+
+	// the step by step movement update_player_positions replaced
+	static void move_step_by_step(Arena& arena);
+
+	// untimed work done on both arenas before each tick
+	void prepare_tick(int tick);
+	// put a killed player back at a random place, the same in both arenas
+	void revive_players();
+	// send every wall rotating, turning it around once it reaches its target
+	static void rotate_all_walls(Arena& arena);
+	// move every wall to its final rotation
+	static void close_all_walls(Arena& arena);
+	// top up the bombs and keep them detonated
+	void refill_bombs();
+
+	// true if the players, projectiles and snapshots of the two arenas are exactly the same
+	bool same_state(int tick);
+
+};
+
+
+Movement_Bench::Movement_Bench(scenario_type type, unsigned int seed) : type(type), seed(seed) {
+	moved_ns = 0;
+	stepped_ns = 0;
+	deaths = 0;
+
+	player_array = new Player[Arena::MAX_PLAYERS];
+	reference_array = new Player[Arena::MAX_PLAYERS];
+	for (int i = 0; i < Arena::MAX_PLAYERS; i++) {
+		players.push_back(&player_array[i]);
+		arena.add_player(players[i]);
+		reference_players.push_back(&reference_array[i]);
+		reference.add_player(reference_players[i]);
+	}
+	input.assign(Arena::MAX_PLAYERS, "0,0,0");
+	input_until.assign(Arena::MAX_PLAYERS, 0);
+}
+
+Movement_Bench::~Movement_Bench() {
+	// the arenas do not own their players, the server normally deletes them
+	arena.clean_up();
+	reference.clean_up();
+	delete[] player_array;
+	delete[] reference_array;
+}
+
+bool Movement_Bench::run(int ticks) {
+	for (Arena* a : {&arena, &reference}) {
+		a->setup();
+		a->outgoing_queue.clear();
+		// nothing is left to the clock, walls only rotate and bombs only appear when the scenario says so
+		a->wall_manager.waiting_time = 1e9;
+		a->bomb_manager.waiting_time = 1e9;
+		if (type == ROTATING_WALLS) {
+			rotate_all_walls(*a);
+		} else if (type == BOMBS) {
+			close_all_walls(*a);
+		}
+	}
+
+	srand(seed);
+	// every player starts at a random place
+	for (Player* player : players) {
+		arena.arena_players.erase(player);
+		arena.dead_players.insert(player);
+	}
+	for (Player* player : reference_players) {
+		reference.arena_players.erase(player);
+		reference.dead_players.insert(player);
+	}
+
+	for (int tick = 0; tick < ticks; tick++) {
+		prepare_tick(tick);
+
+		arena.process_messages();
+		reference.process_messages();
+
+		// whichever goes first finds less of its memory in the cache, so they take turns
+		for (int turn = 0; turn < 2; turn++) {
+			bool moved = ((tick + turn) % 2 == 0);
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			if (moved) {
+				arena.update_player_positions();
+			} else {
+				move_step_by_step(reference);
+			}
+			chrono::steady_clock::time_point end = chrono::steady_clock::now();
+			(moved ? moved_ns : stepped_ns) += chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+		}
+		deaths += arena.dead_players.size();
+
+		for (Arena* a : {&arena, &reference}) {
+			a->update_projectiles();
+			a->update_walls();
+			a->bomb_manager.update_bombs();
+			a->send_message();
+		}
+
+		if (!same_state(tick)) {
+			return false;
+		}
+		arena.recycle_snapshots(arena.outgoing_queue);
+		reference.recycle_snapshots(reference.outgoing_queue);
+	}
+	return true;
+}
+
+/*
+moves each player a pose at a time, MOVEMENT_PER_FRAME times, stopping before the first pose that
+collides with the boundary, another player or a wall, and killing it at the first pose that touches
+a bomb, with every pose checked against everything in the arena
+*/
+void Movement_Bench::move_step_by_step(Arena& arena) {
+	for (Wall* wall : arena.wall_manager.walls) {
+		wall->newRotation = wall->rotation;
+		wall->update_points();
+	}
+
+	set<Player*>::iterator itr = arena.arena_players.begin();
+	while (itr != arena.arena_players.end()) {
+		Player* player = *itr;
+		bool collision = false;
+		bool delete_player = false;
+
+		for (int i = 0; (i < Arena::MOVEMENT_PER_FRAME) && !collision; i++) {
+			player->newRotation = ((player->rotation + player->rotationVel) + 360) % 360;
+			player->velX = - player->vel * Rotation_Table::sine(player->newRotation);
+			player->velY = player->vel * Rotation_Table::cosine(player->newRotation);
+			player->newX = player->posX + player->velX;
+			player->newY = player->posY + player->velY;
+			player->update_rectangle_points();
+
+			for (int k = 0; k < player->body.num_points; k++) {
+				point p = player->body.points[k];
+				if ((p.x <= 0) || (p.x >= Arena::SCREEN_WIDTH) || (p.y <= 0) || (p.y >= Arena::SCREEN_HEIGHT)) {
+					collision = true;
+				}
+			}
+			for (Player* other_player : arena.arena_players) {
+				if (!collision && (other_player != player)) {
+					other_player->update_rectangle_points();
+					collision = Collisions::polygon_collision(player->body, other_player->body);
+				}
+			}
+			for (Wall* wall : arena.wall_manager.walls) {
+				if (!collision) {
+					collision = Collisions::polygon_collision(player->body, wall->body);
+				}
+			}
+			for (Bomb* bomb : arena.bomb_manager.bombs) {
+				if (!collision && Collisions::bomb_player_collision(bomb, player->body)) {
+					delete_player = true;
+					collision = true;
+				}
+			}
+
+			if (!collision) {
+				player->posX = player->newX;
+				player->posY = player->newY;
+				player->rotation = player->newRotation;
+			}
+		}
+
+		if (delete_player) {
+			itr = arena.arena_players.erase(itr);
+			arena.dead_players.insert(player);
+			continue;
+		}
+
+		if (player->shoot_projectile) {
+			Projectile projectile(player->posX, player->posY, player->rotation, Player::PLAYER_HEIGHT);
+			projectile.shooter = player->slot;
+			arena.projectiles.add(projectile);
+			player->shoot_projectile = false;
+		}
+		itr++;
+	}
+}
+
+void Movement_Bench::prepare_tick(int tick) {
+	revive_players();
+
+	if (type == ROTATING_WALLS) {
+		rotate_all_walls(arena);
+		rotate_all_walls(reference);
+	} else if (type == BOMBS) {
+		refill_bombs();
+	}
+
+	// each player holds a random input for up to 20 ticks, a player that holds space fires every other tick
+	for (int i = 0; i < Arena::MAX_PLAYERS; i++) {
+		if (tick >= input_until[i]) {
+			input[i] = to_string(rand() % 3 - 1) + "," + to_string(rand() % 3 - 1) + ",";
+			input_until[i] = tick + 1 + rand() % 20;
+		}
+		string text = input[i] + ((tick % 2 == 0) ? "1" : "0");
+		if (arena.arena_players.count(players[i]) != 0) {
+			arena.add_to_incoming_queue(players[i], text);
+			reference.add_to_incoming_queue(reference_players[i], text);
+		}
+	}
+}
+
+void Movement_Bench::revive_players() {
+	for (int i = 0; i < Arena::MAX_PLAYERS; i++) {
+		if (arena.dead_players.count(players[i]) == 0) {
+			continue;
+		}
+		double x = 60 + rand() % (Arena::SCREEN_WIDTH - 120) + (rand() % 100) / 100.0;
+		double y = 60 + rand() % (Arena::SCREEN_HEIGHT - 120) + (rand() % 100) / 100.0;
+		int rotation = rand() % 360;
+		for (Player* player : {players[i], reference_players[i]}) {
+			player->posX = x;
+			player->posY = y;
+			player->rotation = rotation;
+			player->reset_temp_vars();
+			player->update_rectangle_points();
+		}
+		arena.dead_players.erase(players[i]);
+		arena.arena_players.insert(players[i]);
+		reference.dead_players.erase(reference_players[i]);
+		reference.arena_players.insert(reference_players[i]);
+	}
+}
+
+void Movement_Bench::rotate_all_walls(Arena& arena) {
+	Wall_Manager& manager = arena.wall_manager;
+
+	for (Wall* wall : manager.unrotated_walls) {
+		manager.rotating_walls.push_back(wall);
+	}
+	manager.unrotated_walls.clear();
+
+	// send finished walls back the way they came
+	for (Wall* wall : manager.finished_rotating_walls) {
+		if (wall->target_rotation == 0) {
+			wall->target_rotation = 90;
+			wall->rotationVel = 1;
+		} else {
+			wall->target_rotation = 0;
+			wall->rotationVel = -1;
+		}
+		manager.rotating_walls.push_back(wall);
+	}
+	manager.finished_rotating_walls.clear();
+}
+
+void Movement_Bench::close_all_walls(Arena& arena) {
+	Wall_Manager& manager = arena.wall_manager;
+
+	for (Wall* wall : manager.walls) {
+		wall->rotation = wall->target_rotation;
+		wall->newRotation = wall->target_rotation;
+		wall->update_points();
+		manager.finished_rotating_walls.push_back(wall);
+	}
+	manager.unrotated_walls.clear();
+	manager.rotating_walls.clear();
+}
+
+void Movement_Bench::refill_bombs() {
+	while (arena.bomb_manager.bombs.size() < LIVE_BOMBS) {
+		int x = 40 + rand() % (Arena::SCREEN_WIDTH - 80);
+		int y = 40 + rand() % (Arena::SCREEN_HEIGHT - 80);
+		arena.bomb_manager.add_bomb(x, y);
+		reference.bomb_manager.add_bomb(x, y);
+	}
+
+	// keep every bomb past its warning time but short of its destroy time, the radius grows each tick
+	chrono::time_point<chrono::system_clock> detonated = chrono::system_clock::now() - chrono::seconds(5);
+	for (Arena* a : {&arena, &reference}) {
+		for (Bomb* bomb : a->bomb_manager.bombs) {
+			bomb->start_time = detonated;
+		}
+	}
+}
+
+bool Movement_Bench::same_state(int tick) {
+	const char* difference = NULL;
+	for (int i = 0; i < Arena::MAX_PLAYERS; i++) {
+		Player* a = players[i];
+		Player* b = reference_players[i];
+		if ((a->posX != b->posX) || (a->posY != b->posY) || (a->rotation != b->rotation)) {
+			difference = "a player's position";
+		} else if (arena.dead_players.count(a) != reference.dead_players.count(b)) {
+			difference = "a player's death";
+		}
+	}
+	if ((difference == NULL) && (arena.projectiles.size() != reference.projectiles.size())) {
+		difference = "the projectiles";
+	}
+	if ((difference == NULL) && (arena.outgoing_queue.back().text != reference.outgoing_queue.back().text)) {
+		difference = "the snapshot";
+	}
+
+	if (difference != NULL) {
+		printf("  seed %u, tick %d: %s differed\n", seed, tick, difference);
+		return false;
+	}
+	return true;
+}
+
+
+int main(int argc, char** argv) {
+	int ticks = 300;
+	if (argc > 1) {
+		ticks = atoi(argv[1]);
+	}
+	if (ticks <= 0) {
+		printf("usage: %s [ticks per seed]\n", argv[0]);
+		return 1;
+	}
+
+	const char* names[] = {"open", "rotating walls", "bombs"};
+	scenario_type scenarios[] = {OPEN, ROTATING_WALLS, BOMBS};
+
+	bool correct = true;
+	printf("%-16s %10s %18s %22s\n", "scenario", "bomb deaths", "moved ns/tick", "step by step ns/tick");
+	for (int s = 0; s < 3; s++) {
+		long long moved_ns = 0;
+		long long stepped_ns = 0;
+		long long deaths = 0;
+		for (int seed = 1; seed <= SEEDS; seed++) {
+			Movement_Bench bench(scenarios[s], seed);
+			if (!bench.run(ticks)) {
+				correct = false;
+			}
+			moved_ns += bench.moved_ns;
+			stepped_ns += bench.stepped_ns;
+			deaths += bench.deaths;
+		}
+		long long total_ticks = (long long) SEEDS * ticks;
+		printf("%-16s %10lld %18.0f %22.0f\n", names[s], deaths, (double) moved_ns / total_ticks,
+			   (double) stepped_ns / total_ticks);
+	}
+
+	printf("\n%s\n", correct ? "the players moved the same as step by step" : "CHECK FAILED: the players moved differently from step by step");
+	return correct ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+/*
+MPSC queue header file
+A bounded, lock-free queue with many producer threads and a single consumer thread
+
+Chaos The Game
+
+Based on a ring of slots, each with a sequence number that says whose turn it is to use the slot.
+Producers claim a slot by advancing the tail with a compare-and-swap, so they never block each other
+or the consumer. Entries are moved in and out of the queue, never copied.
+*/
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+using namespace std;
+
+
+template <typename T>
+class MPSC_Queue {
+
+public:
+	// the capacity is rounded up to a power of two
+	MPSC_Queue(size_t capacity);
+	~MPSC_Queue();
+
+	// the queue owns its slots, so it cannot be copied
+	MPSC_Queue(const MPSC_Queue&) = delete;
+	MPSC_Queue& operator=(const MPSC_Queue&) = delete;
+
+	// moves an entry into the queue, returns false if the queue is full
+	// safe to call from any number of threads at once
+	bool try_push(T&& item);
+
+	// moves the oldest entry out of the queue, returns false if the queue is empty
+	// must only be called from the consumer thread
+	bool try_pop(T& item);
+
+	// true if there is nothing for the consumer to pop
+	bool empty() const;
+
+private:
+	// a single entry in the ring
+	struct slot {
+		// equal to the slot's position when it is free to be pushed into,
+		// one past the position when it holds an entry that is ready to be popped
+		atomic<size_t> sequence;
+		// raw storage, the entry is constructed in place when pushed and destroyed when popped
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	slot* slots;
+	// capacity - 1, used to wrap positions around the ring
+	size_t mask;
+
+	// kept on separate cache lines so producers and the consumer do not slow each other down
+	// the position of the next slot to push into, shared by every producer
+	alignas(64) atomic<size_t> tail;
+	// the position of the next slot to pop from, only used by the consumer
+	alignas(64) size_t head;
+
+};
+
+
+template <typename T>
+MPSC_Queue<T>::MPSC_Queue(size_t capacity) {
+	// round up to a power of two so positions can be wrapped with a mask
+	size_t size = 2;
+	while (size < capacity) {
+		size *= 2;
+	}
+	mask = size - 1;
+
+	slots = new slot[size];
+	for (size_t i = 0; i < size; i++) {
+		slots[i].sequence.store(i, memory_order_relaxed);
+	}
+
+	tail.store(0, memory_order_relaxed);
+	head = 0;
+}
+
+template <typename T>
+MPSC_Queue<T>::~MPSC_Queue() {
+	// destroy any entries that were never popped
+	while (!empty()) {
+		reinterpret_cast<T*>(slots[head & mask].storage)->~T();
+		head++;
+	}
+	delete[] slots;
+}
+
+template <typename T>
+bool MPSC_Queue<T>::try_push(T&& item) {
+	size_t position = tail.load(memory_order_relaxed);
+
+	while (true) {
+		slot& s = slots[position & mask];
+		size_t sequence = s.sequence.load(memory_order_acquire);
+		// signed so that the comparison still works after the positions wrap around
+		ptrdiff_t difference = (ptrdiff_t) (sequence - position);
+
+		if (difference == 0) {
+			// the slot is free, try to claim it before another producer does
+			// on failure, position is updated to the current tail and the loop tries again
+			if (tail.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+				new (s.storage) T(std::move(item));
+				// hand the slot to the consumer
+				s.sequence.store(position + 1, memory_order_release);
+				return true;
+			}
+		} else if (difference < 0) {
+			// the slot still holds an entry from the last time around the ring, the queue is full
+			return false;
+		} else {
+			// another producer claimed this position, catch up to the current tail
+			position = tail.load(memory_order_relaxed);
+		}
+	}
+}
+
+template <typename T>
+bool MPSC_Queue<T>::try_pop(T& item) {
+	slot& s = slots[head & mask];
+	size_t sequence = s.sequence.load(memory_order_acquire);
+
+	// the slot has not been filled yet (or its producer has not finished writing it)
+	if (sequence != head + 1) {
+		return false;
+	}
+
+	T* stored = reinterpret_cast<T*>(s.storage);
+	item = std::move(*stored);
+	stored->~T();
+
+	// free the slot for the producers on the next time around the ring
+	s.sequence.store(head + mask + 1, memory_order_release);
+	head++;
+	return true;
+}
+
+template <typename T>
+bool MPSC_Queue<T>::empty() const {
+	return slots[head & mask].sequence.load(memory_order_acquire) != head + 1;
+}
+
+#endif
@@ -0,0 +1,557 @@
+/*
+Projectile narrowphase benchmark
+
+Chaos The Game
+
+Takes random projectiles through a frame among random walls and players, once with the projectile
+batch, which sweeps each projectile from one bounce to the next, and once in a hundred small moves a
+step, checking for collisions after each move with the same rules. The small moves find every
+collision within a hundredth of a step of when it happens, so the batch must delete the same
+projectiles, touch the same players, and leave every projectile in the same place, to within that.
+A projectile that only grazes something, or bounces many times, can come out a little differently
+from the small moves, it is taken through again in moves ten and a hundred times smaller, and the
+program fails if those do not agree with the batch either, unless the smallest moves bounced off two
+walls in one move, where the walls cross or meet and the order they are touched in is not defined, or
+the two agree once both are checked again a small move into the next frame, as a projectile touching a
+wall at the end of a frame can bounce in that frame or the next, or it touches something at exactly the
+radius, where rounding decides whether it touches, and agrees with the smallest moves touching a
+millionth of a pixel further or closer. A projectile caught between two walls goes through them after
+MAX_BOUNCES bounces, in the small moves the same as in the batch.
+The batch's pre-filter is run with each kernel the processor supports, scalar, SSE2 and AVX2, and every
+kernel must give exactly the same results.
+The projectiles start close to the walls and players, so they deflect, hit wall ends and hit players
+often. Then the time to take one projectile through a frame is printed for the batch with each kernel,
+and for the collision checks after each step, the way the arena used to.
+
+usage: ./narrowphase_bench.out [frames]
+*/
+
+// include game files
+#include "projectile_batch.h"
+#include "projectile.h"
+#include "collisions.h"
+#include "rotation_table.h"
+#include "player.h"
+#include "wall.h"
+
+// include other dependencies
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <stdint.h>
+// used for printing and random number generation
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+// the size of the screen, the same as the arena's
+static const int SCREEN_WIDTH = 960;
+static const int SCREEN_HEIGHT = 640;
+// the walls and players in each frame, as many as an arena has
+static const int WALLS = 8;
+static const int PLAYERS = 4;
+// the projectiles taken through each frame
+static const int PROJECTILES = 64;
+// the small moves in each step
+static const int MOVES = 100;
+// how far apart (pixels, or steps) the batch and the small moves can be
+static const double TOLERANCE = 0.05;
+// a projectile that differs is taken through again in moves this many times smaller, up to twice
+static const int REFINE = 10;
+// how much further or closer (pixels) the smallest moves touch things, to find projectiles that touch
+// something at exactly the radius, where rounding decides whether they touch
+static const double GRAZE = 0.000001;
+
+
+/*
+one frame of random walls, players and projectiles, and what happened to each projectile
+*/
+typedef struct frame_result {
+	vector<double> end_times;
+	vector<uint32_t> hits;
+	vector<double> hit_times;
+	vector<Projectile> motion;
+	// the walls and edges each projectile bounced off, only counted by the small moves
+	vector<int> bounces;
+	// whether a projectile bounced off two walls in one small move, where they cross or meet, the order
+	// it touches them in is then not defined, only found by the small moves
+	vector<bool> corners;
+} frame_result;
+
+class Frame {
+
+public:
+	Frame();
+	~Frame();
+
+	vector<Wall*> walls;
+	vector<Player*> players;
+	vector<Projectile> projectiles;
+	vector<uint32_t> wall_masks;
+	vector<uint32_t> player_masks;
+	// the distance the small moves touch walls and players at, the projectile's radius
+	double radius;
+
+	// the same frame for the same seed
+	void fill(unsigned int seed);
+	// small moves, with the collision checks after each
+	void run_moves(frame_result& result);
+	// takes one projectile through the frame in the given number of small moves a step
+	void move_projectile(int j, int moves_per_step, frame_result& result);
+	// the collision checks for one projectile after a small move, returns true if it is deleted
+	bool check_move(int j, double time, frame_result& result);
+	// the collision checks after each step, the way the arena used to, returns the projectiles deleted
+	int run_checks();
+	// the projectile batch
+	void run_batch(Projectile_Batch& batch, frame_result& result);
+
+};
+
+Frame::Frame() {
+	radius = Projectile::RADIUS;
+	for (int i = 0; i < WALLS; i++) {
+		walls.push_back(new Wall(0, 0, 0));
+	}
+	for (int i = 0; i < PLAYERS; i++) {
+		players.push_back(new Player());
+	}
+}
+
+Frame::~Frame() {
+	for (Wall* wall : walls) {
+		delete wall;
+	}
+	for (Player* player : players) {
+		delete player;
+	}
+}
+
+void Frame::fill(unsigned int seed) {
+	srand(seed);
+	for (Wall* wall : walls) {
+		wall->posX = 40 + rand() % (SCREEN_WIDTH - 80);
+		wall->posY = 40 + rand() % (SCREEN_HEIGHT - 80);
+		wall->rotation = rand() % 360;
+		wall->newRotation = wall->rotation;
+		wall->update_points();
+	}
+	for (Player* player : players) {
+		player->newX = 40 + (double) rand() / RAND_MAX * (SCREEN_WIDTH - 80);
+		player->newY = 40 + (double) rand() / RAND_MAX * (SCREEN_HEIGHT - 80);
+		player->newRotation = rand() % 360;
+		player->update_rectangle_points();
+	}
+
+	// each projectile starts within a few steps of a wall or a player, in any direction
+	projectiles.clear();
+	wall_masks.clear();
+	player_masks.clear();
+	for (int i = 0; i < PROJECTILES; i++) {
+		double x, y;
+		if (rand() % 2 == 0) {
+			const Wall* wall = walls[rand() % WALLS];
+			double along = (double) rand() / RAND_MAX;
+			x = wall->body.points[0].x + along * (wall->body.points[1].x - wall->body.points[0].x);
+			y = wall->body.points[0].y + along * (wall->body.points[1].y - wall->body.points[0].y);
+		} else {
+			const Player* player = players[rand() % PLAYERS];
+			x = player->body.center.x;
+			y = player->body.center.y;
+		}
+		x += (double) rand() / RAND_MAX * 60 - 30;
+		y += (double) rand() / RAND_MAX * 60 - 30;
+		projectiles.push_back(Projectile(x, y, rand() % 360, 0));
+
+		// most projectiles are near everything, some are only near a few things
+		uint32_t all_walls = ((uint32_t) 1 << WALLS) - 1;
+		uint32_t all_players = ((uint32_t) 1 << PLAYERS) - 1;
+		wall_masks.push_back((rand() % 4 == 0) ? (rand() & all_walls) : all_walls);
+		player_masks.push_back((rand() % 4 == 0) ? (rand() & all_players) : all_players);
+	}
+}
+
+// the distance from a point to a player's rectangle, turned upright the same way as the collision checks
+double player_distance(const Polygon& body, double x, double y) {
+	double sine = Rotation_Table::sine(body.rect_rot);
+	double cosine = Rotation_Table::cosine(body.rect_rot);
+	double ux = (cosine * (x - body.center.x)) - (sine * (y - body.center.y)) + body.center.x;
+	double uy = (sine * (x - body.center.x)) + (cosine * (y - body.center.y)) + body.center.y;
+	double left = body.center.x - (body.rect_width / 2);
+	double top = body.center.y - (body.rect_height / 2);
+	double dx = ux - min(max(ux, left), left + body.rect_width);
+	double dy = uy - min(max(uy, top), top + body.rect_height);
+	return sqrt((dx * dx) + (dy * dy));
+}
+
+void Frame::run_moves(frame_result& result) {
+	result.end_times.assign(projectiles.size(), Projectile::PROJECTILE_SPEED);
+	result.hits.assign(projectiles.size(), 0);
+	result.hit_times.assign(projectiles.size() * PLAYERS, 0);
+	result.motion = projectiles;
+	result.bounces.assign(projectiles.size(), 0);
+	result.corners.assign(projectiles.size(), false);
+
+	for (int j = 0; j < (int) projectiles.size(); j++) {
+		move_projectile(j, MOVES, result);
+	}
+}
+
+void Frame::move_projectile(int j, int moves_per_step, frame_result& result) {
+	int moves = Projectile::PROJECTILE_SPEED * moves_per_step;
+	result.end_times[j] = Projectile::PROJECTILE_SPEED;
+	result.hits[j] = 0;
+	for (int p = 0; p < PLAYERS; p++) {
+		result.hit_times[j * PLAYERS + p] = 0;
+	}
+	result.motion[j] = projectiles[j];
+	result.bounces[j] = 0;
+	result.corners[j] = false;
+
+	Projectile& ball = result.motion[j];
+	// a projectile already touching something touches it at time 0
+	for (int m = 0; m <= moves; m++) {
+		double time = (double) m / moves_per_step;
+		if (m > 0) {
+			ball.posX += ball.velX / moves_per_step;
+			ball.posY += ball.velY / moves_per_step;
+		}
+		if (check_move(j, time, result)) {
+			result.end_times[j] = time;
+			break;
+		}
+	}
+}
+
+bool Frame::check_move(int j, double time, frame_result& result) {
+	double min_edge = Projectile::RADIUS;
+	double max_x = SCREEN_WIDTH - Projectile::RADIUS;
+	double max_y = SCREEN_HEIGHT - Projectile::RADIUS;
+	Projectile& ball = result.motion[j];
+
+	if (((ball.posX < min_edge) && (ball.velX < 0)) || ((ball.posX > max_x) && (ball.velX > 0))) {
+		ball.velX = - ball.velX;
+		result.bounces[j]++;
+	}
+	if (((ball.posY < min_edge) && (ball.velY < 0)) || ((ball.posY > max_y) && (ball.velY > 0))) {
+		ball.velY = - ball.velY;
+		result.bounces[j]++;
+	}
+
+	int deflections = 0;
+	for (int w = 0; w < WALLS; w++) {
+		// caught between walls, it goes through them the same as in the batch
+		if (((wall_masks[j] & ((uint32_t) 1 << w)) == 0) || (result.bounces[j] >= Projectile_Batch::MAX_BOUNCES)) {
+			continue;
+		}
+		point a = walls[w]->body.points[0];
+		point b = walls[w]->body.points[1];
+		vect line((b.x - a.x), (b.y - a.y));
+		vect a_to_ball((ball.posX - a.x), (ball.posY - a.y));
+		double along = Collisions::dot_product(a_to_ball, line) / Collisions::dot_product(line, line);
+		if ((along >= 0) && (along <= 1)) {
+			// the body deflects a projectile moving towards it
+			vect normal = Collisions::calculate_unit_normal_vector(line);
+			double distance = Collisions::dot_product(a_to_ball, normal);
+			if ((abs(distance) <= radius) &&
+				(distance * Collisions::dot_product(vect(ball.velX, ball.velY), normal) < 0)) {
+				Collisions::calculate_deflection(&ball, line);
+				result.bounces[j]++;
+				deflections++;
+			}
+		} else if ((Collisions::get_distance(a.x, a.y, ball.posX, ball.posY) <= radius) ||
+				   (Collisions::get_distance(b.x, b.y, ball.posX, ball.posY) <= radius)) {
+			return true;
+		}
+	}
+	if (deflections > 1) {
+		result.corners[j] = true;
+	}
+
+	for (int p = 0; p < PLAYERS; p++) {
+		uint32_t bit = (uint32_t) 1 << p;
+		if (((player_masks[j] & bit) != 0) && ((result.hits[j] & bit) == 0) &&
+			(player_distance(players[p]->body, ball.posX, ball.posY) <= radius)) {
+			result.hits[j] |= bit;
+			result.hit_times[j * PLAYERS + p] = time;
+		}
+	}
+	return false;
+}
+
+int Frame::run_checks() {
+	double min_edge = Projectile::RADIUS;
+	double max_x = SCREEN_WIDTH - Projectile::RADIUS;
+	double max_y = SCREEN_HEIGHT - Projectile::RADIUS;
+	int deleted = 0;
+
+	for (int j = 0; j < (int) projectiles.size(); j++) {
+		Projectile ball = projectiles[j];
+		for (int i = 0; i < Projectile::PROJECTILE_SPEED; i++) {
+			ball.posX += ball.velX;
+			ball.posY += ball.velY;
+			if (ball.posX <= min_edge) {
+				ball.velX = abs(ball.velX);
+			}
+			if (ball.posX >= max_x) {
+				ball.velX = - abs(ball.velX);
+			}
+			if (ball.posY <= min_edge) {
+				ball.velY = abs(ball.velY);
+			}
+			if (ball.posY >= max_y) {
+				ball.velY = - abs(ball.velY);
+			}
+
+			bool was_deleted = false;
+			for (int w = 0; w < WALLS; w++) {
+				if (((wall_masks[j] & ((uint32_t) 1 << w)) != 0) &&
+					(Collisions::wall_ball_collision(&ball, walls[w], true) == 2)) {
+					was_deleted = true;
+					break;
+				}
+			}
+			for (int p = 0; !was_deleted && (p < PLAYERS); p++) {
+				if (((player_masks[j] & ((uint32_t) 1 << p)) != 0) &&
+					Collisions::ball_player_collision(&ball, players[p]->body)) {
+					was_deleted = true;
+				}
+			}
+			if (was_deleted) {
+				deleted++;
+				break;
+			}
+		}
+	}
+	return deleted;
+}
+
+void Frame::run_batch(Projectile_Batch& batch, frame_result& result) {
+	batch.clear();
+	for (Wall* wall : walls) {
+		batch.add_wall(wall);
+	}
+	for (Player* player : players) {
+		batch.add_player(player->body);
+	}
+	for (int j = 0; j < (int) projectiles.size(); j++) {
+		batch.add_projectile(projectiles[j], wall_masks[j], player_masks[j]);
+	}
+	batch.run();
+
+	result.end_times.resize(projectiles.size());
+	result.hits.resize(projectiles.size());
+	result.hit_times.resize(projectiles.size() * PLAYERS);
+	result.motion = projectiles;
+	result.bounces.assign(projectiles.size(), 0);
+	result.corners.assign(projectiles.size(), false);
+	for (int j = 0; j < (int) projectiles.size(); j++) {
+		result.end_times[j] = batch.end_time(j);
+		result.hits[j] = batch.player_hits(j);
+		for (int p = 0; p < PLAYERS; p++) {
+			result.hit_times[j * PLAYERS + p] = ((result.hits[j] >> p) & 1) ? batch.player_time(j, p) : 0;
+		}
+		batch.get_motion(j, result.motion[j]);
+	}
+}
+
+// true if every projectile ended up exactly the same in the two results
+bool same_results(const frame_result& a, const frame_result& b) {
+	for (int j = 0; j < (int) a.hits.size(); j++) {
+		if ((a.end_times[j] != b.end_times[j]) || (a.hits[j] != b.hits[j]) || (a.motion[j].posX != b.motion[j].posX) ||
+			(a.motion[j].posY != b.motion[j].posY) || (a.motion[j].velX != b.motion[j].velX) ||
+			(a.motion[j].velY != b.motion[j].velY)) {
+			return false;
+		}
+		for (int p = 0; p < PLAYERS; p++) {
+			if (a.hit_times[j * PLAYERS + p] != b.hit_times[j * PLAYERS + p]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// how far apart (pixels, or steps) a projectile ended up in the two results, HUGE_VAL if it touched different players
+double difference(const frame_result& a, const frame_result& b, int j) {
+	if (a.hits[j] != b.hits[j]) {
+		return HUGE_VAL;
+	}
+	double most = abs(a.end_times[j] - b.end_times[j]);
+	for (int p = 0; p < PLAYERS; p++) {
+		most = max(most, abs(a.hit_times[j * PLAYERS + p] - b.hit_times[j * PLAYERS + p]));
+	}
+	most = max(most, max(abs(a.motion[j].posX - b.motion[j].posX), abs(a.motion[j].posY - b.motion[j].posY)));
+	// a deleted projectile's velocity does not matter
+	if (a.end_times[j] == Projectile::PROJECTILE_SPEED) {
+		most = max(most, max(abs(a.motion[j].velX - b.motion[j].velX), abs(a.motion[j].velY - b.motion[j].velY)));
+	}
+	return most;
+}
+
+
+int main(int argc, char** argv) {
+	int frames = 2000;
+	if (argc > 1) {
+		frames = atoi(argv[1]);
+	}
+	if (frames <= 0) {
+		printf("usage: %s [frames]\n", argv[0]);
+		return 1;
+	}
+
+	simd_kernel best = best_simd_kernel();
+	printf("best kernel on this processor: %s\n\n", simd_kernel_name(best));
+
+	Frame frame;
+	Projectile_Batch batch(SCREEN_WIDTH, SCREEN_HEIGHT);
+	batch.use_kernel(SCALAR_KERNEL);
+	Projectile_Batch kernel_batch(SCREEN_WIDTH, SCREEN_HEIGHT);
+	frame_result kernel_result;
+	frame_result expected;
+	frame_result result;
+	frame_result finer;
+	frame_result finer_end;
+	frame_result result_end;
+
+	// the batch against the small moves
+	long long refined = 0;
+	long long corners = 0;
+	long long frame_ends = 0;
+	long long grazes = 0;
+	long long differed = 0;
+	long long caught = 0;
+	long long wall_ends = 0;
+	long long bounces = 0;
+	long long player_hits = 0;
+	long long filtered = 0;
+	long long kernels_differed = 0;
+	for (int f = 0; f < frames; f++) {
+		frame.fill(f);
+		frame.run_moves(expected);
+		frame.run_batch(batch, result);
+		bounces += batch.bounces;
+		filtered += batch.filtered;
+		for (int kernel = SSE2_KERNEL; kernel <= best; kernel++) {
+			kernel_batch.use_kernel((simd_kernel) kernel);
+			frame.run_batch(kernel_batch, kernel_result);
+			if (!same_results(result, kernel_result) || (kernel_batch.filtered != batch.filtered)) {
+				kernels_differed++;
+			}
+		}
+		for (int j = 0; j < PROJECTILES; j++) {
+			wall_ends += (result.end_times[j] < Projectile::PROJECTILE_SPEED);
+			player_hits += __builtin_popcount(result.hits[j]);
+			caught += (expected.bounces[j] >= Projectile_Batch::MAX_BOUNCES);
+			if (difference(expected, result, j) <= TOLERANCE) {
+				continue;
+			}
+
+			// the small moves find a collision up to a move late, or miss a graze between two moves, and
+			// after a bounce the error is carried on, smaller moves must then come closer to the batch
+			bool agreed = false;
+			finer = expected;
+			for (int moves = MOVES * REFINE; !agreed && (moves <= MOVES * REFINE * REFINE); moves *= REFINE) {
+				frame.move_projectile(j, moves, finer);
+				agreed = difference(finer, result, j) <= TOLERANCE;
+			}
+
+			// a projectile that ends the frame touching a wall can bounce off it at the end of this frame or at
+			// the start of the next one, both are checked once more after the smallest move into the next frame
+			bool at_end = false;
+			if (!agreed && (finer.end_times[j] == Projectile::PROJECTILE_SPEED) &&
+				(result.end_times[j] == Projectile::PROJECTILE_SPEED)) {
+				finer_end = finer;
+				result_end = result;
+				for (Projectile* ball : {&finer_end.motion[j], &result_end.motion[j]}) {
+					ball->posX += ball->velX / (MOVES * REFINE * REFINE);
+					ball->posY += ball->velY / (MOVES * REFINE * REFINE);
+				}
+				at_end = !frame.check_move(j, Projectile::PROJECTILE_SPEED, finer_end) &&
+						 !frame.check_move(j, Projectile::PROJECTILE_SPEED, result_end) &&
+						 (difference(finer_end, result_end, j) <= TOLERANCE);
+			}
+
+			// a projectile that only just touches something, or only just misses it
+			bool grazed = false;
+			finer_end = finer;
+			for (double nudge = - GRAZE; !agreed && !grazed && (nudge <= GRAZE); nudge += 2 * GRAZE) {
+				frame.radius = Projectile::RADIUS + nudge;
+				frame.move_projectile(j, MOVES * REFINE * REFINE, finer_end);
+				grazed = difference(finer_end, result, j) <= TOLERANCE;
+			}
+			frame.radius = Projectile::RADIUS;
+
+			if (agreed) {
+				refined++;
+			} else if (finer.corners[j]) {
+				corners++;
+			} else if (at_end) {
+				frame_ends++;
+			} else if (grazed) {
+				grazes++;
+			} else {
+				if (differed < 5) {
+					printf("  frame %d, projectile %d: ended at %.3f with hits %x at (%.3f, %.3f), the smallest moves at %.3f with hits %x at (%.3f, %.3f)\n",
+						   f, j, result.end_times[j], result.hits[j], result.motion[j].posX, result.motion[j].posY,
+						   finer.end_times[j], finer.hits[j], finer.motion[j].posX, finer.motion[j].posY);
+				}
+				differed++;
+			}
+		}
+	}
+	long long checked = (long long) frames * PROJECTILES;
+	printf("%lld projectiles checked: %lld hit a wall end, %lld bounces, %lld players touched\n", checked, wall_ends,
+		   bounces, player_hits);
+	printf("%lld caught between walls, %lld only agreed with smaller moves, %lld bounced off two walls at once,\n", caught,
+		   refined, corners);
+	printf("%lld bounced at the end of the frame, %lld touched something at exactly the radius, %lld differed\n",
+		   frame_ends, grazes, differed);
+	printf("%lld walls and players left out by the pre-filter, %lld frames where a kernel differed from the scalar kernel\n",
+		   filtered, kernels_differed);
+	bool correct = (differed == 0) && (kernels_differed == 0);
+
+	// the time for one projectile's frame, on the same frames
+	printf("\n%-22s %10s\n", "", "ns/projectile");
+	long long fill_ns = 0;
+	{
+		chrono::steady_clock::time_point fill_start = chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++) {
+			frame.fill(f);
+		}
+		fill_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - fill_start).count();
+	}
+
+	long long deleted = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int f = 0; f < frames; f++) {
+		frame.fill(f);
+		deleted += frame.run_checks();
+	}
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+	long long checks_ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count() - fill_ns;
+	printf("%-22s %10.1f\n", "checks every step", (double) checks_ns / checked);
+
+	for (int kernel = SCALAR_KERNEL; kernel <= best; kernel++) {
+		batch.use_kernel((simd_kernel) kernel);
+		start = chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++) {
+			frame.fill(f);
+			frame.run_batch(batch, result);
+		}
+		end = chrono::steady_clock::now();
+		long long batch_ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count() - fill_ns;
+		char name[32];
+		snprintf(name, sizeof(name), "swept, %s filter", simd_kernel_name((simd_kernel) kernel));
+		printf("%-22s %10.1f\n", name, (double) batch_ns / checked);
+	}
+
+	// keeps the compiler from leaving out the work
+	if (deleted == 42) {
+		printf(" ");
+	}
+
+	printf("\n%s\n", correct ? "the batch matched the small moves with every kernel" : "CHECK FAILED: the batch differed from the small moves, or a kernel from the scalar kernel");
+	return correct ? 0 : 1;
+}
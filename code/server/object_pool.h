@@ -0,0 +1,131 @@
+/*
+Object pool header file
+A fixed number of objects of one type, created and destroyed without the global allocator
+
+Chaos The Game
+
+The memory for every object is allocated once, when the pool is created. Creating an object
+constructs it in a free slot, destroying it runs its destructor and frees the slot for the next
+object. If every slot is taken the object is allocated normally instead, and destroy tells the two
+apart by address, so a pool that is too small only makes the game slower, never wrong.
+A pool is used by one thread at a time.
+*/
+
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+
+template <typename T>
+class Object_Pool {
+
+public:
+	// allocates room for capacity objects
+	Object_Pool(int capacity);
+	// every object must have been destroyed first
+	~Object_Pool();
+
+	// constructs an object from the arguments, in the pool unless it is full
+	template <typename... Args>
+	T* create(Args&&... args);
+	// destroys an object created by this pool
+	void destroy(T* object);
+
+	// true if the object is in one of the pool's slots
+	bool owns(const T* object) const;
+	// the number of objects in the pool's slots
+	int size() const;
+	int get_capacity() const;
+	// the number of objects that were allocated normally because the pool was full
+	long long get_overflow_count() const;
+
+	// a pool owns its memory, it is never copied
+	Object_Pool(const Object_Pool&) = delete;
+	Object_Pool& operator=(const Object_Pool&) = delete;
+
+private:
+	// the memory for one object
+	typedef typename aligned_storage<sizeof(T), alignof(T)>::type slot;
+
+	slot* slots;
+	int capacity;
+	// the free slots, the lowest index is at the back so slots are handed out in order
+	vector<int> free_slots;
+	long long overflow_count;
+
+};
+
+
+template <typename T>
+Object_Pool<T>::Object_Pool(int capacity) : capacity(capacity) {
+	slots = new slot[capacity];
+	free_slots.reserve(capacity);
+	for (int i = capacity - 1; i >= 0; i--) {
+		free_slots.push_back(i);
+	}
+	overflow_count = 0;
+}
+
+template <typename T>
+Object_Pool<T>::~Object_Pool() {
+	delete[] slots;
+}
+
+template <typename T>
+template <typename... Args>
+T* Object_Pool<T>::create(Args&&... args) {
+	if (free_slots.empty()) {
+		overflow_count++;
+		return new T(std::forward<Args>(args)...);
+	}
+
+	int index = free_slots.back();
+	free_slots.pop_back();
+	return new (&slots[index]) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void Object_Pool<T>::destroy(T* object) {
+	if (object == NULL) {
+		return;
+	}
+	if (!owns(object)) {
+		delete object;
+		return;
+	}
+
+	object->~T();
+	// the free list was reserved at full size, so this never allocates
+	free_slots.push_back((slot*) object - slots);
+}
+
+template <typename T>
+bool Object_Pool<T>::owns(const T* object) const {
+	uintptr_t address = (uintptr_t) object;
+	return (address >= (uintptr_t) slots) && (address < (uintptr_t) (slots + capacity));
+}
+
+template <typename T>
+int Object_Pool<T>::size() const {
+	return capacity - free_slots.size();
+}
+
+template <typename T>
+int Object_Pool<T>::get_capacity() const {
+	return capacity;
+}
+
+template <typename T>
+long long Object_Pool<T>::get_overflow_count() const {
+	return overflow_count;
+}
+
+#endif
@@ -9,6 +9,7 @@ Chaos The Game
 
 #include "polygon.h"
 #include "point_vect_struct.h"
+#include "rotation_table.h"
 
 #include <iostream>
 #include <string>
@@ -32,9 +33,16 @@ Player::Player() {
 	rotation = 0;
 	rotationVel = 0;
 	
+	// set slot to -1 to signal that the player has not been added to an arena yet
+	slot = -1;
+	
 	// set rectangle dimensions for the collision box
 	body.rect_width = PLAYER_WIDTH;
 	body.rect_height = PLAYER_HEIGHT;
+	// the body is built the first time it is needed
+	body_built = false;
+	body_rebuilds = 0;
+	body_reuses = 0;
 	
 	// the player should be ready to shoot at the start of the game
 	shoot_projectile = false;
@@ -48,36 +56,37 @@ Player::~Player() {
 
 // calculate the corners of the rectangle
 void Player::update_rectangle_points() {
-	// calculate the unit vectors normal to the rectangle along both axes
-	vect v1;
-	v1.x = sin(newRotation * (M_PI / 180));
-	v1.y = - cos(newRotation * (M_PI / 180));
-	// second vector is perpendicular to the first
-	vect v2;
-	v2.x = v1.y;
-	v2.y = -v1.x;
+	// the body is already at the temp position and rotation
+	if (body_built && (newX == body_x) && (newY == body_y) && (newRotation == body_rotation)) {
+		body_reuses++;
+		return;
+	}
+	body_built = true;
+	body_x = newX;
+	body_y = newY;
+	body_rotation = newRotation;
+	body_rebuilds++;
 	
-	// scale both vectors
-	v1.x *= PLAYER_HEIGHT / 2;
-	v1.y *= PLAYER_HEIGHT / 2;
-	v2.x *= PLAYER_WIDTH / 2;
-	v2.y *= PLAYER_WIDTH / 2;
+	// the vectors from the center to the middle of the front and of the side, already scaled to the
+	// rectangle's size, the second is perpendicular to the first
+	half_side v1 = Rotation_Table::player_length(newRotation);
+	half_side v2 = Rotation_Table::player_width(newRotation);
 	
-	// clear the points vector
-	body.points.clear();
+	// clear the points
+	body.clear_points();
 	
 	// calculate the corners by moving the center by the normal vectors
 	point p1((int) (newX + v1.x + v2.x + 0.5), (int) (newY + v1.y + v2.y + 0.5));
-	body.points.push_back(p1);
+	body.add_point(p1);
 	
 	point p2((int) (newX - v1.x + v2.x + 0.5), (int) (newY - v1.y + v2.y + 0.5));
-	body.points.push_back(p2);
+	body.add_point(p2);
 	
 	point p3((int) (newX - v1.x - v2.x + 0.5), (int) (newY - v1.y - v2.y + 0.5));
-	body.points.push_back(p3);
+	body.add_point(p3);
 	
 	point p4((int) (newX + v1.x - v2.x + 0.5), (int) (newY + v1.y - v2.y + 0.5));
-	body.points.push_back(p4);
+	body.add_point(p4);
 	
 	// set other values for the collision box
 	body.center.x = newX;
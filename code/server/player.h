@@ -47,12 +47,16 @@ public:
 	// the color of the player's rectangle
 	string color;
 	
+	// the index of the player within its arena, identifies the player in input messages
+	int slot;
+	
 	// the state of the player's projectile-firing ability
 	// necessary to fire projectiles and ensure only one is fired for each key press
 	bool shoot_projectile;
 	bool ready_to_shoot;
 	
 	// calculate the corners of the rectangle
+	// the body is kept until the temp position or rotation changes, so it is only rebuilt when it has moved
 	void update_rectangle_points();
 	
 	// temp values used for collision checking
@@ -65,6 +69,18 @@ public:
 	
 	// the polygon used for collision checking
 	Polygon body;
+	
+	// the number of times the body has been rebuilt, and kept because it had not moved
+	// counted and cleared by the arena each frame
+	int body_rebuilds;
+	int body_reuses;
+
+private:
+	// the temp position and rotation the body was last built at
+	bool body_built;
+	double body_x;
+	double body_y;
+	int body_rotation;
 
 };
 
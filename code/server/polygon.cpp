@@ -13,12 +13,20 @@ using namespace std;
 
 
 Polygon::Polygon() {
-	
+	num_points = 0;
 }
 
 Polygon::~Polygon() {
 	
 }
 
+void Polygon::clear_points() {
+	num_points = 0;
+}
+
+void Polygon::add_point(point p) {
+	points[num_points] = p;
+	num_points++;
+}
 
 
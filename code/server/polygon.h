@@ -10,7 +10,7 @@ Chaos The Game
 
 #include "point_vect_struct.h"
 
-#include <vector>
+#include <array>
 
 using namespace std;
 
@@ -22,8 +22,18 @@ public:
 	Polygon();
 	~Polygon();
 	
-	// list of points that makes up the polygons
-	vector<point> points;
+	// the most points a polygon can have, a player's rectangle
+	static const int MAX_POINTS = 4;
+	
+	// list of points that makes up the polygons, kept inside the polygon so copying it never allocates
+	// only the first num_points are used
+	array<point, MAX_POINTS> points;
+	int num_points;
+	
+	// remove every point
+	void clear_points();
+	// add a point after the last one, there must be room for it
+	void add_point(point p);
 	
 	// values that are necessary for rectangle collision checking
 	point center;
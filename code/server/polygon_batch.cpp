@@ -0,0 +1,327 @@
+/*
+Polygon batch class file
+Tests one polygon against many at once with the separating axis theorem
+
+Chaos The Game
+*/
+
+#include "polygon_batch.h"
+#include "polygon.h"
+#include "simd_kernel.h"
+
+#include <string.h>
+#include <stdint.h>
+
+using namespace std;
+
+
+// the points of a batch polygon, one array for each corner, x[corner][polygon]
+typedef double batch_points[Polygon::MAX_POINTS][Polygon_Batch::MAX_POLYGONS];
+
+/*
+the edges of the polygon being tested, worked out once for the whole batch
+the normal of each edge and the smallest and largest projections of the polygon's points onto it
+*/
+typedef struct polygon_edges {
+	int count;
+	double normal_x[Polygon::MAX_POINTS];
+	double normal_y[Polygon::MAX_POINTS];
+	double min[Polygon::MAX_POINTS];
+	double max[Polygon::MAX_POINTS];
+	// the polygon's points
+	double point_x[Polygon::MAX_POINTS];
+	double point_y[Polygon::MAX_POINTS];
+} polygon_edges;
+
+static void find_edges(const Polygon& polygon, polygon_edges& edges) {
+	edges.count = polygon.num_points;
+	for (int i = 0; i < polygon.num_points; i++) {
+		edges.point_x[i] = polygon.points[i].x;
+		edges.point_y[i] = polygon.points[i].y;
+	}
+
+	for (int i1 = 0; i1 < polygon.num_points; i1++) {
+		int i2 = (i1 + 1) % polygon.num_points;
+		point p1 = polygon.points[i1];
+		point p2 = polygon.points[i2];
+		edges.normal_x[i1] = p2.y - p1.y;
+		edges.normal_y[i1] = p1.x - p2.x;
+
+		edges.min[i1] = edges.max[i1] = (edges.normal_x[i1] * edges.point_x[0]) + (edges.normal_y[i1] * edges.point_y[0]);
+		for (int i = 1; i < polygon.num_points; i++) {
+			double projection = (edges.normal_x[i1] * edges.point_x[i]) + (edges.normal_y[i1] * edges.point_y[i]);
+			if (projection < edges.min[i1]) {
+				edges.min[i1] = projection;
+			}
+			if (projection > edges.max[i1]) {
+				edges.max[i1] = projection;
+			}
+		}
+	}
+}
+
+
+/*
+the kernels
+each tests the polygon against the first count batch polygons, and returns a mask with a
+bit set for each one it collides with
+a pair collides unless an edge of either polygon is a separating axis, with the projections of the two
+polygons onto its normal not overlapping
+*/
+
+static uint64_t collide_scalar(const polygon_edges& edges, const batch_points& x, const batch_points& y, int count) {
+	uint64_t hits = 0;
+	for (int j = 0; j < count; j++) {
+		bool separated = false;
+
+		// the edges of the polygon being tested
+		for (int e = 0; (e < edges.count) && !separated; e++) {
+			double min_b = (edges.normal_x[e] * x[0][j]) + (edges.normal_y[e] * y[0][j]);
+			double max_b = min_b;
+			for (int k = 1; k < Polygon::MAX_POINTS; k++) {
+				double projection = (edges.normal_x[e] * x[k][j]) + (edges.normal_y[e] * y[k][j]);
+				if (projection < min_b) {
+					min_b = projection;
+				}
+				if (projection > max_b) {
+					max_b = projection;
+				}
+			}
+			if ((edges.max[e] < min_b) || (max_b < edges.min[e])) {
+				separated = true;
+			}
+		}
+
+		// the edges of the batch polygon
+		for (int k1 = 0; (k1 < Polygon::MAX_POINTS) && !separated; k1++) {
+			int k2 = (k1 + 1) % Polygon::MAX_POINTS;
+			double normal_x = y[k2][j] - y[k1][j];
+			double normal_y = x[k1][j] - x[k2][j];
+
+			double min_a = (normal_x * edges.point_x[0]) + (normal_y * edges.point_y[0]);
+			double max_a = min_a;
+			for (int i = 1; i < edges.count; i++) {
+				double projection = (normal_x * edges.point_x[i]) + (normal_y * edges.point_y[i]);
+				if (projection < min_a) {
+					min_a = projection;
+				}
+				if (projection > max_a) {
+					max_a = projection;
+				}
+			}
+
+			double min_b = (normal_x * x[0][j]) + (normal_y * y[0][j]);
+			double max_b = min_b;
+			for (int k = 1; k < Polygon::MAX_POINTS; k++) {
+				double projection = (normal_x * x[k][j]) + (normal_y * y[k][j]);
+				if (projection < min_b) {
+					min_b = projection;
+				}
+				if (projection > max_b) {
+					max_b = projection;
+				}
+			}
+			if ((max_a < min_b) || (max_b < min_a)) {
+				separated = true;
+			}
+		}
+
+		if (!separated) {
+			hits |= (uint64_t) 1 << j;
+		}
+	}
+	return hits;
+}
+
+#ifdef SIMD_KERNELS
+
+/*
+two batch polygons at a time, the batch is padded to a whole number of registers
+the separated lanes are collected in a mask instead of stopping early, every lane goes through every axis
+*/
+__attribute__((target("sse2")))
+static uint64_t collide_sse2(const polygon_edges& edges, const batch_points& x, const batch_points& y, int count) {
+	uint64_t hits = 0;
+	for (int j = 0; j < count; j += 2) {
+		__m128d px[Polygon::MAX_POINTS];
+		__m128d py[Polygon::MAX_POINTS];
+		for (int k = 0; k < Polygon::MAX_POINTS; k++) {
+			px[k] = _mm_loadu_pd(&x[k][j]);
+			py[k] = _mm_loadu_pd(&y[k][j]);
+		}
+		__m128d separated = _mm_setzero_pd();
+
+		// the edges of the polygon being tested, the same normal for both lanes
+		for (int e = 0; e < edges.count; e++) {
+			__m128d nx = _mm_set1_pd(edges.normal_x[e]);
+			__m128d ny = _mm_set1_pd(edges.normal_y[e]);
+			__m128d min_b = _mm_add_pd(_mm_mul_pd(nx, px[0]), _mm_mul_pd(ny, py[0]));
+			__m128d max_b = min_b;
+			for (int k = 1; k < Polygon::MAX_POINTS; k++) {
+				__m128d projection = _mm_add_pd(_mm_mul_pd(nx, px[k]), _mm_mul_pd(ny, py[k]));
+				min_b = _mm_min_pd(min_b, projection);
+				max_b = _mm_max_pd(max_b, projection);
+			}
+			separated = _mm_or_pd(separated, _mm_cmplt_pd(_mm_set1_pd(edges.max[e]), min_b));
+			separated = _mm_or_pd(separated, _mm_cmplt_pd(max_b, _mm_set1_pd(edges.min[e])));
+		}
+
+		// the edges of the batch polygons, a different normal in each lane
+		for (int k1 = 0; k1 < Polygon::MAX_POINTS; k1++) {
+			int k2 = (k1 + 1) % Polygon::MAX_POINTS;
+			__m128d nx = _mm_sub_pd(py[k2], py[k1]);
+			__m128d ny = _mm_sub_pd(px[k1], px[k2]);
+
+			__m128d min_a = _mm_add_pd(_mm_mul_pd(nx, _mm_set1_pd(edges.point_x[0])),
+									   _mm_mul_pd(ny, _mm_set1_pd(edges.point_y[0])));
+			__m128d max_a = min_a;
+			for (int i = 1; i < edges.count; i++) {
+				__m128d projection = _mm_add_pd(_mm_mul_pd(nx, _mm_set1_pd(edges.point_x[i])),
+												_mm_mul_pd(ny, _mm_set1_pd(edges.point_y[i])));
+				min_a = _mm_min_pd(min_a, projection);
+				max_a = _mm_max_pd(max_a, projection);
+			}
+
+			__m128d min_b = _mm_add_pd(_mm_mul_pd(nx, px[0]), _mm_mul_pd(ny, py[0]));
+			__m128d max_b = min_b;
+			for (int k = 1; k < Polygon::MAX_POINTS; k++) {
+				__m128d projection = _mm_add_pd(_mm_mul_pd(nx, px[k]), _mm_mul_pd(ny, py[k]));
+				min_b = _mm_min_pd(min_b, projection);
+				max_b = _mm_max_pd(max_b, projection);
+			}
+			separated = _mm_or_pd(separated, _mm_cmplt_pd(max_a, min_b));
+			separated = _mm_or_pd(separated, _mm_cmplt_pd(max_b, min_a));
+		}
+
+		hits |= (uint64_t) (~_mm_movemask_pd(separated) & 0x3) << j;
+	}
+	return hits;
+}
+
+// four batch polygons at a time, the batch is padded to a whole number of registers
+__attribute__((target("avx2")))
+static uint64_t collide_avx2(const polygon_edges& edges, const batch_points& x, const batch_points& y, int count) {
+	uint64_t hits = 0;
+	for (int j = 0; j < count; j += 4) {
+		__m256d px[Polygon::MAX_POINTS];
+		__m256d py[Polygon::MAX_POINTS];
+		for (int k = 0; k < Polygon::MAX_POINTS; k++) {
+			px[k] = _mm256_loadu_pd(&x[k][j]);
+			py[k] = _mm256_loadu_pd(&y[k][j]);
+		}
+		__m256d separated = _mm256_setzero_pd();
+
+		for (int e = 0; e < edges.count; e++) {
+			__m256d nx = _mm256_set1_pd(edges.normal_x[e]);
+			__m256d ny = _mm256_set1_pd(edges.normal_y[e]);
+			__m256d min_b = _mm256_add_pd(_mm256_mul_pd(nx, px[0]), _mm256_mul_pd(ny, py[0]));
+			__m256d max_b = min_b;
+			for (int k = 1; k < Polygon::MAX_POINTS; k++) {
+				__m256d projection = _mm256_add_pd(_mm256_mul_pd(nx, px[k]), _mm256_mul_pd(ny, py[k]));
+				min_b = _mm256_min_pd(min_b, projection);
+				max_b = _mm256_max_pd(max_b, projection);
+			}
+			separated = _mm256_or_pd(separated, _mm256_cmp_pd(_mm256_set1_pd(edges.max[e]), min_b, _CMP_LT_OQ));
+			separated = _mm256_or_pd(separated, _mm256_cmp_pd(max_b, _mm256_set1_pd(edges.min[e]), _CMP_LT_OQ));
+		}
+
+		for (int k1 = 0; k1 < Polygon::MAX_POINTS; k1++) {
+			int k2 = (k1 + 1) % Polygon::MAX_POINTS;
+			__m256d nx = _mm256_sub_pd(py[k2], py[k1]);
+			__m256d ny = _mm256_sub_pd(px[k1], px[k2]);
+
+			__m256d min_a = _mm256_add_pd(_mm256_mul_pd(nx, _mm256_set1_pd(edges.point_x[0])),
+										  _mm256_mul_pd(ny, _mm256_set1_pd(edges.point_y[0])));
+			__m256d max_a = min_a;
+			for (int i = 1; i < edges.count; i++) {
+				__m256d projection = _mm256_add_pd(_mm256_mul_pd(nx, _mm256_set1_pd(edges.point_x[i])),
+												   _mm256_mul_pd(ny, _mm256_set1_pd(edges.point_y[i])));
+				min_a = _mm256_min_pd(min_a, projection);
+				max_a = _mm256_max_pd(max_a, projection);
+			}
+
+			__m256d min_b = _mm256_add_pd(_mm256_mul_pd(nx, px[0]), _mm256_mul_pd(ny, py[0]));
+			__m256d max_b = min_b;
+			for (int k = 1; k < Polygon::MAX_POINTS; k++) {
+				__m256d projection = _mm256_add_pd(_mm256_mul_pd(nx, px[k]), _mm256_mul_pd(ny, py[k]));
+				min_b = _mm256_min_pd(min_b, projection);
+				max_b = _mm256_max_pd(max_b, projection);
+			}
+			separated = _mm256_or_pd(separated, _mm256_cmp_pd(max_a, min_b, _CMP_LT_OQ));
+			separated = _mm256_or_pd(separated, _mm256_cmp_pd(max_b, min_a, _CMP_LT_OQ));
+		}
+
+		hits |= (uint64_t) (~_mm256_movemask_pd(separated) & 0xf) << j;
+	}
+	return hits;
+}
+
+#endif
+
+
+Polygon_Batch::Polygon_Batch() {
+	// the padding past the last polygon is tested by the vectorized kernels and thrown away, so it is
+	// kept at real numbers
+	memset(x, 0, sizeof(x));
+	memset(y, 0, sizeof(y));
+	count = 0;
+	kernel = best_simd_kernel();
+}
+
+Polygon_Batch::~Polygon_Batch() {
+
+}
+
+void Polygon_Batch::clear() {
+	count = 0;
+}
+
+void Polygon_Batch::add(const Polygon& polygon) {
+	for (int k = 0; k < Polygon::MAX_POINTS; k++) {
+		// the missing points repeat the last one
+		point p = polygon.points[k < polygon.num_points ? k : polygon.num_points - 1];
+		x[k][count] = p.x;
+		y[k][count] = p.y;
+	}
+	count++;
+}
+
+int Polygon_Batch::size() const {
+	return count;
+}
+
+uint64_t Polygon_Batch::collide(const Polygon& polygon) const {
+	// a polygon without points has nothing to collide with
+	if ((count == 0) || (polygon.num_points == 0)) {
+		return 0;
+	}
+
+	polygon_edges edges;
+	find_edges(polygon, edges);
+
+	uint64_t hits;
+#ifdef SIMD_KERNELS
+	if (kernel == AVX2_KERNEL) {
+		hits = collide_avx2(edges, x, y, count);
+	} else if (kernel == SSE2_KERNEL) {
+		hits = collide_sse2(edges, x, y, count);
+	} else {
+		hits = collide_scalar(edges, x, y, count);
+	}
+#else
+	hits = collide_scalar(edges, x, y, count);
+#endif
+
+	// the padding past the last polygon
+	if (count < MAX_POLYGONS) {
+		hits &= ((uint64_t) 1 << count) - 1;
+	}
+	return hits;
+}
+
+void Polygon_Batch::use_kernel(simd_kernel requested) {
+	kernel = requested;
+	if (kernel > best_simd_kernel()) {
+		kernel = best_simd_kernel();
+	}
+}
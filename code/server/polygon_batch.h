@@ -0,0 +1,62 @@
+/*
+Polygon batch class header file
+Tests one polygon against many at once with the separating axis theorem
+
+Chaos The Game
+
+The polygons in a batch are packed one array for each corner and axis, so a vectorized kernel, AVX2
+or SSE2, can test one polygon against four or two of them at a time, the same way
+Collisions::polygon_collision tests a pair. A polygon with fewer than MAX_POINTS points is padded by
+repeating its last point, which only adds edges with no normal, and those never separate anything.
+The corners are whole pixels, so every projection is exact and every kernel gives exactly the same
+results as polygon_collision. polygon_bench checks this.
+*/
+
+#ifndef POLYGON_BATCH_H
+#define POLYGON_BATCH_H
+
+#include "polygon.h"
+#include "simd_kernel.h"
+
+#include <stdint.h>
+
+using namespace std;
+
+
+class Polygon_Batch {
+
+public:
+	Polygon_Batch();
+	~Polygon_Batch();
+
+	// the most polygons a batch can hold, one bit of the hit mask each
+	static const int MAX_POLYGONS = 64;
+
+	// removes every polygon
+	void clear();
+	// adds a copy of the polygon's points, the polygon must have a point and there must be room for it
+	void add(const Polygon& polygon);
+	// the number of polygons
+	int size() const;
+
+	/*
+	tests the polygon against every polygon in the batch
+	bit i of the mask is set if the polygon collides with the i-th polygon added
+	*/
+	uint64_t collide(const Polygon& polygon) const;
+
+	// used by the benchmarks to compare the kernels, falls back to the best kernel if the processor
+	// does not support the one asked for
+	void use_kernel(simd_kernel requested);
+	// the kernel collide uses, the fastest the processor supports unless use_kernel was called
+	simd_kernel kernel;
+
+private:
+	// the corners of each polygon, x[corner][polygon] and y[corner][polygon]
+	double x[Polygon::MAX_POINTS][MAX_POLYGONS];
+	double y[Polygon::MAX_POINTS][MAX_POLYGONS];
+	int count;
+
+};
+
+#endif
@@ -0,0 +1,182 @@
+/*
+Polygon batch benchmark
+
+Chaos The Game
+
+Tests random player and wall bodies against batches of random player bodies and walls with each
+kernel the processor supports, scalar, SSE2 and AVX2, and checks every bit of every hit mask against
+Collisions::polygon_collision for the same pair, in both orders. The bodies are placed close together
+so about two thirds of the pairs collide, at every rotation, including players and walls that only
+just touch. Then the time to test one pair is printed for each kernel and each batch size, next to
+polygon_collision.
+
+usage: ./polygon_bench.out [rounds]
+*/
+
+// include game files
+#include "polygon_batch.h"
+#include "polygon.h"
+#include "collisions.h"
+#include "player.h"
+#include "wall.h"
+
+// include other dependencies
+#include <vector>
+#include <chrono>
+#include <stdint.h>
+// used for printing and random number generation
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+// the batch sizes timed, a few players, every wall, and a full batch
+static const int BATCH_SIZES[] = {3, 8, Polygon_Batch::MAX_POLYGONS};
+// the side of the square the bodies are placed in, small enough for many of them to collide
+static const int AREA = 160;
+
+
+// a player's body at a random position and rotation in the area
+Polygon random_player() {
+	Player player;
+	player.newX = 300 + (double) rand() / RAND_MAX * AREA;
+	player.newY = 200 + (double) rand() / RAND_MAX * AREA;
+	player.newRotation = rand() % 360;
+	player.update_rectangle_points();
+	return player.body;
+}
+
+// a wall's body at a random position and rotation in the area
+Polygon random_wall() {
+	Wall wall(300 + rand() % AREA, 200 + rand() % AREA, 0);
+	wall.newRotation = rand() % 360;
+	wall.update_points();
+	return wall.body;
+}
+
+// fills the list with count bodies, walls or players picked at random
+void random_bodies(vector<Polygon>& bodies, int count) {
+	bodies.clear();
+	for (int i = 0; i < count; i++) {
+		bodies.push_back((rand() % 3 == 0) ? random_wall() : random_player());
+	}
+}
+
+// the hit mask polygon_collision gives for the bodies
+uint64_t scalar_mask(const Polygon& polygon, const vector<Polygon>& bodies, bool& orders_agree) {
+	uint64_t hits = 0;
+	for (int i = 0; i < (int) bodies.size(); i++) {
+		bool hit = Collisions::polygon_collision(polygon, bodies[i]);
+		if (hit != Collisions::polygon_collision(bodies[i], polygon)) {
+			orders_agree = false;
+		}
+		if (hit) {
+			hits |= (uint64_t) 1 << i;
+		}
+	}
+	return hits;
+}
+
+// returns the time (nanoseconds) to test one pair, with a kernel or with polygon_collision if kernel is -1
+double time_pairs(const vector<Polygon>& players, const vector<Polygon>& bodies, int kernel) {
+	Polygon_Batch batch;
+	if (kernel >= 0) {
+		batch.use_kernel((simd_kernel) kernel);
+	}
+	for (const Polygon& body : bodies) {
+		batch.add(body);
+	}
+
+	uint64_t checksum = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (const Polygon& player : players) {
+		if (kernel >= 0) {
+			checksum += batch.collide(player);
+		} else {
+			for (const Polygon& body : bodies) {
+				checksum += Collisions::polygon_collision(player, body);
+			}
+		}
+	}
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	// keeps the compiler from leaving out the work
+	if (checksum == 42) {
+		printf(" ");
+	}
+	return (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / ((long long) players.size() * bodies.size());
+}
+
+
+int main(int argc, char** argv) {
+	int rounds = 20000;
+	if (argc > 1) {
+		rounds = atoi(argv[1]);
+	}
+	if (rounds <= 0) {
+		printf("usage: %s [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	simd_kernel best = best_simd_kernel();
+	printf("best kernel on this processor: %s\n\n", simd_kernel_name(best));
+
+	// every kernel against polygon_collision, for every batch size
+	srand(1);
+	bool correct = true;
+	bool orders_agree = true;
+	long long pairs = 0;
+	long long hits = 0;
+	vector<Polygon> bodies;
+	bodies.reserve(Polygon_Batch::MAX_POLYGONS);
+	for (int round = 0; round < rounds; round++) {
+		random_bodies(bodies, 1 + round % Polygon_Batch::MAX_POLYGONS);
+		Polygon player = (round % 4 == 0) ? random_wall() : random_player();
+		uint64_t expected = scalar_mask(player, bodies, orders_agree);
+		pairs += bodies.size();
+		hits += __builtin_popcountll(expected);
+
+		for (int kernel = SCALAR_KERNEL; kernel <= best; kernel++) {
+			Polygon_Batch batch;
+			batch.use_kernel((simd_kernel) kernel);
+			for (const Polygon& body : bodies) {
+				batch.add(body);
+			}
+			uint64_t mask = batch.collide(player);
+			if (mask != expected) {
+				printf("  round %d, %s kernel: mask %016llx, polygon_collision %016llx\n", round,
+					   simd_kernel_name((simd_kernel) kernel), (unsigned long long) mask, (unsigned long long) expected);
+				correct = false;
+			}
+		}
+	}
+	printf("%lld pairs checked, %lld collide\n", pairs, hits);
+	if (!orders_agree) {
+		printf("  CHECK FAILED: polygon_collision changed its answer when the polygons were swapped\n");
+		correct = false;
+	}
+
+	// the time for one pair
+	printf("\n%-12s %16s", "batch size", "polygon_collision");
+	for (int kernel = SCALAR_KERNEL; kernel <= best; kernel++) {
+		printf(" %13s ns", simd_kernel_name((simd_kernel) kernel));
+	}
+	printf("\n");
+
+	vector<Polygon> players;
+	for (int i = 0; i < 1000; i++) {
+		players.push_back(random_player());
+	}
+	for (int size : BATCH_SIZES) {
+		random_bodies(bodies, size);
+		printf("%-12d %16.2f", size, time_pairs(players, bodies, -1));
+		for (int kernel = SCALAR_KERNEL; kernel <= best; kernel++) {
+			printf(" %16.2f", time_pairs(players, bodies, kernel));
+		}
+		printf("\n");
+	}
+
+	printf("\n%s\n", correct ? "every kernel matched polygon_collision" : "CHECK FAILED: a kernel differed from polygon_collision");
+	return correct ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+/*
+Object pool benchmark
+
+Chaos The Game
+
+Checks that the objects the game creates while it runs come from their pools instead of the global
+allocator, and times creating and destroying an object in a pool against new and delete.
+Bombs are spawned and expired through the bomb manager, walls created and cleaned up through the wall
+manager, and players through a pool, and none of them may allocate at all, now that the bodies keep
+their points inside them. A pool that is too small must hand out normally allocated objects, one
+allocation each, and destroy them.
+
+usage: ./pool_bench.out [cycles]
+*/
+
+// include game files
+#include "object_pool.h"
+#include "player.h"
+#include "wall.h"
+#include "wall_manager.h"
+#include "bomb.h"
+#include "bomb_manager.h"
+
+// include other dependencies
+#include <vector>
+#include <chrono>
+#include <new>
+// used for printing
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+/*
+allocation counting, the same as the arena benchmark
+every call into the global allocator made by this program goes through these operators
+*/
+
+// total number of allocations since the program started
+static unsigned long allocation_count = 0;
+
+void* operator new(size_t size) {
+	allocation_count++;
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
+
+
+// the number of objects created at once in the timing runs
+static const int BATCH = 16;
+// the players that connect and disconnect together, a full arena
+static const int PLAYERS = 4;
+
+// prints one check and returns whether it passed
+bool check(const char* name, unsigned long allocations, unsigned long expected) {
+	bool passed = (allocations == expected);
+	printf("  %-44s %10lu allocations, expected %lu %s\n", name, allocations, expected, passed ? "" : " FAILED");
+	return passed;
+}
+
+// spawns bombs up to the pool's capacity and expires them, cycles times
+unsigned long bomb_manager_cycles(int cycles) {
+	Bomb_Manager manager;
+	manager.start();
+
+	unsigned long allocations = allocation_count;
+	for (int cycle = 0; cycle < cycles; cycle++) {
+		while ((int) manager.bombs.size() < Bomb_Manager::BOMB_CAPACITY) {
+			manager.add_bomb(100 + cycle % 700, 100 + manager.bombs.size() * 20);
+		}
+		// every bomb is past its destroy time, the next update removes them all
+		chrono::time_point<chrono::system_clock> expired = chrono::system_clock::now() - chrono::seconds(60);
+		for (Bomb* bomb : manager.bombs) {
+			bomb->start_time = expired;
+		}
+		manager.update_bombs();
+	}
+	return allocation_count - allocations;
+}
+
+// creates and destroys the walls of a game, cycles times
+unsigned long wall_manager_cycles(int cycles) {
+	Wall_Manager manager;
+
+	unsigned long allocations = allocation_count;
+	for (int cycle = 0; cycle < cycles; cycle++) {
+		manager.start();
+		manager.clean_up();
+	}
+	return allocation_count - allocations;
+}
+
+// the same walls, allocated normally
+unsigned long wall_heap_cycles(int cycles) {
+	vector<Wall*> walls;
+	walls.reserve(Wall_Manager::NUM_WALLS);
+
+	unsigned long allocations = allocation_count;
+	for (int cycle = 0; cycle < cycles; cycle++) {
+		for (int i = 0; i < Wall_Manager::NUM_WALLS; i++) {
+			walls.push_back(new Wall(280, 140, 0));
+		}
+		for (Wall* wall : walls) {
+			delete wall;
+		}
+		walls.clear();
+	}
+	return allocation_count - allocations;
+}
+
+// creates and destroys count players in a pool, or normally without one, cycles times
+unsigned long player_cycles(int cycles, int count, bool pooled) {
+	Object_Pool<Player> pool(count);
+	vector<Player*> players;
+	players.reserve(count);
+
+	unsigned long allocations = allocation_count;
+	for (int cycle = 0; cycle < cycles; cycle++) {
+		for (int i = 0; i < count; i++) {
+			players.push_back(pooled ? pool.create() : new Player());
+		}
+		for (Player* player : players) {
+			if (pooled) {
+				pool.destroy(player);
+			} else {
+				delete player;
+			}
+		}
+		players.clear();
+	}
+	return allocation_count - allocations;
+}
+
+// returns the time (nanoseconds) to create and destroy one bomb
+double time_bombs(int cycles, bool pooled) {
+	Object_Pool<Bomb> pool(BATCH);
+	Bomb* bombs[BATCH];
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int cycle = 0; cycle < cycles; cycle++) {
+		for (int i = 0; i < BATCH; i++) {
+			bombs[i] = pooled ? pool.create(i, cycle) : new Bomb(i, cycle);
+		}
+		for (int i = 0; i < BATCH; i++) {
+			if (pooled) {
+				pool.destroy(bombs[i]);
+			} else {
+				delete bombs[i];
+			}
+		}
+	}
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	return (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / ((long long) cycles * BATCH);
+}
+
+
+int main(int argc, char** argv) {
+	int cycles = 10000;
+	if (argc > 1) {
+		cycles = atoi(argv[1]);
+	}
+	if (cycles <= 0) {
+		printf("usage: %s [cycles]\n", argv[0]);
+		return 1;
+	}
+
+	bool correct = true;
+	printf("allocations over %d cycles\n", cycles);
+
+	// spawning and expiring bombs is done every few seconds in every arena
+	correct &= check("bomb manager, spawn and expire", bomb_manager_cycles(cycles), 0);
+
+	// allocated normally, each wall and player is exactly one allocation
+	correct &= check("walls with new and delete", wall_heap_cycles(cycles),
+					 (unsigned long) cycles * Wall_Manager::NUM_WALLS);
+	correct &= check("wall manager, create and clean up", wall_manager_cycles(cycles), 0);
+
+	correct &= check("players with new and delete", player_cycles(cycles, PLAYERS, false),
+					 (unsigned long) cycles * PLAYERS);
+	correct &= check("player pool, connect and disconnect", player_cycles(cycles, PLAYERS, true), 0);
+
+	// a pool that is too small falls back to the global allocator, one allocation for each extra bomb
+	{
+		Object_Pool<Bomb> pool(BATCH);
+		vector<Bomb*> bombs;
+		bombs.reserve(BATCH * 2);
+
+		unsigned long allocations = allocation_count;
+		for (int i = 0; i < BATCH * 2; i++) {
+			bombs.push_back(pool.create(i, i));
+		}
+		correct &= check("full pool, twice its capacity", allocation_count - allocations, BATCH);
+		for (Bomb* bomb : bombs) {
+			pool.destroy(bomb);
+		}
+		if ((pool.size() != 0) || (pool.get_overflow_count() != BATCH)) {
+			printf("  CHECK FAILED: the pool holds %d bombs after destroying them all, %lld overflowed\n",
+				   pool.size(), pool.get_overflow_count());
+			correct = false;
+		}
+	}
+
+	printf("\ncreate and destroy one bomb\n");
+	printf("  %-12s %10.1f ns\n", "new/delete", time_bombs(cycles, false));
+	printf("  %-12s %10.1f ns\n", "pool", time_bombs(cycles, true));
+
+	printf("\n%s\n", correct ? "every pool check passed" : "CHECK FAILED: a pool allocated more than expected");
+	return correct ? 0 : 1;
+}
@@ -5,6 +5,7 @@ Chaos The Game
 */
 
 #include "projectile.h"
+#include "rotation_table.h"
 
 #include <cmath>
 
@@ -13,14 +14,27 @@ using namespace std;
 
 // given information about the shooter, form a projecile and assign its initial qualities
 Projectile::Projectile(double shooterX, double shooterY, int shooterRot, int shooterHeight) {
-	posX = (int) (shooterX + (((shooterHeight / 2)) * sin(shooterRot * (M_PI / 180))) + 0.5);
-	posY = (int) (shooterY - (((shooterHeight / 2)) * cos(shooterRot * (M_PI / 180))) + 0.5);
+	double sine = Rotation_Table::sine(shooterRot);
+	double cosine = Rotation_Table::cosine(shooterRot);
+	posX = (int) (shooterX + (((shooterHeight / 2)) * sine) + 0.5);
+	posY = (int) (shooterY - (((shooterHeight / 2)) * cosine) + 0.5);
 	
-	velX = sin(shooterRot * (M_PI / 180));
-	velY = - cos(shooterRot * (M_PI / 180));
+	velX = sine;
+	velY = - cosine;
 	
 	tick_count = 0;
 	ticks_since_deflection = 0;
+	shooter = NO_SHOOTER;
+}
+
+Projectile::Projectile() {
+	posX = 0;
+	posY = 0;
+	velX = 0;
+	velY = 0;
+	tick_count = 0;
+	ticks_since_deflection = 0;
+	shooter = NO_SHOOTER;
 }
 
 Projectile::~Projectile() {
@@ -2,12 +2,14 @@
 Projectile class header file
 
 Chaos The Game
+
+The arena keeps its projectiles in a Projectile_Manager, a projectile object is only used to
+create a projectile and to hand one to the collision checks. The manager numbers the projectiles.
 */
 
 #ifndef PROJECTILE_H
 #define PROJECTILE_H
 
-#include <string>
 
 using namespace std;
 
@@ -16,6 +18,8 @@ class Projectile {
 
 public:
 	Projectile(double shooterX, double shooterY, int shooterRot, int shooterHeight);
+	// an empty projectile, filled in by Projectile_Manager::get
+	Projectile();
 	~Projectile();
 	
 	// the radius of each ball
@@ -32,14 +36,16 @@ public:
 	double velX;
 	double velY;
 	
-	// the player that shot the projectile (identified by color)
-	string shooter_color;
+	// the slot of the player that shot the projectile, NO_SHOOTER if no player did
+	int shooter;
+	static const int NO_SHOOTER = -1;
 	
 	// number of frames the bullet has been active
 	// necessary for expiring old bullets and avoiding killing the shooter when firing
 	int tick_count;
 	
 	int ticks_since_deflection;
+	
 
 
 };
@@ -0,0 +1,402 @@
+/*
+Projectile batch class file
+Takes many projectiles through a frame at once, against packed lists of wall segments and player rectangles
+
+Chaos The Game
+*/
+
+#include "projectile_batch.h"
+#include "projectile.h"
+#include "polygon.h"
+#include "wall.h"
+#include "collisions.h"
+#include "point_vect_struct.h"
+#include "spatial_grid.h"
+#include "simd_kernel.h"
+
+#include <vector>
+#include <cmath>
+#include <string.h>
+#include <stdint.h>
+
+using namespace std;
+
+
+// what a projectile touches first on its way
+enum bounce_kind {NO_BOUNCE, EDGE_X_BOUNCE, EDGE_Y_BOUNCE, WALL_BOUNCE, WALL_END};
+
+// the time a projectile moving along one axis reaches the position it bounces at on the side it is
+// moving towards, false if it is not moving along the axis
+// crossing is set unless the projectile is already past that position, it only bounces once it is past
+static inline bool edge_time(double position, double velocity, double low, double high, double& time,
+							 bool& crossing) {
+	if (velocity < 0) {
+		time = max((low - position) / velocity, 0.0);
+		crossing = (position >= low);
+		return true;
+	}
+	if (velocity > 0) {
+		time = max((high - position) / velocity, 0.0);
+		crossing = (position <= high);
+		return true;
+	}
+	return false;
+}
+
+// the box around the line a projectile's center moves along for a time, rounded outwards
+static inline grid_box path_box(vect start, vect velocity, double time) {
+	double end_x = start.x + (velocity.x * time);
+	double end_y = start.y + (velocity.y * time);
+	grid_box box;
+	box.min_x = (int) floor(min(start.x, end_x));
+	box.min_y = (int) floor(min(start.y, end_y));
+	box.max_x = (int) ceil(max(start.x, end_x));
+	box.max_y = (int) ceil(max(start.y, end_y));
+	return box;
+}
+
+
+/*
+the pre-filter kernels
+each returns a mask with a bit set for each of the first count walls or players in the list that the
+point (x, y) comes within the margin of after moving reach pixels, found from the squared distance
+to the closest point of the segment, the vectorized kernels go on to the end of the last register
+*/
+
+static uint32_t reach_scalar(const Projectile_Batch::reach_list& list, int count, double x, double y, double reach) {
+	uint32_t near = 0;
+	for (int i = 0; i < count; i++) {
+		double px = x - list.x[i];
+		double py = y - list.y[i];
+		double along = ((px * list.dx[i]) + (py * list.dy[i])) * list.inverse[i];
+		along = min(max(along, 0.0), 1.0);
+		double ex = px - (along * list.dx[i]);
+		double ey = py - (along * list.dy[i]);
+		double limit = list.margin[i] + reach;
+		if (((ex * ex) + (ey * ey)) <= (limit * limit)) {
+			near |= (uint32_t) 1 << i;
+		}
+	}
+	return near;
+}
+
+#ifdef SIMD_KERNELS
+
+// two walls or players at a time
+__attribute__((target("sse2")))
+static uint32_t reach_sse2(const Projectile_Batch::reach_list& list, int count, double x, double y, double reach) {
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d cx = _mm_set1_pd(x);
+	const __m128d cy = _mm_set1_pd(y);
+	const __m128d distance = _mm_set1_pd(reach);
+
+	uint32_t near = 0;
+	for (int i = 0; i < count; i += 2) {
+		__m128d dx = _mm_loadu_pd(list.dx + i);
+		__m128d dy = _mm_loadu_pd(list.dy + i);
+		__m128d px = _mm_sub_pd(cx, _mm_loadu_pd(list.x + i));
+		__m128d py = _mm_sub_pd(cy, _mm_loadu_pd(list.y + i));
+		__m128d along = _mm_mul_pd(_mm_add_pd(_mm_mul_pd(px, dx), _mm_mul_pd(py, dy)), _mm_loadu_pd(list.inverse + i));
+		along = _mm_min_pd(_mm_max_pd(along, zero), one);
+		__m128d ex = _mm_sub_pd(px, _mm_mul_pd(along, dx));
+		__m128d ey = _mm_sub_pd(py, _mm_mul_pd(along, dy));
+		__m128d limit = _mm_add_pd(_mm_loadu_pd(list.margin + i), distance);
+		__m128d inside = _mm_cmple_pd(_mm_add_pd(_mm_mul_pd(ex, ex), _mm_mul_pd(ey, ey)), _mm_mul_pd(limit, limit));
+		near |= (uint32_t) _mm_movemask_pd(inside) << i;
+	}
+	return near;
+}
+
+// four walls or players at a time
+__attribute__((target("avx2")))
+static uint32_t reach_avx2(const Projectile_Batch::reach_list& list, int count, double x, double y, double reach) {
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d cx = _mm256_set1_pd(x);
+	const __m256d cy = _mm256_set1_pd(y);
+	const __m256d distance = _mm256_set1_pd(reach);
+
+	uint32_t near = 0;
+	for (int i = 0; i < count; i += 4) {
+		__m256d dx = _mm256_loadu_pd(list.dx + i);
+		__m256d dy = _mm256_loadu_pd(list.dy + i);
+		__m256d px = _mm256_sub_pd(cx, _mm256_loadu_pd(list.x + i));
+		__m256d py = _mm256_sub_pd(cy, _mm256_loadu_pd(list.y + i));
+		__m256d along = _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(px, dx), _mm256_mul_pd(py, dy)),
+									  _mm256_loadu_pd(list.inverse + i));
+		along = _mm256_min_pd(_mm256_max_pd(along, zero), one);
+		__m256d ex = _mm256_sub_pd(px, _mm256_mul_pd(along, dx));
+		__m256d ey = _mm256_sub_pd(py, _mm256_mul_pd(along, dy));
+		__m256d limit = _mm256_add_pd(_mm256_loadu_pd(list.margin + i), distance);
+		__m256d inside = _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(ex, ex), _mm256_mul_pd(ey, ey)),
+									   _mm256_mul_pd(limit, limit), _CMP_LE_OQ);
+		near |= (uint32_t) _mm256_movemask_pd(inside) << i;
+	}
+	return near;
+}
+
+#endif
+
+
+Projectile_Batch::Projectile_Batch(int width, int height) {
+	min_edge = Projectile::RADIUS;
+	max_x = width - Projectile::RADIUS;
+	max_y = height - Projectile::RADIUS;
+
+	wall_count = 0;
+	player_count = 0;
+	bounces = 0;
+	filtered = 0;
+	kernel = best_simd_kernel();
+
+	// the padding is kept at real numbers
+	memset(&wall_reach, 0, sizeof(wall_reach));
+	memset(&player_reach, 0, sizeof(player_reach));
+}
+
+Projectile_Batch::~Projectile_Batch() {
+	// the arrays free themselves
+}
+
+void Projectile_Batch::clear() {
+	wall_count = 0;
+	player_count = 0;
+	projectiles.clear();
+	wall_masks.clear();
+	player_masks.clear();
+}
+
+void Projectile_Batch::add_wall(const Wall* wall) {
+	wall_a[wall_count] = wall->body.points[0];
+	wall_b[wall_count] = wall->body.points[1];
+	wall_boxes[wall_count] = polygon_box(wall->body, Projectile::RADIUS + 1);
+
+	point a = wall_a[wall_count];
+	point b = wall_b[wall_count];
+	double length = ((b.x - a.x) * (b.x - a.x)) + ((b.y - a.y) * (b.y - a.y));
+	wall_reach.x[wall_count] = a.x;
+	wall_reach.y[wall_count] = a.y;
+	wall_reach.dx[wall_count] = b.x - a.x;
+	wall_reach.dy[wall_count] = b.y - a.y;
+	wall_reach.inverse[wall_count] = (length > 0) ? 1 / length : 0;
+	// a pixel more, the same as the box
+	wall_reach.margin[wall_count] = Projectile::RADIUS + 1;
+	wall_count++;
+}
+
+void Projectile_Batch::add_player(const Polygon& body) {
+	players[player_count] = body;
+	// the corners are rounded to pixels, so the box is grown by one more pixel
+	player_boxes[player_count] = polygon_box(body, Projectile::RADIUS + 2);
+
+	// the circle around the corners, grown the same as the box, its radius is found once a frame
+	double corner = 0;
+	for (int i = 0; i < body.num_points; i++) {
+		double dx = body.points[i].x - body.center.x;
+		double dy = body.points[i].y - body.center.y;
+		corner = max(corner, (dx * dx) + (dy * dy));
+	}
+	player_reach.x[player_count] = body.center.x;
+	player_reach.y[player_count] = body.center.y;
+	player_reach.dx[player_count] = 0;
+	player_reach.dy[player_count] = 0;
+	player_reach.inverse[player_count] = 0;
+	player_reach.margin[player_count] = sqrt(corner) + Projectile::RADIUS + 2;
+	player_count++;
+}
+
+void Projectile_Batch::add_projectile(const Projectile& projectile, uint32_t walls, uint32_t players) {
+	projectiles.push_back(projectile);
+	wall_masks.push_back(walls);
+	player_masks.push_back(players);
+}
+
+int Projectile_Batch::size() const {
+	return projectiles.size();
+}
+
+void Projectile_Batch::run() {
+	// the arrays keep their memory from frame to frame
+	end_times.resize(size());
+	hits.resize(size());
+	hit_times.resize(size() * MAX_TARGETS);
+	bounces = 0;
+	filtered = 0;
+
+	for (int j = 0; j < size(); j++) {
+		filter(j);
+		sweep(j);
+	}
+}
+
+/*
+a projectile moves PROJECTILE_SPEED times its speed in a frame, bounces included, so it cannot touch
+a wall or player further than that from where it starts
+its speed is 1 give or take rounding, and is at most its squared speed when that is over 1, so
+no square root is needed
+*/
+void Projectile_Batch::filter(int index) {
+	const Projectile& ball = projectiles[index];
+	double squared_speed = (ball.velX * ball.velX) + (ball.velY * ball.velY);
+	double reach = Projectile::PROJECTILE_SPEED * max(squared_speed, 1.0);
+
+	// the masks leave out the padding past the last wall or player
+	uint32_t walls = wall_masks[index];
+	if (walls != 0) {
+		wall_masks[index] = walls & reach_mask(wall_reach, wall_count, ball, reach);
+	}
+	uint32_t players = player_masks[index];
+	if (players != 0) {
+		player_masks[index] = players & reach_mask(player_reach, player_count, ball, reach);
+	}
+	filtered += __builtin_popcount(walls & ~wall_masks[index]) + __builtin_popcount(players & ~player_masks[index]);
+}
+
+uint32_t Projectile_Batch::reach_mask(const reach_list& list, int count, const Projectile& ball, double reach) const {
+#ifdef SIMD_KERNELS
+	if (kernel == AVX2_KERNEL) {
+		return reach_avx2(list, count, ball.posX, ball.posY, reach);
+	} else if (kernel == SSE2_KERNEL) {
+		return reach_sse2(list, count, ball.posX, ball.posY, reach);
+	}
+#endif
+	return reach_scalar(list, count, ball.posX, ball.posY, reach);
+}
+
+/*
+the projectile moves straight to the first wall or edge it touches, or to the end of the frame
+the players it touches on the way are recorded, then it bounces and the rest of the frame is taken the
+same way, until it reaches the end of the frame or hits the end of a wall
+after MAX_BOUNCES bounces the walls are left out, the edges are far enough apart that a projectile
+only bounces off a few of them in a frame
+*/
+void Projectile_Batch::sweep(int index) {
+	Projectile& ball = projectiles[index];
+	double* times = &hit_times[index * MAX_TARGETS];
+	double time = 0;
+	double frame_time = Projectile::PROJECTILE_SPEED;
+	end_times[index] = frame_time;
+	hits[index] = 0;
+
+	for (int bounce = 0; ; bounce++) {
+		vect start(ball.posX, ball.posY);
+		vect velocity(ball.velX, ball.velY);
+
+		/*
+		the first wall or edge on the way, the edges and then the walls in order win a tie
+		the end of a wall touched at the same time as anything else deletes the projectile first
+		a projectile that reaches an edge, or slides off the body of a wall onto its end, is only past it just
+		after that time, so a wall it touches at the same time comes first
+		*/
+		double first = frame_time - time;
+		bounce_kind kind = NO_BOUNCE;
+		bool just_after = false;
+		int first_wall = 0;
+		double t;
+		bool crossing;
+		if (edge_time(ball.posX, ball.velX, min_edge, max_x, t, crossing) && (t < first)) {
+			first = t;
+			kind = EDGE_X_BOUNCE;
+			just_after = crossing;
+		}
+		if (edge_time(ball.posY, ball.velY, min_edge, max_y, t, crossing) && (t < first)) {
+			first = t;
+			kind = EDGE_Y_BOUNCE;
+			just_after = crossing;
+		}
+		// a projectile caught between walls goes through them
+		uint32_t wall_mask = (bounce < MAX_BOUNCES) ? wall_masks[index] : 0;
+		for (uint32_t walls = wall_mask; walls != 0; walls &= walls - 1) {
+			int w = __builtin_ctz(walls);
+			if (!boxes_overlap(path_box(start, velocity, first), wall_boxes[w])) {
+				continue;
+			}
+			int contact = Collisions::swept_line_circle_collision(wall_a[w], wall_b[w], start, velocity,
+																   Projectile::RADIUS, first, t);
+			if (contact == 0) {
+				continue;
+			}
+			bool tie = (t == first);
+			bool wins;
+			if (contact == 1) {
+				wins = (t < first) || (tie && just_after);
+			} else if (contact == 2) {
+				wins = (t < first) || (tie && ((kind != WALL_END) || just_after));
+			} else {
+				wins = (t < first);
+			}
+			if (wins) {
+				first = t;
+				kind = (contact == 1) ? WALL_BOUNCE : WALL_END;
+				just_after = (contact == 3);
+				first_wall = w;
+			}
+		}
+
+		grid_box path = path_box(start, velocity, first);
+		// the players touched on the way, a projectile that hits the end of a wall is gone before it
+		// touches anything else at the same time, one sliding onto the end is gone just after
+		for (uint32_t untouched = player_masks[index] & ~hits[index]; untouched != 0; untouched &= untouched - 1) {
+			int p = __builtin_ctz(untouched);
+			if (!boxes_overlap(path, player_boxes[p])) {
+				continue;
+			}
+			if (Collisions::swept_circle_player_collision(start, velocity, Projectile::RADIUS, players[p], first, t) &&
+				((kind != WALL_END) || just_after || (t < first))) {
+				hits[index] |= (uint32_t) 1 << p;
+				times[p] = time + t;
+			}
+		}
+
+		ball.posX += velocity.x * first;
+		ball.posY += velocity.y * first;
+		time += first;
+
+		if (kind == NO_BOUNCE) {
+			return;
+		}
+		if (kind == WALL_END) {
+			end_times[index] = time;
+			return;
+		}
+
+		// only an edge or wall the projectile is moving towards is touched, so each bounce turns it away
+		if (kind == EDGE_X_BOUNCE) {
+			ball.velX = - ball.velX;
+		} else if (kind == EDGE_Y_BOUNCE) {
+			ball.velY = - ball.velY;
+		} else {
+			point a = wall_a[first_wall];
+			point b = wall_b[first_wall];
+			Collisions::calculate_deflection(&ball, vect((b.x - a.x), (b.y - a.y)));
+		}
+		bounces++;
+	}
+}
+
+double Projectile_Batch::end_time(int index) const {
+	return end_times[index];
+}
+
+uint32_t Projectile_Batch::player_hits(int index) const {
+	return hits[index];
+}
+
+double Projectile_Batch::player_time(int index, int player) const {
+	return hit_times[index * MAX_TARGETS + player];
+}
+
+void Projectile_Batch::use_kernel(simd_kernel requested) {
+	kernel = requested;
+	if (kernel > best_simd_kernel()) {
+		kernel = best_simd_kernel();
+	}
+}
+
+void Projectile_Batch::get_motion(int index, Projectile& projectile) const {
+	projectile.posX = projectiles[index].posX;
+	projectile.posY = projectiles[index].posY;
+	projectile.velX = projectiles[index].velX;
+	projectile.velY = projectiles[index].velY;
+}
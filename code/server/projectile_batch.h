@@ -0,0 +1,141 @@
+/*
+Projectile batch class header file
+Takes many projectiles through a frame at once, against packed lists of wall segments and player rectangles
+
+Chaos The Game
+
+Each projectile is taken through the frame in one move at a time from one bounce to the next, instead
+of a step at a time with the collision checks after each step. The swept collisions find the time the
+projectile first touches each wall, screen edge and player on its way, it moves straight to the first
+wall or edge it touches, is deflected there, and goes on with the rest of the frame. A projectile
+that bounces off nothing takes one move, however fast projectiles are.
+
+Before a projectile is swept, a vectorized pre-filter, AVX2 or SSE2, drops the walls and players in
+its masks that it cannot reach in the frame. The walls and players are packed one array for each
+field, and the kernel compares the squared distance from the projectile's start to four or two of
+them at a time with how far it can move, so no square root is taken. The pre-filter only leaves out
+what the sweep would have missed, and every kernel does the same arithmetic in the same order, so the
+results are the same whichever kernel runs. narrowphase_bench checks this.
+
+A projectile's path only depends on the walls and the edges, so the batch does not decide which
+player a projectile kills. It records the time each projectile first touched each player, and the
+arena goes through those in order, skipping the players already killed by an earlier projectile.
+*/
+
+#ifndef PROJECTILE_BATCH_H
+#define PROJECTILE_BATCH_H
+
+#include "projectile.h"
+#include "polygon.h"
+#include "wall.h"
+#include "point_vect_struct.h"
+#include "spatial_grid.h"
+#include "simd_kernel.h"
+
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+
+class Projectile_Batch {
+
+public:
+	// the projectiles bounce off the edges of a width by height screen, the same as the projectile manager
+	Projectile_Batch(int width, int height);
+	~Projectile_Batch();
+
+	// the most walls, and the most players, a batch can hold, one bit of a mask each
+	static const int MAX_TARGETS = 32;
+	// the most walls and edges a projectile bounces off in a frame before it is taken to be caught between
+	// walls, it then goes on through the walls along its last velocity for the rest of the frame, still
+	// bouncing off the edges and touching players
+	static const int MAX_BOUNCES = 8;
+
+	// removes every wall, player and projectile, keeps the memory
+	void clear();
+	// adds a wall's segment, the walls are numbered in the order they are added, there must be room for it
+	void add_wall(const Wall* wall);
+	// adds a copy of a player's rectangle, the same way
+	void add_player(const Polygon& body);
+	/*
+	adds a copy of a projectile's position and velocity
+	it is only tested against the walls and players whose bits are set in the masks
+	*/
+	void add_projectile(const Projectile& projectile, uint32_t walls, uint32_t players);
+	// the number of projectiles
+	int size() const;
+
+	// takes every projectile through the steps of a frame, deflecting it off the walls and edges
+	void run();
+
+	// the time (steps) a projectile hit the end of a wall and was deleted, PROJECTILE_SPEED if it was not
+	double end_time(int index) const;
+	// a mask of the players a projectile touched before its end time
+	uint32_t player_hits(int index) const;
+	// the time a projectile first touched a player in its mask of hits
+	double player_time(int index, int player) const;
+	// copies the position and velocity of a projectile at the end of the frame, or when it was deleted
+	void get_motion(int index, Projectile& projectile) const;
+	// the number of walls and edges the projectiles bounced off in the last run
+	int bounces;
+	// the number of walls and players the pre-filter left out of the sweeps in the last run
+	int filtered;
+
+	// used by the benchmarks to compare the kernels, falls back to the best kernel if the processor
+	// does not support the one asked for
+	void use_kernel(simd_kernel requested);
+	// the kernel the pre-filter uses, the fastest the processor supports unless use_kernel was called
+	simd_kernel kernel;
+
+	/*
+	the walls, or the players, packed for the pre-filter, each a segment from (x, y) along (dx, dy), a
+	player is the point at its center, a projectile must come within margin of one to touch it
+	the padding past the last one is tested by the vectorized kernels and thrown away
+	*/
+	typedef struct reach_list {
+		double x[MAX_TARGETS];
+		double y[MAX_TARGETS];
+		double dx[MAX_TARGETS];
+		double dy[MAX_TARGETS];
+		// one over the squared length, 0 for a point
+		double inverse[MAX_TARGETS];
+		double margin[MAX_TARGETS];
+	} reach_list;
+
+private:
+	// the positions a projectile bounces at, its radius away from each edge
+	double min_edge;
+	double max_x;
+	double max_y;
+
+	// the walls and players, and the box around each, a projectile whose path stays out of a box
+	// cannot touch what is in it
+	int wall_count;
+	point wall_a[MAX_TARGETS];
+	point wall_b[MAX_TARGETS];
+	grid_box wall_boxes[MAX_TARGETS];
+	int player_count;
+	Polygon players[MAX_TARGETS];
+	grid_box player_boxes[MAX_TARGETS];
+	reach_list wall_reach;
+	reach_list player_reach;
+
+	// the projectiles, and what they hit, MAX_TARGETS times for each projectile
+	vector<Projectile> projectiles;
+	vector<uint32_t> wall_masks;
+	vector<uint32_t> player_masks;
+	vector<double> end_times;
+	vector<uint32_t> hits;
+	vector<double> hit_times;
+
+	// leaves the walls and players a projectile cannot reach this frame out of its masks
+	void filter(int index);
+	// a mask of the first count in the list that a projectile comes within reach of, with the kernel
+	uint32_t reach_mask(const reach_list& list, int count, const Projectile& ball, double reach) const;
+	// takes one projectile through the frame
+	void sweep(int index);
+
+};
+
+#endif
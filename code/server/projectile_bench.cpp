@@ -0,0 +1,138 @@
+/*
+Projectile kernel benchmark
+
+Chaos The Game
+
+Moves the same projectiles with each kernel the processor supports, scalar, SSE2 and AVX2, for
+numbers of projectiles from 10 to 20000, and prints the time each takes to move one projectile
+through a frame. The projectiles start all over the screen, many near the edges, so they bounce often.
+Every kernel must leave every position and velocity exactly as the scalar kernel does.
+Then checks that no two live projectiles share an id after the ids have wrapped around many times,
+with some projectiles kept alive the whole time.
+
+usage: ./projectile_bench.out [frames]
+*/
+
+// include game files
+#include "arena.h"
+#include "projectile.h"
+#include "projectile_manager.h"
+
+// include other dependencies
+#include <vector>
+#include <set>
+#include <chrono>
+#include <string.h>
+// used for printing and random number generation
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+// the numbers of projectiles to move
+static const int PROJECTILE_COUNTS[] = {10, 100, 1000, 5000, 20000};
+
+
+// fills the manager with count projectiles, the same ones for the same seed
+void fill(Projectile_Manager& projectiles, int count, unsigned int seed) {
+	srand(seed);
+	projectiles.clear();
+	for (int i = 0; i < count; i++) {
+		Projectile projectile(rand() % Arena::SCREEN_WIDTH, rand() % Arena::SCREEN_HEIGHT, rand() % 360, 0);
+		projectiles.add(projectile);
+	}
+}
+
+// true if every position and velocity is the same, to the bit
+bool same_motion(const Projectile_Manager& a, const Projectile_Manager& b) {
+	size_t bytes = a.size() * sizeof(double);
+	return (a.size() == b.size()) && (memcmp(a.posX.data(), b.posX.data(), bytes) == 0) &&
+		   (memcmp(a.posY.data(), b.posY.data(), bytes) == 0) && (memcmp(a.velX.data(), b.velX.data(), bytes) == 0) &&
+		   (memcmp(a.velY.data(), b.velY.data(), bytes) == 0);
+}
+
+// adds and removes enough projectiles for the ids to wrap several times, while the first few stay,
+// true if the live ids are always different and the fired counts keep growing
+bool check_ids() {
+	Projectile_Manager projectiles(Arena::SCREEN_WIDTH, Arena::SCREEN_HEIGHT);
+	Projectile projectile(100, 100, 0, 0);
+	srand(1);
+	uint64_t last_fired = 0;
+	for (int i = 0; i < 5 * Projectile_Manager::NUM_IDS; i++) {
+		if (!projectiles.add(projectile) || ((i > 0) && (projectiles.fired.back() <= last_fired))) {
+			return false;
+		}
+		last_fired = projectiles.fired.back();
+		// the first 100 projectiles are never removed, the rest stay a while at random
+		if (projectiles.size() > 200) {
+			projectiles.remove(100 + rand() % (projectiles.size() - 100));
+		}
+		if (i % 1000 == 0) {
+			set<uint16_t> ids(projectiles.id.begin(), projectiles.id.end());
+			if ((int) ids.size() != projectiles.size()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// moves the projectiles for the frames and returns the time (nanoseconds) for each projectile's frame
+double time_kernel(Projectile_Manager& projectiles, int frames) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; frame++) {
+		projectiles.move(Projectile::PROJECTILE_SPEED);
+	}
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	long long moves = (long long) frames * projectiles.size();
+	return (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / moves;
+}
+
+
+int main(int argc, char** argv) {
+	int frames = 1000;
+	if (argc > 1) {
+		frames = atoi(argv[1]);
+	}
+	if (frames <= 0) {
+		printf("usage: %s [frames]\n", argv[0]);
+		return 1;
+	}
+
+	simd_kernel best = Projectile_Manager::best_kernel();
+	printf("best kernel on this processor: %s\n\n", Projectile_Manager::kernel_name(best));
+
+	bool correct = true;
+	printf("%-12s", "projectiles");
+	for (int kernel = SCALAR_KERNEL; kernel <= best; kernel++) {
+		printf(" %13s ns", Projectile_Manager::kernel_name((simd_kernel) kernel));
+	}
+	printf("\n");
+
+	for (int count : PROJECTILE_COUNTS) {
+		Projectile_Manager scalar(Arena::SCREEN_WIDTH, Arena::SCREEN_HEIGHT);
+		scalar.use_kernel(SCALAR_KERNEL);
+		fill(scalar, count, count);
+		printf("%-12d %16.3f", count, time_kernel(scalar, frames));
+
+		for (int kernel = SSE2_KERNEL; kernel <= best; kernel++) {
+			Projectile_Manager projectiles(Arena::SCREEN_WIDTH, Arena::SCREEN_HEIGHT);
+			projectiles.use_kernel((simd_kernel) kernel);
+			fill(projectiles, count, count);
+			printf(" %16.3f", time_kernel(projectiles, frames));
+
+			if (!same_motion(scalar, projectiles)) {
+				correct = false;
+			}
+		}
+		printf("\n");
+	}
+
+	printf("\n%s\n", correct ? "every kernel matched the scalar kernel" : "CHECK FAILED: a kernel differed from the scalar kernel");
+
+	bool unique = check_ids();
+	printf("%s\n", unique ? "the live projectile ids stayed unique through the wraps" : "CHECK FAILED: two live projectiles shared an id");
+	return (correct && unique) ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+/*
+Projectile manager class file
+Stores and moves an arena's projectiles
+
+Chaos The Game
+*/
+
+#include "projectile_manager.h"
+#include "projectile.h"
+#include "simd_kernel.h"
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+
+using namespace std;
+
+
+/*
+the kernels
+each moves count projectiles steps steps at once, along their velocity, a projectile that passes an
+edge it is moving towards is reflected back from the edge, the same as bouncing off it at the exact
+point it reached it, or from where it is if it was already past the edge
+a projectile moves less than the width of the screen in a frame, so it bounces off each axis at most once
+*/
+
+// one axis of one projectile
+static inline void move_axis(double& position, double& velocity, double steps, double low, double high) {
+	double moved = position + (velocity * steps);
+	if ((velocity < 0) && (moved < low)) {
+		moved = (2 * max(position, low)) - moved;
+		velocity = - velocity;
+	} else if ((velocity > 0) && (moved > high)) {
+		moved = (2 * min(position, high)) - moved;
+		velocity = - velocity;
+	}
+	position = moved;
+}
+
+static void move_scalar(double* posX, double* posY, double* velX, double* velY, int first, int count, int steps,
+						double min_edge, double max_x, double max_y) {
+	for (int i = first; i < count; i++) {
+		move_axis(posX[i], velX[i], steps, min_edge, max_x);
+		move_axis(posY[i], velY[i], steps, min_edge, max_y);
+	}
+}
+
+#ifdef SIMD_KERNELS
+
+// one axis of two projectiles
+__attribute__((target("sse2")))
+static inline void move_axis_sse2(__m128d& position, __m128d& velocity, __m128d steps, __m128d low, __m128d high) {
+	const __m128d zero = _mm_setzero_pd();
+	// only the sign bit is set, used to negate the velocity
+	const __m128d sign = _mm_set1_pd(-0.0);
+	__m128d moved = _mm_add_pd(position, _mm_mul_pd(velocity, steps));
+
+	// the two masks never overlap, so the reflections are picked from either edge
+	__m128d past_low = _mm_and_pd(_mm_cmplt_pd(velocity, zero), _mm_cmplt_pd(moved, low));
+	__m128d past_high = _mm_and_pd(_mm_cmpgt_pd(velocity, zero), _mm_cmpgt_pd(moved, high));
+	__m128d from_low = _mm_sub_pd(_mm_add_pd(_mm_max_pd(position, low), _mm_max_pd(position, low)), moved);
+	__m128d from_high = _mm_sub_pd(_mm_add_pd(_mm_min_pd(position, high), _mm_min_pd(position, high)), moved);
+	moved = _mm_or_pd(_mm_and_pd(past_low, from_low), _mm_andnot_pd(past_low, moved));
+	moved = _mm_or_pd(_mm_and_pd(past_high, from_high), _mm_andnot_pd(past_high, moved));
+
+	position = moved;
+	velocity = _mm_xor_pd(velocity, _mm_and_pd(_mm_or_pd(past_low, past_high), sign));
+}
+
+// two projectiles at a time, the rest are left for the scalar kernel
+__attribute__((target("sse2")))
+static int move_sse2(double* posX, double* posY, double* velX, double* velY, int count, int steps,
+					 double min_edge, double max_x, double max_y) {
+	const __m128d distance = _mm_set1_pd(steps);
+	const __m128d low = _mm_set1_pd(min_edge);
+	const __m128d high_x = _mm_set1_pd(max_x);
+	const __m128d high_y = _mm_set1_pd(max_y);
+
+	int i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d px = _mm_loadu_pd(posX + i);
+		__m128d py = _mm_loadu_pd(posY + i);
+		__m128d vx = _mm_loadu_pd(velX + i);
+		__m128d vy = _mm_loadu_pd(velY + i);
+
+		move_axis_sse2(px, vx, distance, low, high_x);
+		move_axis_sse2(py, vy, distance, low, high_y);
+
+		_mm_storeu_pd(posX + i, px);
+		_mm_storeu_pd(posY + i, py);
+		_mm_storeu_pd(velX + i, vx);
+		_mm_storeu_pd(velY + i, vy);
+	}
+	return i;
+}
+
+// one axis of four projectiles
+__attribute__((target("avx2")))
+static inline void move_axis_avx2(__m256d& position, __m256d& velocity, __m256d steps, __m256d low, __m256d high) {
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	__m256d moved = _mm256_add_pd(position, _mm256_mul_pd(velocity, steps));
+
+	__m256d past_low = _mm256_and_pd(_mm256_cmp_pd(velocity, zero, _CMP_LT_OQ), _mm256_cmp_pd(moved, low, _CMP_LT_OQ));
+	__m256d past_high = _mm256_and_pd(_mm256_cmp_pd(velocity, zero, _CMP_GT_OQ), _mm256_cmp_pd(moved, high, _CMP_GT_OQ));
+	__m256d from_low = _mm256_sub_pd(_mm256_add_pd(_mm256_max_pd(position, low), _mm256_max_pd(position, low)), moved);
+	__m256d from_high = _mm256_sub_pd(_mm256_add_pd(_mm256_min_pd(position, high), _mm256_min_pd(position, high)), moved);
+	moved = _mm256_blendv_pd(moved, from_low, past_low);
+	moved = _mm256_blendv_pd(moved, from_high, past_high);
+
+	position = moved;
+	velocity = _mm256_xor_pd(velocity, _mm256_and_pd(_mm256_or_pd(past_low, past_high), sign));
+}
+
+// four projectiles at a time, the rest are left for the scalar kernel
+__attribute__((target("avx2")))
+static int move_avx2(double* posX, double* posY, double* velX, double* velY, int count, int steps,
+					 double min_edge, double max_x, double max_y) {
+	const __m256d distance = _mm256_set1_pd(steps);
+	const __m256d low = _mm256_set1_pd(min_edge);
+	const __m256d high_x = _mm256_set1_pd(max_x);
+	const __m256d high_y = _mm256_set1_pd(max_y);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d px = _mm256_loadu_pd(posX + i);
+		__m256d py = _mm256_loadu_pd(posY + i);
+		__m256d vx = _mm256_loadu_pd(velX + i);
+		__m256d vy = _mm256_loadu_pd(velY + i);
+
+		move_axis_avx2(px, vx, distance, low, high_x);
+		move_axis_avx2(py, vy, distance, low, high_y);
+
+		_mm256_storeu_pd(posX + i, px);
+		_mm256_storeu_pd(posY + i, py);
+		_mm256_storeu_pd(velX + i, vx);
+		_mm256_storeu_pd(velY + i, vy);
+	}
+	return i;
+}
+
+#endif
+
+
+Projectile_Manager::Projectile_Manager(int width, int height) {
+	min_edge = Projectile::RADIUS;
+	max_x = width - Projectile::RADIUS;
+	max_y = height - Projectile::RADIUS;
+	kernel = best_kernel();
+	used_ids.assign(NUM_IDS / 64, 0);
+	next_id = 0;
+	next_fired = 0;
+}
+
+Projectile_Manager::~Projectile_Manager() {
+	// the arrays free themselves
+}
+
+bool Projectile_Manager::add(const Projectile& projectile) {
+	if (size() == NUM_IDS) {
+		return false;
+	}
+	while (used_ids[next_id / 64] & (1ull << (next_id % 64))) {
+		next_id++;
+	}
+	used_ids[next_id / 64] |= 1ull << (next_id % 64);
+	id.push_back(next_id);
+	fired.push_back(next_fired);
+	next_id++;
+	next_fired++;
+
+	posX.push_back(projectile.posX);
+	posY.push_back(projectile.posY);
+	velX.push_back(projectile.velX);
+	velY.push_back(projectile.velY);
+	tick_count.push_back(projectile.tick_count);
+	ticks_since_deflection.push_back(projectile.ticks_since_deflection);
+	shooter.push_back(projectile.shooter);
+	return true;
+}
+
+void Projectile_Manager::remove(int index) {
+	int last = size() - 1;
+	used_ids[id[index] / 64] &= ~(1ull << (id[index] % 64));
+	posX[index] = posX[last];
+	posY[index] = posY[last];
+	velX[index] = velX[last];
+	velY[index] = velY[last];
+	tick_count[index] = tick_count[last];
+	ticks_since_deflection[index] = ticks_since_deflection[last];
+	shooter[index] = shooter[last];
+	id[index] = id[last];
+	fired[index] = fired[last];
+
+	posX.pop_back();
+	posY.pop_back();
+	velX.pop_back();
+	velY.pop_back();
+	tick_count.pop_back();
+	ticks_since_deflection.pop_back();
+	shooter.pop_back();
+	id.pop_back();
+	fired.pop_back();
+}
+
+void Projectile_Manager::clear() {
+	posX.clear();
+	posY.clear();
+	velX.clear();
+	velY.clear();
+	tick_count.clear();
+	ticks_since_deflection.clear();
+	shooter.clear();
+	id.clear();
+	fired.clear();
+	used_ids.assign(NUM_IDS / 64, 0);
+	next_id = 0;
+	next_fired = 0;
+}
+
+int Projectile_Manager::size() const {
+	return posX.size();
+}
+
+bool Projectile_Manager::empty() const {
+	return posX.empty();
+}
+
+void Projectile_Manager::get(int index, Projectile& projectile) const {
+	projectile.posX = posX[index];
+	projectile.posY = posY[index];
+	projectile.velX = velX[index];
+	projectile.velY = velY[index];
+	projectile.tick_count = tick_count[index];
+	projectile.ticks_since_deflection = ticks_since_deflection[index];
+	projectile.shooter = shooter[index];
+}
+
+void Projectile_Manager::set_motion(int index, const Projectile& projectile) {
+	posX[index] = projectile.posX;
+	posY[index] = projectile.posY;
+	velX[index] = projectile.velX;
+	velY[index] = projectile.velY;
+}
+
+void Projectile_Manager::move(int steps) {
+	move_range(0, size(), steps);
+}
+
+void Projectile_Manager::move_except(int steps, const vector<int>& skipped) {
+	// the runs of projectiles between the skipped ones
+	int first = 0;
+	for (int index : skipped) {
+		move_range(first, index, steps);
+		first = index + 1;
+	}
+	move_range(first, size(), steps);
+}
+
+void Projectile_Manager::move_range(int first, int end, int steps) {
+	int count = end - first;
+	int done = 0;
+	double* x = posX.data() + first;
+	double* y = posY.data() + first;
+	double* vx = velX.data() + first;
+	double* vy = velY.data() + first;
+
+#ifdef SIMD_KERNELS
+	if (kernel == AVX2_KERNEL) {
+		done = move_avx2(x, y, vx, vy, count, steps, min_edge, max_x, max_y);
+	} else if (kernel == SSE2_KERNEL) {
+		done = move_sse2(x, y, vx, vy, count, steps, min_edge, max_x, max_y);
+	}
+#endif
+
+	// the projectiles the vectorized kernel did not fill a register with, or all of them
+	move_scalar(x, y, vx, vy, done, count, steps, min_edge, max_x, max_y);
+}
+
+void Projectile_Manager::end_frame() {
+	int count = size();
+	for (int i = 0; i < count; i++) {
+		tick_count[i]++;
+		ticks_since_deflection[i]++;
+	}
+}
+
+simd_kernel Projectile_Manager::best_kernel() {
+	return best_simd_kernel();
+}
+
+void Projectile_Manager::use_kernel(simd_kernel requested) {
+	kernel = requested;
+	if (kernel > best_kernel()) {
+		kernel = best_kernel();
+	}
+}
+
+const char* Projectile_Manager::kernel_name(simd_kernel kernel) {
+	return simd_kernel_name(kernel);
+}
@@ -0,0 +1,105 @@
+/*
+Projectile manager class header file
+Stores and moves an arena's projectiles
+
+Chaos The Game
+
+The projectiles are kept as a structure of arrays, one array for each field, so moving every
+projectile reads and writes a few contiguous arrays instead of following a pointer to each one.
+A projectile is removed by moving the last projectile into its place, so the order of the
+projectiles changes as they are removed, nothing relies on it.
+Projectiles never expire, so a projectile can still be alive when the ids wrap around, the ids it
+and the other live projectiles have are skipped until they are removed.
+Moving the projectiles and bouncing them off the screen edges is done by a vectorized kernel, AVX2
+or SSE2, picked when the manager is created from what the processor supports. The scalar kernel
+is used on other processors. A projectile is moved the whole frame at once, and reflected back from
+an edge it passed, so the cost does not grow with the projectile speed. Every kernel does the same
+arithmetic in the same order, so they all give exactly the same results.
+*/
+
+#ifndef PROJECTILE_MANAGER_H
+#define PROJECTILE_MANAGER_H
+
+#include "projectile.h"
+#include "simd_kernel.h"
+
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+
+class Projectile_Manager {
+
+public:
+	// the projectiles bounce off the edges of a width by height screen
+	Projectile_Manager(int width, int height);
+	~Projectile_Manager();
+
+	// adds a copy of the projectile and gives it an id, false if every id is taken
+	bool add(const Projectile& projectile);
+	// removes the projectile at the index, the last projectile takes its place
+	void remove(int index);
+	// removes every projectile and starts the ids again, keeps the memory
+	void clear();
+
+	// the number of projectiles
+	int size() const;
+	bool empty() const;
+
+	// copies the projectile at the index out, for the collision checks
+	void get(int index, Projectile& projectile) const;
+	// copies the position and velocity of a copy that was moved by step back
+	void set_motion(int index, const Projectile& projectile);
+
+	// moves every projectile steps steps along its velocity in one move, bouncing it off the screen edges
+	void move(int steps);
+	// moves every projectile but the skipped ones, given in order of index, the same as move
+	void move_except(int steps, const vector<int>& skipped);
+	// counts another frame for every projectile
+	void end_frame();
+
+	// the fastest kernel the processor supports
+	static simd_kernel best_kernel();
+	// used by the benchmarks to compare the kernels, falls back to the best kernel if the processor
+	// does not support the one asked for
+	void use_kernel(simd_kernel requested);
+	// the kernel move uses
+	simd_kernel kernel;
+	static const char* kernel_name(simd_kernel kernel);
+
+	// the fields of each projectile, see the Projectile class, all the same size
+	vector<double> posX;
+	vector<double> posY;
+	vector<double> velX;
+	vector<double> velY;
+	vector<int> tick_count;
+	vector<int> ticks_since_deflection;
+	vector<int> shooter;
+	// identifies the projectile in binary snapshots, never the id of another of the manager's projectiles
+	vector<uint16_t> id;
+	// counts the projectiles in the order they were added, 64 bits so it never wraps
+	vector<uint64_t> fired;
+
+	// the number of ids, the size of the id field in binary snapshots
+	static const int NUM_IDS = 65536;
+
+private:
+	// moves the projectiles from first up to end with the kernel
+	void move_range(int first, int end, int steps);
+
+	// a bit for each id, set while a projectile has the id
+	vector<uint64_t> used_ids;
+	// the id tried first for the next projectile, wraps around
+	uint16_t next_id;
+	// the fired count of the next projectile
+	uint64_t next_fired;
+
+	// the positions a projectile bounces at, its radius away from each edge
+	double min_edge;
+	double max_x;
+	double max_y;
+
+};
+
+#endif
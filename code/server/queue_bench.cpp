@@ -0,0 +1,152 @@
+/*
+Action queue benchmark
+
+Chaos The Game
+
+Compares the lock-free MPSC_Queue used for the gameserver's actions with a std::queue guarded by
+a mutex, the way the action queue used to work. Producer threads stand in for the websocket
+listeners and push records shaped like an action (a type, a weak connection handle, and a shared
+message) while a single consumer thread pops them.
+
+usage: ./queue_bench.out [actions per run]
+*/
+
+#include "mpsc_queue.h"
+
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+// used for printing
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+/*
+stands in for gameserver's action struct, which needs websocketpp
+same layout and the same move-only rules
+*/
+struct bench_action {
+	bench_action() : type(0) {}
+	bench_action(int t, weak_ptr<void> h, shared_ptr<string> m) : type(t), handler(h), message(m) {}
+
+	int type;
+	weak_ptr<void> handler;
+	shared_ptr<string> message;
+
+	bench_action(const bench_action&) = delete;
+	bench_action& operator=(const bench_action&) = delete;
+	bench_action(bench_action&&) = default;
+	bench_action& operator=(bench_action&&) = default;
+};
+
+// the lock-free queue's capacity, the same as the gameserver's
+static const int CAPACITY = 65536;
+
+
+// runs the producers and the consumer over the lock-free queue, returns the elapsed time (seconds)
+double run_lock_free(int producers, int total) {
+	MPSC_Queue<bench_action> actions(CAPACITY);
+	int per_producer = total / producers;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	vector<thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.push_back(thread([&actions, per_producer]() {
+			shared_ptr<void> connection = make_shared<int>(0);
+			shared_ptr<string> message = make_shared<string>("1,-1,0");
+			for (int i = 0; i < per_producer; i++) {
+				bench_action a(2, connection, message);
+				while (!actions.try_push(std::move(a))) {
+					this_thread::yield();
+				}
+			}
+		}));
+	}
+
+	bench_action a;
+	int received = 0;
+	while (received < per_producer * producers) {
+		if (actions.try_pop(a)) {
+			received++;
+		}
+	}
+
+	for (thread& t : threads) {
+		t.join();
+	}
+
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// runs the producers and the consumer over a mutex-guarded queue, returns the elapsed time (seconds)
+double run_mutex(int producers, int total) {
+	queue<bench_action> actions;
+	mutex action_lock;
+	int per_producer = total / producers;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	vector<thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.push_back(thread([&actions, &action_lock, per_producer]() {
+			shared_ptr<void> connection = make_shared<int>(0);
+			shared_ptr<string> message = make_shared<string>("1,-1,0");
+			for (int i = 0; i < per_producer; i++) {
+				lock_guard<mutex> guard(action_lock);
+				actions.push(bench_action(2, connection, message));
+			}
+		}));
+	}
+
+	// the consumer takes the whole batch under one lock, like the action loop did
+	queue<bench_action> batch;
+	int received = 0;
+	while (received < per_producer * producers) {
+		{
+			lock_guard<mutex> guard(action_lock);
+			swap(batch, actions);
+		}
+		while (!batch.empty()) {
+			batch.pop();
+			received++;
+		}
+	}
+
+	for (thread& t : threads) {
+		t.join();
+	}
+
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+int main(int argc, char** argv) {
+	int total = 4000000;
+	if (argc > 1) {
+		total = atoi(argv[1]);
+	}
+	if (total <= 0) {
+		printf("usage: %s [actions per run]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%d actions per run\n", total);
+	printf("%10s %22s %22s\n", "producers", "mutex queue (ns/op)", "lock-free (ns/op)");
+
+	int producer_counts[] = {1, 4, 16};
+	for (int producers : producer_counts) {
+		double mutex_seconds = run_mutex(producers, total);
+		double lock_free_seconds = run_lock_free(producers, total);
+		printf("%10d %22.1f %22.1f\n", producers, mutex_seconds * 1e9 / total, lock_free_seconds * 1e9 / total);
+	}
+
+	return 0;
+}
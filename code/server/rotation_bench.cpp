@@ -0,0 +1,232 @@
+/*
+Rotation table benchmark
+
+Chaos The Game
+
+Checks the rotation table against the math library and the bodies built from it against the way
+they were built with sin and cos, then times building a player's body both ways.
+The sines and cosines must match sin and cos, except where the math library is off by its last bit,
+which the table's rounding is not, and there they may only differ in that bit. Every corner of a player
+and end of a wall, and every projectile fired, must land on exactly the same pixel as before, for
+every rotation at random player positions and at every wall position on the screen.
+
+usage: ./rotation_bench.out [positions per rotation]
+*/
+
+// include game files
+#include "rotation_table.h"
+#include "player.h"
+#include "wall.h"
+#include "projectile.h"
+#include "polygon.h"
+
+// include other dependencies
+#include <vector>
+#include <chrono>
+#include <cmath>
+// used for printing and random number generation
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+// the size of the screen the positions are picked in, the same as the arena's
+static const int SCREEN_WIDTH = 960;
+static const int SCREEN_HEIGHT = 640;
+
+
+/*
+the bodies as they were built before the table, with sin and cos
+*/
+
+void old_player_points(double newX, double newY, int newRotation, Polygon& body) {
+	vect v1;
+	v1.x = sin(newRotation * (M_PI / 180));
+	v1.y = - cos(newRotation * (M_PI / 180));
+	vect v2;
+	v2.x = v1.y;
+	v2.y = -v1.x;
+
+	v1.x *= Player::PLAYER_HEIGHT / 2;
+	v1.y *= Player::PLAYER_HEIGHT / 2;
+	v2.x *= Player::PLAYER_WIDTH / 2;
+	v2.y *= Player::PLAYER_WIDTH / 2;
+
+	body.clear_points();
+	body.add_point(point((int) (newX + v1.x + v2.x + 0.5), (int) (newY + v1.y + v2.y + 0.5)));
+	body.add_point(point((int) (newX - v1.x + v2.x + 0.5), (int) (newY - v1.y + v2.y + 0.5)));
+	body.add_point(point((int) (newX - v1.x - v2.x + 0.5), (int) (newY - v1.y - v2.y + 0.5)));
+	body.add_point(point((int) (newX + v1.x - v2.x + 0.5), (int) (newY + v1.y - v2.y + 0.5)));
+}
+
+void old_wall_points(int posX, int posY, int newRotation, point ends[2]) {
+	vect v1;
+	v1.x = sin(newRotation * (M_PI / 180));
+	v1.y = - cos(newRotation * (M_PI / 180));
+
+	v1.x *= Wall::WALL_HEIGHT / 2;
+	v1.y *= Wall::WALL_HEIGHT / 2;
+
+	ends[0] = point((int) (posX + v1.x + 0.5), (int) (posY + v1.y + 0.5));
+	ends[1] = point((int) (posX - v1.x + 0.5), (int) (posY - v1.y + 0.5));
+}
+
+// a projectile's starting position, as the projectile constructor worked it out
+point old_projectile_position(double shooterX, double shooterY, int shooterRot, int shooterHeight) {
+	return point((int) (shooterX + (((shooterHeight / 2)) * sin(shooterRot * (M_PI / 180))) + 0.5),
+				 (int) (shooterY - (((shooterHeight / 2)) * cos(shooterRot * (M_PI / 180))) + 0.5));
+}
+
+
+// true if the table's value is the math library's, or the double next to it
+bool check_value(double table, double library) {
+	return (table == library) || (table == nextafter(library, 2.0)) || (table == nextafter(library, -2.0));
+}
+
+// a random position on the screen, to a fraction of a pixel
+double random_position(int size) {
+	return (double) rand() / RAND_MAX * size;
+}
+
+// returns the time (nanoseconds) to build one player body, with the table or with sin and cos
+double time_player_points(int positions, bool table) {
+	Player player;
+	Polygon body;
+	long long checksum = 0;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < positions; i++) {
+		for (int degrees = 0; degrees < 360; degrees++) {
+			player.newX = 100.25 + i;
+			player.newY = 200.75 + i;
+			player.newRotation = degrees;
+			if (table) {
+				player.update_rectangle_points();
+				checksum += player.body.points[2].x;
+			} else {
+				old_player_points(player.newX, player.newY, player.newRotation, body);
+				checksum += body.points[2].x;
+			}
+		}
+	}
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	// keeps the compiler from leaving out the work
+	if (checksum == 42) {
+		printf(" ");
+	}
+	return (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / ((long long) positions * 360);
+}
+
+
+int main(int argc, char** argv) {
+	int positions = 2000;
+	if (argc > 1) {
+		positions = atoi(argv[1]);
+	}
+	if (positions <= 0) {
+		printf("usage: %s [positions per rotation]\n", argv[0]);
+		return 1;
+	}
+
+	bool correct = true;
+
+	// the sines and cosines, for every rotation that can be looked up
+	int library_differences = 0;
+	for (int degrees = -359; degrees < 360; degrees++) {
+		double angle = degrees * (M_PI / 180);
+		double table_sine = Rotation_Table::sine(degrees);
+		double table_cosine = Rotation_Table::cosine(degrees);
+
+		if ((table_sine != sin(angle)) || (table_cosine != cos(angle))) {
+			library_differences++;
+			printf("  %4d degrees: table sin %.17g cos %.17g, math library sin %.17g cos %.17g\n", degrees,
+				   table_sine, table_cosine, sin(angle), cos(angle));
+		}
+		if (!check_value(table_sine, sin(angle)) || !check_value(table_cosine, cos(angle))) {
+			printf("  CHECK FAILED: the table is more than a bit from the math library at %d degrees\n", degrees);
+			correct = false;
+		}
+	}
+	printf("%d of 719 rotations differ from the math library, where it is off by its last bit\n\n",
+		   library_differences);
+
+	// the player bodies, built by the player
+	srand(1);
+	Player player;
+	Polygon body;
+	long long player_mismatches = 0;
+	for (int degrees = 0; degrees < 360; degrees++) {
+		for (int i = 0; i < positions; i++) {
+			player.newX = random_position(SCREEN_WIDTH);
+			player.newY = random_position(SCREEN_HEIGHT);
+			player.newRotation = degrees;
+			player.update_rectangle_points();
+
+			old_player_points(player.newX, player.newY, degrees, body);
+			for (int c = 0; c < 4; c++) {
+				if ((body.points[c].x != player.body.points[c].x) || (body.points[c].y != player.body.points[c].y)) {
+					player_mismatches++;
+				}
+			}
+		}
+	}
+	printf("player corners:      %10lld checked, %lld different\n", (long long) positions * 360 * 4, player_mismatches);
+
+	// the walls, at every pixel of the screen, built from the table the way the wall does it
+	long long wall_mismatches = 0;
+	for (int degrees = 0; degrees < 360; degrees++) {
+		half_side v1 = Rotation_Table::wall_length(degrees);
+		for (int x = 0; x < SCREEN_WIDTH; x++) {
+			for (int y = 0; y < SCREEN_HEIGHT; y++) {
+				point ends[2];
+				old_wall_points(x, y, degrees, ends);
+				if ((ends[0].x != (int) (x + v1.x + 0.5)) || (ends[0].y != (int) (y + v1.y + 0.5)) ||
+					(ends[1].x != (int) (x - v1.x + 0.5)) || (ends[1].y != (int) (y - v1.y + 0.5))) {
+					wall_mismatches++;
+				}
+			}
+		}
+	}
+	// and a wall itself, at the rotations the walls turn through
+	for (int degrees = 0; degrees <= 90; degrees++) {
+		Wall wall(480, 320, 0);
+		wall.newRotation = degrees;
+		wall.update_points();
+		point ends[2];
+		old_wall_points(480, 320, degrees, ends);
+		if ((ends[0].x != wall.body.points[0].x) || (ends[0].y != wall.body.points[0].y) ||
+			(ends[1].x != wall.body.points[1].x) || (ends[1].y != wall.body.points[1].y)) {
+			wall_mismatches++;
+		}
+	}
+	printf("wall ends:           %10lld checked, %lld different\n",
+		   (long long) SCREEN_WIDTH * SCREEN_HEIGHT * 360 * 2 + 91 * 2, wall_mismatches);
+
+	// the projectiles, fired from random player positions
+	long long projectile_mismatches = 0;
+	for (int degrees = 0; degrees < 360; degrees++) {
+		for (int i = 0; i < positions; i++) {
+			double x = random_position(SCREEN_WIDTH);
+			double y = random_position(SCREEN_HEIGHT);
+			Projectile projectile(x, y, degrees, Player::PLAYER_HEIGHT);
+			point position = old_projectile_position(x, y, degrees, Player::PLAYER_HEIGHT);
+			if ((position.x != (int) projectile.posX) || (position.y != (int) projectile.posY)) {
+				projectile_mismatches++;
+			}
+		}
+	}
+	printf("projectile positions: %9lld checked, %lld different\n", (long long) positions * 360, projectile_mismatches);
+
+	if ((player_mismatches != 0) || (wall_mismatches != 0) || (projectile_mismatches != 0)) {
+		correct = false;
+	}
+
+	printf("\nbuild one player body\n");
+	printf("  %-14s %10.1f ns\n", "sin and cos", time_player_points(positions, false));
+	printf("  %-14s %10.1f ns\n", "table", time_player_points(positions, true));
+
+	printf("\n%s\n", correct ? "every corner matched" : "CHECK FAILED: the table changed a corner or a value");
+	return correct ? 0 : 1;
+}
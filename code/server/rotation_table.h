@@ -0,0 +1,231 @@
+/*
+Rotation table header file
+Sines, cosines and body offsets for every whole degree, computed when the server is compiled
+
+Chaos The Game
+
+Every rotation in the game is a whole number of degrees, so instead of calling sin and cos for each
+player, wall and projectile several times a frame, the values are looked up. The compiler builds the
+table with double-double arithmetic, about 32 significant digits, and rounds each value to the
+nearest double, which is the value sin(degrees * (M_PI / 180)) and cos return. The half sides of
+the player and wall bodies are scaled from those values the same way the bodies used to scale them,
+so every corner comes out exactly as it did. rotation_bench checks both against the math library.
+Rotations from -359 to 359 degrees can be looked up.
+*/
+
+#ifndef ROTATION_TABLE_H
+#define ROTATION_TABLE_H
+
+#include "player.h"
+#include "wall.h"
+
+#include <cmath>
+
+using namespace std;
+
+
+/*
+double-double arithmetic
+a value is kept as the unevaluated sum of two doubles, the second holding the bits the first cannot
+only used by the compiler to build the table
+*/
+typedef struct double_double {
+	double hi;
+	double lo;
+} double_double;
+
+// the sum of two doubles when |a| >= |b|, exactly
+constexpr double_double dd_quick_two_sum(double a, double b) {
+	double s = a + b;
+	return {s, b - (s - a)};
+}
+
+// the sum of two doubles, exactly
+constexpr double_double dd_two_sum(double a, double b) {
+	double s = a + b;
+	double v = s - a;
+	return {s, (a - (s - v)) + (b - v)};
+}
+
+// the product of two doubles, exactly, by splitting each into halves whose products are exact
+constexpr double_double dd_two_prod(double a, double b) {
+	double p = a * b;
+	double ta = 134217729.0 * a;
+	double a_hi = ta - (ta - a);
+	double a_lo = a - a_hi;
+	double tb = 134217729.0 * b;
+	double b_hi = tb - (tb - b);
+	double b_lo = b - b_hi;
+	return {p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo};
+}
+
+constexpr double_double dd_add(double_double a, double_double b) {
+	double_double s = dd_two_sum(a.hi, b.hi);
+	double_double t = dd_two_sum(a.lo, b.lo);
+	s = dd_quick_two_sum(s.hi, s.lo + t.hi);
+	return dd_quick_two_sum(s.hi, s.lo + t.lo);
+}
+
+constexpr double_double dd_mul(double_double a, double_double b) {
+	double_double p = dd_two_prod(a.hi, b.hi);
+	return dd_quick_two_sum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+constexpr double_double dd_div(double_double a, double b) {
+	double q1 = a.hi / b;
+	double_double p = dd_two_prod(q1, b);
+	double_double r = dd_two_sum(a.hi, -p.hi);
+	double q2 = (r.hi + ((r.lo - p.lo) + a.lo)) / b;
+	return dd_quick_two_sum(q1, q2);
+}
+
+// the sine and cosine of an angle (radians) from 0 to 2 pi
+constexpr void dd_sin_cos(double angle, double_double& sine, double_double& cosine) {
+	// pi / 2 in three pieces, each holding the bits the one before cannot
+	const double PI_2_1 = 1.5707963267948966;
+	const double PI_2_2 = 6.123233995736766e-17;
+	const double PI_2_3 = -1.4973849048591698e-33;
+
+	// take away the nearest number of quarter turns, leaving at most an eighth of a turn
+	int quarters = (int) (angle / PI_2_1 + 0.5);
+	double_double r = {angle, 0.0};
+	r = dd_add(r, dd_two_prod(-quarters, PI_2_1));
+	r = dd_add(r, dd_two_prod(-quarters, PI_2_2));
+	r = dd_add(r, dd_two_prod(-quarters, PI_2_3));
+	double_double r2 = dd_mul(r, r);
+
+	// the Taylor series, until the terms are too small to change the sum
+	double_double s = r;
+	double_double c = {1.0, 0.0};
+	double_double s_term = r;
+	double_double c_term = c;
+	for (int n = 1; (s_term.hi > 1e-40) || (s_term.hi < -1e-40) || (c_term.hi > 1e-40) || (c_term.hi < -1e-40); n++) {
+		s_term = dd_div(dd_mul(s_term, r2), - (2.0 * n) * (2.0 * n + 1));
+		c_term = dd_div(dd_mul(c_term, r2), - (2.0 * n - 1) * (2.0 * n));
+		s = dd_add(s, s_term);
+		c = dd_add(c, c_term);
+	}
+
+	// turn the result back by the quarter turns
+	switch (quarters % 4) {
+		case 0:
+			sine = s;
+			cosine = c;
+			break;
+		case 1:
+			sine = c;
+			cosine = {-s.hi, -s.lo};
+			break;
+		case 2:
+			sine = {-s.hi, -s.lo};
+			cosine = {-c.hi, -c.lo};
+			break;
+		default:
+			sine = {-c.hi, -c.lo};
+			cosine = s;
+			break;
+	}
+}
+
+
+// half of one side of a rectangle, from its center, at a rotation
+typedef struct half_side {
+	double x;
+	double y;
+} half_side;
+
+// the values looked up for every whole degree
+typedef struct rotation_values {
+	double sine[360];
+	double cosine[360];
+	// a player's half length, along its direction, and half width, across it
+	half_side player_length[360];
+	half_side player_width[360];
+	// a wall's half length
+	half_side wall_length[360];
+} rotation_values;
+
+constexpr rotation_values build_rotation_values() {
+	rotation_values values = {};
+	for (int degrees = 0; degrees < 360; degrees++) {
+		double_double sine = {0.0, 0.0};
+		double_double cosine = {0.0, 0.0};
+		dd_sin_cos(degrees * (M_PI / 180), sine, cosine);
+		// the nearest double, the low part is at most half of the high part's last bit
+		values.sine[degrees] = sine.hi;
+		values.cosine[degrees] = cosine.hi;
+
+		// the unit vectors along both axes, scaled in the same order the bodies do it
+		double length_x = sine.hi;
+		double length_y = - cosine.hi;
+		values.player_length[degrees] = {length_x * (Player::PLAYER_HEIGHT / 2), length_y * (Player::PLAYER_HEIGHT / 2)};
+		values.player_width[degrees] = {length_y * (Player::PLAYER_WIDTH / 2), - length_x * (Player::PLAYER_WIDTH / 2)};
+		values.wall_length[degrees] = {length_x * (Wall::WALL_HEIGHT / 2), length_y * (Wall::WALL_HEIGHT / 2)};
+	}
+	return values;
+}
+
+
+class Rotation_Table {
+
+public:
+	// sin and cos of the rotation in radians, sin(degrees * (M_PI / 180))
+	static double sine(int degrees);
+	static double cosine(int degrees);
+
+	// the half sides of a player's body, its corners are its center plus or minus each
+	static half_side player_length(int degrees);
+	static half_side player_width(int degrees);
+	// the half length of a wall, its ends are its center plus and minus it
+	static half_side wall_length(int degrees);
+
+	// built by the compiler
+	static constexpr rotation_values values = build_rotation_values();
+
+};
+
+
+/*
+a negative rotation has the sine negated and the cosine kept, which is exactly what the math library
+gives, and the half sides follow from that
+*/
+
+inline double Rotation_Table::sine(int degrees) {
+	if (degrees < 0) {
+		return - values.sine[- degrees];
+	}
+	return values.sine[degrees];
+}
+
+inline double Rotation_Table::cosine(int degrees) {
+	if (degrees < 0) {
+		return values.cosine[- degrees];
+	}
+	return values.cosine[degrees];
+}
+
+inline half_side Rotation_Table::player_length(int degrees) {
+	if (degrees < 0) {
+		half_side side = values.player_length[- degrees];
+		return {- side.x, side.y};
+	}
+	return values.player_length[degrees];
+}
+
+inline half_side Rotation_Table::player_width(int degrees) {
+	if (degrees < 0) {
+		half_side side = values.player_width[- degrees];
+		return {side.x, - side.y};
+	}
+	return values.player_width[degrees];
+}
+
+inline half_side Rotation_Table::wall_length(int degrees) {
+	if (degrees < 0) {
+		half_side side = values.wall_length[- degrees];
+		return {- side.x, side.y};
+	}
+	return values.wall_length[degrees];
+}
+
+#endif
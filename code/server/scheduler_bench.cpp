@@ -0,0 +1,150 @@
+/*
+Scheduler benchmark
+
+Chaos The Game
+
+Runs many full arenas on the scheduler's worker pool for a few seconds, without a server or a
+socket. Each arena is given four players who never press anything, so games go on until the
+bombs end them, and finished arenas are reset and filled again the way the gameserver would.
+Afterwards the work done by each worker and how late the arenas' frames were are printed.
+
+usage: ./scheduler_bench.out [arenas] [workers, 0 for one for each core] [seconds]
+*/
+
+// include game files
+#include "arena.h"
+#include "arena_scheduler.h"
+#include "player.h"
+#include "frame_scheduler.h"
+#include "snapshot.h"
+
+// include other dependencies
+#include <vector>
+#include <thread>
+#include <chrono>
+// used for printing
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+// how often (milliseconds) the stand-in for the gameserver throws away snapshots and resets arenas
+static const int SERVER_INTERVAL_MS = 10;
+
+
+// gives an empty arena four new players, deleting the players of its last game
+void fill_arena(Arena* arena, vector<Player*>& players) {
+	for (Player* player : players) {
+		delete player;
+	}
+	players.clear();
+
+	for (int i = 0; i < Arena::MAX_PLAYERS; i++) {
+		Player* player = new Player();
+		arena->add_player(player);
+		players.push_back(player);
+	}
+}
+
+
+int main(int argc, char** argv) {
+	int num_arenas = 1000;
+	int num_workers = 0;
+	int seconds = 5;
+	if (argc > 1) {
+		num_arenas = atoi(argv[1]);
+	}
+	if (argc > 2) {
+		num_workers = atoi(argv[2]);
+	}
+	if (argc > 3) {
+		seconds = atoi(argv[3]);
+	}
+	if ((num_arenas <= 0) || (num_workers < 0) || (seconds <= 0)) {
+		printf("usage: %s [arenas] [workers, 0 for one for each core] [seconds]\n", argv[0]);
+		return 1;
+	}
+
+	Arena_Scheduler scheduler(num_workers);
+	vector<Arena*> arenas;
+	vector<vector<Player*>> players(num_arenas);
+
+	scheduler.start();
+	for (int i = 0; i < num_arenas; i++) {
+		Arena* arena = new Arena();
+		arenas.push_back(arena);
+		scheduler.add(arena);
+		fill_arena(arena, players[i]);
+	}
+
+	printf("%d arenas on %d workers for %d seconds\n", num_arenas, scheduler.get_num_workers(), seconds);
+
+	// stands in for the gameserver's action loop
+	long long snapshots = 0;
+	long long games = 0;
+	chrono::steady_clock::time_point end = chrono::steady_clock::now() + chrono::seconds(seconds);
+	while (chrono::steady_clock::now() < end) {
+		this_thread::sleep_for(chrono::milliseconds(SERVER_INTERVAL_MS));
+
+		for (int i = 0; i < num_arenas; i++) {
+			Arena* arena = arenas[i];
+
+			// nobody is listening, hand the snapshots straight back
+			vector<snapshot_struct> outgoing;
+			arena->lock_mutex();
+			swap(outgoing, arena->outgoing_queue);
+			arena->unlock_mutex();
+			snapshots += outgoing.size();
+			arena->recycle_snapshots(outgoing);
+
+			if (arena->ready_to_reset) {
+				arena->finish_reset();
+				fill_arena(arena, players[i]);
+				games++;
+			}
+		}
+	}
+
+	vector<worker_stats> stats = scheduler.get_stats();
+	scheduler.stop();
+
+	printf("%lld snapshots, %lld games finished\n\n", snapshots, games);
+	printf("  %-8s %12s %12s %12s %14s %12s\n", "worker", "ticks", "steals", "sleeps", "ns/tick", "utilization");
+	for (int i = 0; i < (int) stats.size(); i++) {
+		double ns_per_tick = (stats[i].ticks > 0) ? (double) stats[i].busy_ns / stats[i].ticks : 0.0;
+		printf("  %-8d %12lld %12lld %12lld %14.0f %11.1f%%\n", i, stats[i].ticks, stats[i].steals, stats[i].sleeps,
+			   ns_per_tick, stats[i].utilization * 100);
+	}
+
+	// how closely the frames kept to their deadlines, over every arena
+	long long frames = 0;
+	long long late_frames = 0;
+	long long skipped_frames = 0;
+	long long total_lateness_us = 0;
+	long long max_lateness_us = 0;
+	for (Arena* arena : arenas) {
+		frame_stats arena_stats = arena->frame_scheduler.get_stats();
+		frames += arena_stats.frames;
+		late_frames += arena_stats.late_frames;
+		skipped_frames += arena_stats.skipped_frames;
+		total_lateness_us += arena_stats.total_lateness_us;
+		if (arena_stats.max_lateness_us > max_lateness_us) {
+			max_lateness_us = arena_stats.max_lateness_us;
+		}
+	}
+
+	printf("\n%lld frames, %.2f%% more than 1 ms late, %lld skipped\n", frames,
+		   (frames > 0) ? 100.0 * late_frames / frames : 0.0, skipped_frames);
+	printf("lateness: %.3f ms average, %.3f ms max\n", (frames > 0) ? (double) total_lateness_us / frames / 1000 : 0.0,
+		   (double) max_lateness_us / 1000);
+
+	for (int i = 0; i < num_arenas; i++) {
+		delete arenas[i];
+		for (Player* player : players[i]) {
+			delete player;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*
+Server config file
+Settings for the gameserver, read from the command line and an optional config file
+
+Chaos The Game
+*/
+
+#include "server_config.h"
+
+#include <string>
+#include <fstream>
+#include <thread>
+#include <charconv>
+#include <algorithm>
+
+using namespace std;
+
+
+// the number of arenas run when no minimum is given, the same as the server always used to run
+static const int DEFAULT_MIN_ARENAS = 3;
+// the default maximum number of arenas for each core, an arena only uses a fraction of a core
+static const int DEFAULT_ARENAS_PER_CORE = 64;
+// the default idle time (seconds) before an extra arena is shut down
+static const int DEFAULT_IDLE_TIMEOUT_S = 60;
+// the default port, the proxy forwards websocket connections here
+static const int DEFAULT_PORT = 8080;
+// the default time (seconds) between the statistics written to the log
+static const int DEFAULT_STATS_INTERVAL_S = 60;
+
+
+server_config default_server_config() {
+	server_config config;
+	config.port = DEFAULT_PORT;
+	config.min_arenas = DEFAULT_MIN_ARENAS;
+	// chosen from the number of cores once the minimum is known
+	config.max_arenas = 0;
+	config.idle_timeout_s = DEFAULT_IDLE_TIMEOUT_S;
+	config.worker_threads = 0;
+	// a single thread for the sockets, the same as the server always used to run
+	config.io_threads = 1;
+	config.stats_interval_s = DEFAULT_STATS_INTERVAL_S;
+	return config;
+}
+
+// reads a whole string as a number no smaller than minimum
+static bool parse_number(const string& text, int minimum, int maximum, int& value) {
+	int result;
+	from_chars_result parsed = from_chars(text.data(), text.data() + text.size(), result);
+	if ((parsed.ec != errc()) || (parsed.ptr != text.data() + text.size())) {
+		return false;
+	}
+	if ((result < minimum) || (result > maximum)) {
+		return false;
+	}
+	value = result;
+	return true;
+}
+
+// applies one setting by name, used for both the command line and the config file
+static bool apply_setting(const string& name, const string& value, server_config& config, string& error) {
+	int number;
+	
+	if (name == "min-arenas") {
+		if (!parse_number(value, 0, 100000, number)) {
+			error = "min-arenas must be a number, 0 or more";
+			return false;
+		}
+		config.min_arenas = number;
+	} else if (name == "max-arenas") {
+		if (!parse_number(value, 1, 100000, number)) {
+			error = "max-arenas must be a number, 1 or more";
+			return false;
+		}
+		config.max_arenas = number;
+	} else if (name == "idle-timeout") {
+		if (!parse_number(value, 0, 86400, number)) {
+			error = "idle-timeout must be a number of seconds, 0 or more";
+			return false;
+		}
+		config.idle_timeout_s = number;
+	} else if (name == "workers") {
+		if (!parse_number(value, 0, 1024, number)) {
+			error = "workers must be a number, 0 for one for each core";
+			return false;
+		}
+		config.worker_threads = number;
+	} else if (name == "io-threads") {
+		if (!parse_number(value, 0, 1024, number)) {
+			error = "io-threads must be a number, 0 for one for each core";
+			return false;
+		}
+		config.io_threads = number;
+	} else if (name == "port") {
+		if (!parse_number(value, 1, 65535, number)) {
+			error = "port must be between 1 and 65535";
+			return false;
+		}
+		config.port = number;
+	} else if (name == "stats-interval") {
+		if (!parse_number(value, 0, 86400, number)) {
+			error = "stats-interval must be a number of seconds, 0 for never";
+			return false;
+		}
+		config.stats_interval_s = number;
+	} else {
+		error = "unknown setting " + name;
+		return false;
+	}
+	
+	return true;
+}
+
+// removes spaces and tabs from both ends
+static string trim(const string& text) {
+	size_t first = text.find_first_not_of(" \t\r");
+	if (first == string::npos) {
+		return "";
+	}
+	size_t last = text.find_last_not_of(" \t\r");
+	return text.substr(first, last - first + 1);
+}
+
+static bool load_config_file(const string& path, server_config& config, string& error) {
+	ifstream file(path);
+	if (!file) {
+		error = "could not open config file " + path;
+		return false;
+	}
+	
+	string line;
+	int line_number = 0;
+	while (getline(file, line)) {
+		line_number++;
+		line = trim(line);
+		if (line.empty() || (line[0] == '#')) {
+			continue;
+		}
+		
+		size_t equals = line.find('=');
+		if (equals == string::npos) {
+			error = path + ":" + to_string(line_number) + ": expected name = value";
+			return false;
+		}
+		if (!apply_setting(trim(line.substr(0, equals)), trim(line.substr(equals + 1)), config, error)) {
+			error = path + ":" + to_string(line_number) + ": " + error;
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+bool load_server_config(int argc, char** argv, server_config& config, string& error) {
+	config = default_server_config();
+	
+	// every option takes a value
+	if ((argc - 1) % 2 != 0) {
+		error = string("missing value for ") + argv[argc - 1];
+		return false;
+	}
+	
+	// the config file is read first, so the rest of the command line overrides it
+	for (int i = 1; i < argc; i += 2) {
+		if (string(argv[i]) == "--config") {
+			if (!load_config_file(argv[i + 1], config, error)) {
+				return false;
+			}
+		}
+	}
+	
+	for (int i = 1; i < argc; i += 2) {
+		string option = argv[i];
+		if (option == "--config") {
+			continue;
+		}
+		if (option.compare(0, 2, "--") != 0) {
+			error = "unknown option " + option;
+			return false;
+		}
+		if (!apply_setting(option.substr(2), argv[i + 1], config, error)) {
+			return false;
+		}
+	}
+	
+	// without a maximum, allow a few arenas for each core, and never fewer than the minimum
+	if (config.max_arenas == 0) {
+		// hardware_concurrency returns 0 if the number of cores is unknown
+		int cores = max(1, (int) thread::hardware_concurrency());
+		config.max_arenas = max(config.min_arenas, cores * DEFAULT_ARENAS_PER_CORE);
+	}
+	
+	if (config.max_arenas < config.min_arenas) {
+		error = "max-arenas must be at least min-arenas";
+		return false;
+	}
+	
+	return true;
+}
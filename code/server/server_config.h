@@ -0,0 +1,61 @@
+/*
+Server config header file
+Settings for the gameserver, read from the command line and an optional config file
+
+Chaos The Game
+
+Command line options:
+	--config <path>         read settings from a config file first
+	--min-arenas <n>        arenas kept running even when nobody is playing
+	--max-arenas <n>        the most arenas that can run at once
+	--idle-timeout <s>      seconds an arena above the minimum may sit empty before it is shut down
+	--workers <n>           threads that run the arenas, 0 for one for each core
+	--io-threads <n>        threads that handle websocket traffic, 0 for one for each core
+	--port <n>              the port to listen on
+	--stats-interval <s>    seconds between the statistics written to the log, 0 for never
+Options on the command line override the config file.
+
+The config file has one setting per line, "name = value", using the names of the options
+without the dashes (min-arenas = 2). Blank lines and lines starting with # are ignored.
+*/
+
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+
+/*
+This is a struct to contain the settings of the gameserver.
+*/
+typedef struct server_config {
+	// the port to listen on, the proxy forwards websocket connections here
+	uint16_t port;
+	// the arena pool grows from min_arenas up to max_arenas as players arrive
+	int min_arenas;
+	int max_arenas;
+	// how long (seconds) an arena above the minimum may be empty before it is shut down
+	int idle_timeout_s;
+	// the number of threads that run the arenas, 0 for one for each core
+	int worker_threads;
+	// the number of threads that read and write the sockets, 0 for one for each core
+	// each has its own action loop and arenas, players are matched across all of them,
+	// threads beyond max_arenas only carry websocket traffic
+	int io_threads;
+	// how often (seconds) the worker, matchmaking and frame statistics are logged, 0 for never
+	int stats_interval_s;
+} server_config;
+
+
+// the settings used when nothing else is given
+// the maximum is left at 0, load_server_config scales it with the number of cores
+server_config default_server_config();
+
+// reads the command line, and the config file if one is given, on top of the defaults
+// returns false and describes the problem in error if a setting is unknown or invalid
+bool load_server_config(int argc, char** argv, server_config& config, string& error);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+Shard placement class file
+Picks the arena a new connection will play in, out of every shard's arenas, and pins the connection
+to the shard that owns that arena
+
+Chaos The Game
+*/
+
+#include "shard_placement.h"
+#include "arena.h"
+
+#include <vector>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+using namespace std;
+
+
+Shard_Placement::Shard_Placement(int num_shards, int max_arenas) {
+	shards.resize(num_shards);
+	for (shard_entry& entry : shards) {
+		entry.waiting = 0;
+		entry.pending = 0;
+	}
+	free_arenas = max_arenas;
+}
+
+Shard_Placement::~Shard_Placement() {
+	// the arenas belong to the shards
+}
+
+int Shard_Placement::connect(connection_hdl handler) {
+	int shard;
+	{
+		lock_guard<mutex> guard(placement_lock);
+		shard = find_open_seat();
+		if (shard < 0) {
+			shard = find_growing_shard();
+		}
+		shards[shard].pending++;
+	}
+
+	unique_lock<shared_mutex> guard(pinned_lock);
+	pinned[handler] = shard;
+	return shard;
+}
+
+int Shard_Placement::find(connection_hdl handler) {
+	shared_lock<shared_mutex> guard(pinned_lock);
+	map<connection_hdl, int, owner_less<connection_hdl>>::iterator itr = pinned.find(handler);
+	return (itr != pinned.end()) ? itr->second : -1;
+}
+
+int Shard_Placement::disconnect(connection_hdl handler) {
+	unique_lock<shared_mutex> guard(pinned_lock);
+	map<connection_hdl, int, owner_less<connection_hdl>>::iterator itr = pinned.find(handler);
+	if (itr == pinned.end()) {
+		return -1;
+	}
+	int shard = itr->second;
+	pinned.erase(itr);
+	return shard;
+}
+
+void Shard_Placement::publish(int shard, const vector<open_seats>& seats, int waiting, int connected) {
+	lock_guard<mutex> guard(placement_lock);
+	shard_entry& entry = shards[shard];
+	entry.seats = seats;
+	entry.waiting = waiting;
+	entry.pending = max(0, entry.pending - connected);
+}
+
+bool Shard_Placement::take_arena() {
+	lock_guard<mutex> guard(placement_lock);
+	if (free_arenas <= 0) {
+		return false;
+	}
+	free_arenas--;
+	return true;
+}
+
+void Shard_Placement::give_back_arena() {
+	lock_guard<mutex> guard(placement_lock);
+	free_arenas++;
+}
+
+int Shard_Placement::get_pending(int shard) {
+	lock_guard<mutex> guard(placement_lock);
+	return shards[shard].pending;
+}
+
+
+/*
+the connections on their way to a shard take its seats front first, so a shard's next seat is in the
+first arena with more seats than the connections still to be placed ahead of it
+of the shards with a seat, the one whose arena opened first is picked
+*/
+int Shard_Placement::find_open_seat() {
+	int best = -1;
+	chrono::steady_clock::time_point best_opened_at;
+	for (int i = 0; i < (int) shards.size(); i++) {
+		int ahead = shards[i].pending;
+		for (const open_seats& arena : shards[i].seats) {
+			if (ahead < arena.seats) {
+				if ((best < 0) || (arena.opened_at < best_opened_at)) {
+					best = i;
+					best_opened_at = arena.opened_at;
+				}
+				break;
+			}
+			ahead -= arena.seats;
+		}
+	}
+	return best;
+}
+
+/*
+the connections a shard has no seat for make it create arenas, as many as it takes to seat them
+	- a shard with an arena on the way that has a seat left gets the connection, so the new arenas fill
+	  before any more are created
+	- otherwise, if the pool has room for another arena, the shard with the fewest connections on
+	  their way creates it
+	- otherwise the connection waits on the shard with the fewest players waiting
+a shard already has players waiting only when it could not grow, its arenas are not on the way
+*/
+int Shard_Placement::find_growing_shard() {
+	int arenas_on_the_way = 0;
+	int fewest_pending = 0;
+	int fewest_waiting = 0;
+	int fewest_waiting_count = 0;
+	for (int i = 0; i < (int) shards.size(); i++) {
+		shard_entry& entry = shards[i];
+		int seats = 0;
+		for (const open_seats& arena : entry.seats) {
+			seats += arena.seats;
+		}
+
+		int unseated = max(0, entry.pending - seats);
+		if (entry.waiting == 0) {
+			if (unseated % Arena::MAX_PLAYERS != 0) {
+				return i;
+			}
+			arenas_on_the_way += unseated / Arena::MAX_PLAYERS;
+		}
+
+		if (entry.pending < shards[fewest_pending].pending) {
+			fewest_pending = i;
+		}
+		// the connections without a seat wait behind the players already waiting
+		if ((i == 0) || (entry.waiting + unseated < fewest_waiting_count)) {
+			fewest_waiting = i;
+			fewest_waiting_count = entry.waiting + unseated;
+		}
+	}
+
+	return (free_arenas > arenas_on_the_way) ? fewest_pending : fewest_waiting;
+}
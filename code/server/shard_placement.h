@@ -0,0 +1,99 @@
+/*
+Shard placement class header file
+Picks the arena a new connection will play in, out of every shard's arenas, and pins the connection
+to the shard that owns that arena
+
+Chaos The Game
+
+Each shard's action loop publishes the arenas on its matchmaker's ready queue, oldest first, with the
+seats each has left. A new connection is given the first seat, in the arena that opened first over
+every shard, that has not already been promised to a connection on its way to the shard. A shard's
+matchmaker fills its oldest arena first too, so that is the arena the player is placed in, and the
+players of every shard fill the same lobbies rather than each shard filling its own.
+When no arena has a seat, the connection goes to a shard that will create an arena for it, one that
+already has a new arena on the way with a seat left first, or if the pool is at its maximum, to the
+shard with the fewest players waiting.
+The arena pool's maximum is shared by the shards. A shard takes an arena from it to grow and gives it
+back when it shuts one down, so the arenas one shard leaves unused can be created by another.
+A connection stays pinned to its shard until it closes, so every event of the connection is queued on
+the same shard in the order websocketpp delivers them. The listener callbacks look the shard up under
+a shared lock, so messages only wait on connections opening or closing, never on each other.
+*/
+
+#ifndef SHARD_PLACEMENT_H
+#define SHARD_PLACEMENT_H
+
+// the websocketpp connection handler, without the rest of the library
+#include <websocketpp/common/connection_hdl.hpp>
+
+#include "arena.h"
+#include "matchmaker.h"
+
+#include <vector>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+#include <memory>
+
+using namespace std;
+
+using websocketpp::connection_hdl;
+
+
+class Shard_Placement {
+
+public:
+	// places connections on num_shards shards, which can run up to max_arenas arenas between them
+	Shard_Placement(int num_shards, int max_arenas);
+	~Shard_Placement();
+
+	// picks the shard of a new connection and pins the connection to it, returns the shard
+	int connect(connection_hdl handler);
+	// the shard the connection is pinned to, -1 if it is not pinned
+	int find(connection_hdl handler);
+	// unpins a closed connection, returns the shard it was pinned to, -1 if it was not pinned
+	int disconnect(connection_hdl handler);
+
+	// replaces what the shard published last, called by the shard's action loop
+	// seats are the arenas on the shard's ready queue, oldest first, waiting is the number of players
+	// on its waiting queue, and connected is the number of new connections it has taken since it last
+	// published, those no longer hold a promise of a seat
+	void publish(int shard, const vector<open_seats>& seats, int waiting, int connected);
+
+	// takes an arena from the pool for a shard that is growing, false if the pool is at its maximum
+	bool take_arena();
+	// gives back the arena of a shard that has shut one down
+	void give_back_arena();
+
+	// the connections given to the shard that it has not taken yet
+	int get_pending(int shard);
+
+private:
+	// what a shard last published, and the connections on their way to it
+	struct shard_entry {
+		vector<open_seats> seats;
+		int waiting;
+		// connections given to the shard that it has not taken yet, they fill its arenas front first
+		int pending;
+	};
+
+	// the shard with the next seat in the arena that opened first, -1 if no arena has a seat left
+	int find_open_seat();
+	// the shard to send a connection to when no arena has a seat
+	int find_growing_shard();
+
+	vector<shard_entry> shards;
+	// arenas that can still be created before the pool reaches its maximum
+	int free_arenas;
+	// held while picking a shard and while a shard publishes, guards shards and free_arenas
+	mutex placement_lock;
+
+	// the shard each open connection is pinned to
+	map<connection_hdl, int, owner_less<connection_hdl>> pinned;
+	// the listener callbacks share it to look up a connection, opening and closing one takes it alone
+	shared_mutex pinned_lock;
+
+};
+
+#endif
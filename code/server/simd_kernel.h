@@ -0,0 +1,57 @@
+/*
+SIMD kernel header file
+The instruction sets the vectorized kernels are built for, and picking the fastest one the processor supports
+
+Chaos The Game
+
+Each vectorized kernel is compiled for its own instruction set with the target attribute, so the rest
+of the program does not need to be built for it, and is only called once the processor has been
+checked for it. The scalar kernels are used on other processors.
+*/
+
+#ifndef SIMD_KERNEL_H
+#define SIMD_KERNEL_H
+
+// the vectorized kernels are only built for x86 processors, with compilers that can target
+// instruction sets the rest of the program is not built for
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+// the ways of running a kernel, from slowest to fastest
+enum simd_kernel {
+	SCALAR_KERNEL,
+	SSE2_KERNEL,
+	AVX2_KERNEL
+};
+
+// the fastest kernel the processor supports
+inline simd_kernel best_simd_kernel() {
+#ifdef SIMD_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return AVX2_KERNEL;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return SSE2_KERNEL;
+	}
+#endif
+	return SCALAR_KERNEL;
+}
+
+inline const char* simd_kernel_name(simd_kernel kernel) {
+	switch (kernel) {
+		case AVX2_KERNEL:
+			return "avx2";
+		case SSE2_KERNEL:
+			return "sse2";
+		default:
+			return "scalar";
+	}
+}
+
+#endif
@@ -0,0 +1,256 @@
+/*
+Snapshot file
+The state of an arena sent to its players each frame, and the binary formats it is sent in
+
+Chaos The Game
+*/
+
+#include "snapshot.h"
+
+#include <string>
+#include <vector>
+#include <charconv>
+#include <stdint.h>
+
+using namespace std;
+
+
+Snapshot_History::Snapshot_History() : states(HISTORY_SIZE), filled(HISTORY_SIZE, false) {
+
+}
+
+// nothing to deallocate
+Snapshot_History::~Snapshot_History() {
+
+}
+
+// save a snapshot, replacing the one HISTORY_SIZE ticks before it
+void Snapshot_History::add(const snapshot_state& state) {
+	int index = state.tick % HISTORY_SIZE;
+	states[index] = state;
+	filled[index] = true;
+}
+
+// find the snapshot with the given tick
+const snapshot_state* Snapshot_History::find(uint32_t tick) const {
+	int index = tick % HISTORY_SIZE;
+	// the entry may have been replaced by a newer tick
+	if (!filled[index] || (states[index].tick != tick)) {
+		return NULL;
+	}
+	return &states[index];
+}
+
+
+// write a snapshot in the version 1 format
+void write_snapshot_v1(const snapshot_state& state, string& message) {
+	const vector<entity_state>& players = state.sections[PLAYER_SECTION];
+	const vector<entity_state>& walls = state.sections[WALL_SECTION];
+	const vector<entity_state>& bombs = state.sections[BOMB_SECTION];
+	const vector<entity_state>& projectiles = state.sections[PROJECTILE_SECTION];
+
+	// the counts are limited to what fits in the header
+	size_t player_count = min(players.size(), (size_t) UINT8_MAX);
+	size_t wall_count = min(walls.size(), (size_t) UINT8_MAX);
+	size_t bomb_count = min(bombs.size(), (size_t) UINT8_MAX);
+	size_t projectile_count = min(projectiles.size(), (size_t) UINT16_MAX);
+
+	// allocate the whole message at once
+	message.reserve(6 + (7 * player_count) + (6 * wall_count) + (6 * bomb_count) + (4 * projectile_count));
+
+	write_u8(message, BINARY_SNAPSHOT_VERSION_1);
+	write_u8(message, player_count);
+	write_u8(message, wall_count);
+	write_u8(message, bomb_count);
+	write_u16(message, projectile_count);
+
+	for (size_t i = 0; i < player_count; i++) {
+		write_u8(message, players[i].id);
+		write_u16(message, players[i].fields[0]);
+		write_u16(message, players[i].fields[1]);
+		write_u16(message, players[i].fields[2]);
+	}
+
+	for (size_t i = 0; i < wall_count; i++) {
+		write_u16(message, walls[i].fields[0]);
+		write_u16(message, walls[i].fields[1]);
+		write_u16(message, walls[i].fields[2]);
+	}
+
+	for (size_t i = 0; i < bomb_count; i++) {
+		write_u16(message, bombs[i].fields[0]);
+		write_u16(message, bombs[i].fields[1]);
+		write_u8(message, bombs[i].fields[2]);
+		write_u8(message, bombs[i].fields[3]);
+	}
+
+	for (size_t i = 0; i < projectile_count; i++) {
+		write_u16(message, projectiles[i].fields[0]);
+		write_u16(message, projectiles[i].fields[1]);
+	}
+}
+
+// write a snapshot in the version 2 format, as a keyframe
+void write_keyframe(const snapshot_state& state, string& message) {
+	write_u8(message, BINARY_SNAPSHOT_VERSION_2);
+	write_u8(message, KEYFRAME_SNAPSHOT);
+	write_u32(message, state.tick);
+
+	for (int section = 0; section < NUM_SECTIONS; section++) {
+		const vector<entity_state>& entities = state.sections[section];
+		size_t count = min(entities.size(), (size_t) UINT16_MAX);
+
+		write_u16(message, count);
+		for (size_t i = 0; i < count; i++) {
+			write_u16(message, entities[i].id);
+			for (int field = 0; field < SECTION_FIELDS[section]; field++) {
+				write_u16(message, entities[i].fields[field]);
+			}
+		}
+	}
+}
+
+// overwrite a u16 that was written earlier as a placeholder
+static void patch_u16(string& message, size_t position, uint16_t value) {
+	message[position] = (char) (value & 0xff);
+	message[position + 1] = (char) (value >> 8);
+}
+
+// write a new or changed entity, with only the fields in the mask
+static void write_changed_entity(string& message, const entity_state& entity, int mask, int field_count) {
+	write_u16(message, entity.id);
+	write_u8(message, mask);
+	for (int field = 0; field < field_count; field++) {
+		if (mask & (1 << field)) {
+			write_u16(message, entity.fields[field]);
+		}
+	}
+}
+
+/*
+both lists of entities are sorted by id, so they are walked side by side:
+	- an id only in the baseline has been removed
+	- an id only in the current state is new, all of its fields are sent
+	- an id in both is sent with the fields that changed, if any
+*/
+static void write_section_delta(const vector<entity_state>& current, const vector<entity_state>& baseline,
+								int field_count, string& message) {
+	// every field set
+	int all_fields = (1 << field_count) - 1;
+
+	// first, the removed entities
+	size_t count_position = message.size();
+	write_u16(message, 0);
+	uint16_t removed = 0;
+
+	size_t c = 0;
+	size_t b = 0;
+	while (b < baseline.size()) {
+		if ((c == current.size()) || (baseline[b].id < current[c].id)) {
+			if (removed < UINT16_MAX) {
+				write_u16(message, baseline[b].id);
+				removed++;
+			}
+			b++;
+		} else if (baseline[b].id == current[c].id) {
+			b++;
+			c++;
+		} else {
+			c++;
+		}
+	}
+	patch_u16(message, count_position, removed);
+
+	// then the new and changed entities
+	count_position = message.size();
+	write_u16(message, 0);
+	uint16_t changed = 0;
+
+	c = 0;
+	b = 0;
+	while ((c < current.size()) && (changed < UINT16_MAX)) {
+		if ((b == baseline.size()) || (current[c].id < baseline[b].id)) {
+			// new entity
+			write_changed_entity(message, current[c], all_fields, field_count);
+			changed++;
+			c++;
+		} else if (current[c].id == baseline[b].id) {
+			// find the fields that changed
+			int mask = 0;
+			for (int field = 0; field < field_count; field++) {
+				if (current[c].fields[field] != baseline[b].fields[field]) {
+					mask |= (1 << field);
+				}
+			}
+			if (mask != 0) {
+				write_changed_entity(message, current[c], mask, field_count);
+				changed++;
+			}
+			b++;
+			c++;
+		} else {
+			// removed entity, already written
+			b++;
+		}
+	}
+	patch_u16(message, count_position, changed);
+}
+
+// write a snapshot in the version 2 format, as a delta against the baseline
+void write_delta(const snapshot_state& state, const snapshot_state& baseline, string& message) {
+	write_u8(message, BINARY_SNAPSHOT_VERSION_2);
+	write_u8(message, DELTA_SNAPSHOT);
+	write_u32(message, state.tick);
+	write_u32(message, baseline.tick);
+
+	for (int section = 0; section < NUM_SECTIONS; section++) {
+		write_section_delta(state.sections[section], baseline.sections[section], SECTION_FIELDS[section], message);
+	}
+}
+
+// read the acknowledged tick, the fourth value of an input message
+bool read_acked_tick(const string& message, uint32_t& tick) {
+	// skip past the third comma
+	size_t position = 0;
+	for (int i = 0; i < 3; i++) {
+		position = message.find(',', position);
+		if (position == string::npos) {
+			return false;
+		}
+		position++;
+	}
+
+	const char* first = message.data() + position;
+	const char* last = message.data() + message.size();
+	from_chars_result result = from_chars(first, last, tick);
+	return (result.ec == errc()) && (result.ptr != first);
+}
+
+
+// append a single byte
+void write_u8(string& message, uint8_t value) {
+	message += (char) value;
+}
+
+// append two bytes, least significant first
+void write_u16(string& message, uint16_t value) {
+	message += (char) (value & 0xff);
+	message += (char) (value >> 8);
+}
+
+// append four bytes, least significant first
+void write_u32(string& message, uint32_t value) {
+	write_u16(message, value & 0xffff);
+	write_u16(message, value >> 16);
+}
+
+// round a position to the nearest pixel and clamp it to the range of a u16
+uint16_t quantize_position(double value) {
+	if (value <= 0) {
+		return 0;
+	}
+	if (value >= 65535) {
+		return 65535;
+	}
+	return (uint16_t) (value + 0.5);
+}
@@ -0,0 +1,162 @@
+/*
+Snapshot header file
+The state of an arena sent to its players each frame, and the binary formats it is sent in
+
+Chaos The Game
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+
+/*
+There are three snapshot formats, chosen by the websocket subprotocol the client requests when it
+connects. Clients that request neither binary subprotocol are sent the text format built by the arena.
+
+In both binary formats, every value is unsigned and little-endian, and positions are rounded to the
+nearest pixel.
+
+binary format, version 1 (full snapshots)
+header:
+	u8 version, u8 player count, u8 wall count, u8 bomb count, u16 projectile count
+each player:
+	u8 player id (the player's slot, which is also its color index), u16 x, u16 y, u16 rotation
+each wall:
+	u16 x, u16 y, u16 rotation
+each bomb:
+	u16 x, u16 y, u8 radius, u8 warning mode
+each projectile:
+	u16 x, u16 y
+
+binary format, version 2 (keyframes and deltas)
+header:
+	u8 version, u8 type (0 for a keyframe, 1 for a delta), u32 tick
+	for a delta only, u32 baseline tick, the tick of the snapshot the delta applies to
+then the four sections in order: players, walls, bombs, projectiles
+every entity has a u16 id that is unique within its section, and a fixed number of u16 fields
+	players: x, y, rotation, the id is the player's slot
+	walls: x, y, rotation
+	bombs: x, y, radius, warning mode
+	projectiles: x, y
+a keyframe section:
+	u16 count, then for each entity: u16 id, each field
+a delta section:
+	u16 removed count, then the u16 id of each entity that is no longer in the section
+	u16 changed count, then for each new or changed entity: u16 id, u8 field mask, each field in the mask
+	new entities always have every field in the mask
+The client acknowledges the latest tick it has received by adding it as a fourth value to its input
+messages ("rotation,velocity,space,tick"). Deltas are only sent against the last acknowledged tick.
+*/
+static const uint8_t BINARY_SNAPSHOT_VERSION_1 = 1;
+static const uint8_t BINARY_SNAPSHOT_VERSION_2 = 2;
+
+// the websocket subprotocols a client requests to receive binary snapshots
+static const char BINARY_SNAPSHOT_PROTOCOL_1[] = "chaos.binary.v1";
+static const char BINARY_SNAPSHOT_PROTOCOL_2[] = "chaos.binary.v2";
+
+// the types of version 2 snapshots
+static const uint8_t KEYFRAME_SNAPSHOT = 0;
+static const uint8_t DELTA_SNAPSHOT = 1;
+
+
+// the sections of a snapshot, in the order they are sent
+enum snapshot_section {
+	PLAYER_SECTION,
+	WALL_SECTION,
+	BOMB_SECTION,
+	PROJECTILE_SECTION,
+	NUM_SECTIONS
+};
+
+// the number of fields of each entity in each section
+static const int SECTION_FIELDS[NUM_SECTIONS] = {3, 3, 4, 2};
+// the most fields any entity has
+static const int MAX_FIELDS = 4;
+
+
+/*
+This is a struct to contain the state of a single entity, already rounded to what is sent.
+*/
+typedef struct entity_state {
+	// unique within the entity's section
+	uint16_t id;
+	// the values sent for the entity, only the first SECTION_FIELDS of the section are used
+	uint16_t fields[MAX_FIELDS];
+} entity_state;
+
+/*
+This is a struct to contain the state of an arena for one frame.
+The entities in each section are sorted by id.
+*/
+typedef struct snapshot_state {
+	// counts up by one for every snapshot the arena sends
+	uint32_t tick;
+	vector<entity_state> sections[NUM_SECTIONS];
+} snapshot_state;
+
+/*
+This is a struct to contain one snapshot of an arena.
+The text format is built by the arena, the binary formats are built for each player from the state.
+*/
+typedef struct snapshot_struct {
+	// comma and slash separated text
+	string text;
+	// the state the binary formats are built from
+	snapshot_state state;
+} snapshot_struct;
+
+
+/*
+Keeps the most recent snapshots sent by an arena, so deltas can be built against any of them.
+*/
+class Snapshot_History {
+
+public:
+	Snapshot_History();
+	~Snapshot_History();
+
+	// the number of snapshots kept, older acknowledgements get a keyframe instead of a delta
+	static const int HISTORY_SIZE = 32;
+
+	// save a snapshot, replacing the one HISTORY_SIZE ticks before it
+	void add(const snapshot_state& state);
+
+	// find the snapshot with the given tick, returns NULL if it is no longer (or was never) kept
+	const snapshot_state* find(uint32_t tick) const;
+
+private:
+	// indexed by tick, wrapped around the size of the history
+	vector<snapshot_state> states;
+	// whether each entry has been filled yet
+	vector<bool> filled;
+
+};
+
+
+// write a snapshot in the version 1 format
+void write_snapshot_v1(const snapshot_state& state, string& message);
+
+// write a snapshot in the version 2 format, as a keyframe
+void write_keyframe(const snapshot_state& state, string& message);
+
+// write a snapshot in the version 2 format, as a delta against the baseline
+void write_delta(const snapshot_state& state, const snapshot_state& baseline, string& message);
+
+// read the acknowledged tick, the fourth value of an input message, returns false if there is none
+bool read_acked_tick(const string& message, uint32_t& tick);
+
+// append a fixed-width value to a binary message
+void write_u8(string& message, uint8_t value);
+void write_u16(string& message, uint16_t value);
+void write_u32(string& message, uint32_t value);
+
+// round a position to the nearest pixel and clamp it to the range of a u16
+uint16_t quantize_position(double value);
+
+#endif
@@ -0,0 +1,380 @@
+/*
+Snapshot benchmark
+
+Chaos The Game
+
+Checks and times the text snapshot written by the arena each frame.
+	- golden output: for arenas holding every kind of object, the Text_Writer output is compared
+	  byte for byte with the string built the way send_message used to build it, with to_string
+	  and string concatenation, the program fails if any of them differ
+	- timing: the average time and heap allocations per snapshot for both ways of building it,
+	  from an empty arena up to a few hundred projectiles
+	- sending: the time and heap allocations of the whole send_message call, with the snapshots
+	  handed back the way the server hands them back once they are sent, the program fails if a
+	  message allocates once the arena has spare snapshots
+
+usage: ./snapshot_bench.out [snapshots per run]
+*/
+
+// include game files
+#include "arena.h"
+#include "player.h"
+#include "projectile.h"
+#include "wall.h"
+#include "wall_manager.h"
+#include "bomb.h"
+#include "bomb_manager.h"
+#include "text_writer.h"
+
+// include other dependencies
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <new>
+// used for printing and random number generation
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+
+/*
+allocation counting, the same as the arena benchmark
+every call into the global allocator made by this program goes through these operators
+*/
+
+// total number of allocations since the program started
+static unsigned long allocation_count = 0;
+
+void* operator new(size_t size) {
+	allocation_count++;
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
+
+
+// the results of timing one way of building the snapshot
+typedef struct snapshot_result {
+	// average time per snapshot (nanoseconds)
+	double ns;
+	// average heap allocations per snapshot
+	double allocations;
+} snapshot_result;
+
+
+class Snapshot_Bench {
+
+public:
+	Snapshot_Bench();
+	~Snapshot_Bench();
+
+	// start a game and fill the arena with projectiles and bombs
+	void fill(int projectile_count, int bomb_count);
+
+	// builds the text snapshot the way send_message used to, kept as the golden output
+	string legacy_snapshot();
+	// builds the text snapshot with the arena's writer
+	string writer_snapshot();
+
+	// time each way of building the snapshot
+	snapshot_result time_legacy(int snapshots);
+	snapshot_result time_writer(int snapshots);
+	// time send_message, the text and the state queued for the server
+	snapshot_result time_send(int snapshots);
+
+	// the size of the current snapshot
+	size_t snapshot_size();
+
+private:
+	Arena arena;
+	vector<Player*> players;
+	// reused from one snapshot to the next, like the arena's own writer
+	Text_Writer writer;
+
+};
+
+
+Snapshot_Bench::Snapshot_Bench() {
+	for (int i = 0; i < Arena::MAX_PLAYERS; i++) {
+		Player* player = new Player();
+		arena.add_player(player);
+		players.push_back(player);
+	}
+}
+
+Snapshot_Bench::~Snapshot_Bench() {
+	// the arena does not own its players, the server normally deletes them
+	arena.clean_up();
+	for (Player* player : players) {
+		delete player;
+	}
+}
+
+void Snapshot_Bench::fill(int projectile_count, int bomb_count) {
+	arena.setup();
+
+	// odd fractions exercise the rounding of positions
+	for (int i = 0; i < projectile_count; i++) {
+		arena.projectiles.add(Projectile(rand() % 900 + 30 + (rand() % 100) / 100.0,
+										 rand() % 580 + 30 + (rand() % 100) / 100.0, rand() % 360, 0));
+	}
+
+	for (int i = 0; i < bomb_count; i++) {
+		Bomb* bomb = arena.bomb_manager.add_bomb(rand() % 900 + 30, rand() % 580 + 30);
+		bomb->radius = (rand() % 4000) / 100.0;
+		bomb->warning_mode = (i % 2 == 0);
+	}
+
+	// turn some of the walls so rotations other than 0 are written
+	int i = 0;
+	for (Wall* wall : arena.wall_manager.walls) {
+		if (i % 3 == 0) {
+			wall->rotation = 90;
+		} else if (i % 3 == 1) {
+			wall->rotation = 357;
+		}
+		i++;
+	}
+
+	// players at fractional positions, one of them past the edge of the screen
+	i = 0;
+	for (Player* player : arena.arena_players) {
+		player->posX = 100.5 + i * 211.25;
+		player->posY = (i == 3) ? -0.75 : 300.49 + i;
+		player->rotation = i * 95;
+		i++;
+	}
+}
+
+string Snapshot_Bench::legacy_snapshot() {
+	string message = "";
+
+	// used for omitting the first comma
+	int i = 0;
+
+	// add each player's data to the message
+	for (Player* player : arena.arena_players) {
+		// don't add a comma if it is the first element of the message
+		if (i != 0) {
+			message += ",";
+		}
+
+		// append the message string with the data
+		message += player->color;
+		message += "," + to_string((int) (player->posX + 0.5));
+		message += "," + to_string((int) (player->posY + 0.5));
+		message += "," + to_string(player->rotation);
+
+		i++;
+	}
+
+	message += "/";
+	i = 0;
+
+	// add each wall's data to the message
+	for (Wall* wall : arena.wall_manager.walls) {
+		if (i != 0) {
+			message += ",";
+		}
+
+		message += to_string(wall->posX);
+		message += "," + to_string(wall->posY);
+		message += "," + to_string(wall->rotation);
+
+		i++;
+	}
+
+	message += "/";
+	i = 0;
+
+	// necessary since there may not be any bombs but there must be something between /'s
+	message += "=====,";
+
+	// add each projectile's data to the message
+	for (Bomb* bomb : arena.bomb_manager.bombs) {
+		if (i != 0) {
+			message += ",";
+		}
+
+		message += to_string(bomb->posX);
+		message += "," + to_string(bomb->posY);
+		message += "," + to_string((int) bomb->radius);
+		message += "," + to_string((int) bomb->warning_mode);
+
+		i++;
+	}
+
+	message += "/";
+	i = 0;
+
+	// add each projectile's data to the message
+	for (i = 0; i < arena.projectiles.size(); i++) {
+		if (i != 0) {
+			message += ",";
+		}
+
+		message += to_string((int) (arena.projectiles.posX[i] + 0.5));
+		message += "," + to_string((int) (arena.projectiles.posY[i] + 0.5));
+	}
+
+	return message;
+}
+
+string Snapshot_Bench::writer_snapshot() {
+	writer.clear();
+	arena.write_text_snapshot(writer);
+	return string(writer.data(), writer.size());
+}
+
+snapshot_result Snapshot_Bench::time_legacy(int snapshots) {
+	size_t bytes = 0;
+	unsigned long allocations = allocation_count;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	for (int i = 0; i < snapshots; i++) {
+		string message = legacy_snapshot();
+		// keep the compiler from throwing the message away
+		bytes += message.size();
+	}
+
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	snapshot_result result;
+	result.ns = (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / snapshots;
+	result.allocations = (double) (allocation_count - allocations) / snapshots;
+	if (bytes == 0) {
+		printf("empty snapshots\n");
+	}
+	return result;
+}
+
+snapshot_result Snapshot_Bench::time_writer(int snapshots) {
+	size_t bytes = 0;
+	// the first snapshot grows the buffer to its steady state size, it is not counted
+	writer.clear();
+	arena.write_text_snapshot(writer);
+
+	unsigned long allocations = allocation_count;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	for (int i = 0; i < snapshots; i++) {
+		writer.clear();
+		arena.write_text_snapshot(writer);
+		bytes += writer.size();
+	}
+
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	snapshot_result result;
+	result.ns = (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / snapshots;
+	result.allocations = (double) (allocation_count - allocations) / snapshots;
+	if (bytes == 0) {
+		printf("empty snapshots\n");
+	}
+	return result;
+}
+
+snapshot_result Snapshot_Bench::time_send(int snapshots) {
+	// the first message allocates the snapshot every later one reuses, it is not counted
+	arena.send_message();
+	arena.recycle_snapshots(arena.outgoing_queue);
+
+	unsigned long allocations = allocation_count;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	for (int i = 0; i < snapshots; i++) {
+		arena.send_message();
+		// nobody is listening, the snapshot is handed straight back
+		arena.recycle_snapshots(arena.outgoing_queue);
+	}
+
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	snapshot_result result;
+	result.ns = (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count() / snapshots;
+	result.allocations = (double) (allocation_count - allocations) / snapshots;
+	return result;
+}
+
+size_t Snapshot_Bench::snapshot_size() {
+	return legacy_snapshot().size();
+}
+
+
+int main(int argc, char** argv) {
+	int snapshots = 20000;
+	if (argc > 1) {
+		snapshots = atoi(argv[1]);
+	}
+	if (snapshots <= 0) {
+		printf("usage: %s [snapshots per run]\n", argv[0]);
+		return 1;
+	}
+
+	// the same arenas every run
+	srand(1);
+
+	// the number of projectiles and bombs in each arena checked and timed
+	const int loads[][2] = {{0, 0}, {10, 4}, {100, 24}, {400, 48}};
+
+	// golden output
+	int failures = 0;
+	for (const int* load : loads) {
+		Snapshot_Bench bench;
+		bench.fill(load[0], load[1]);
+		if (bench.legacy_snapshot() != bench.writer_snapshot()) {
+			printf("golden output mismatch with %d projectiles and %d bombs\n", load[0], load[1]);
+			printf("  expected: %s\n", bench.legacy_snapshot().c_str());
+			printf("  written:  %s\n", bench.writer_snapshot().c_str());
+			failures++;
+		}
+	}
+	if (failures > 0) {
+		return 1;
+	}
+	printf("golden output matches for all %zu arenas\n\n", sizeof(loads) / sizeof(loads[0]));
+
+	// timing
+	printf("%d snapshots per run\n", snapshots);
+	printf("%12s %8s %16s %16s %16s %16s %16s %16s\n", "projectiles", "bytes", "before (ns)", "before (allocs)",
+		   "after (ns)", "after (allocs)", "send (ns)", "send (allocs)");
+	for (const int* load : loads) {
+		Snapshot_Bench bench;
+		bench.fill(load[0], load[1]);
+		snapshot_result before = bench.time_legacy(snapshots);
+		snapshot_result after = bench.time_writer(snapshots);
+		snapshot_result send = bench.time_send(snapshots);
+		printf("%12d %8zu %16.0f %16.2f %16.0f %16.2f %16.0f %16.2f\n", load[0], bench.snapshot_size(), before.ns,
+			   before.allocations, after.ns, after.allocations, send.ns, send.allocations);
+		if (send.allocations > 0) {
+			printf("send_message allocated with %d projectiles and %d bombs\n", load[0], load[1]);
+			failures++;
+		}
+	}
+
+	return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+/*
+Spatial grid header file
+A uniform grid over the playing field, used to find the objects that might be touching a box
+before running the exact collision checks
+
+Chaos The Game
+
+The field is split into square cells. An object is added to every cell its bounding box covers,
+and a query returns each object whose box overlaps the query's box, once, in the order the objects
+were added. Objects are added in the same order as the sets the arena used to loop over, so the
+collision checks still run in the same order and give the same results.
+The grid is cleared and filled again whenever the objects in it move. The cells keep their memory
+between fills, so once the grid has grown to fit a game nothing more is allocated.
+*/
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "polygon.h"
+#include "point_vect_struct.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+/*
+A bounding box, the edges are included.
+*/
+typedef struct grid_box {
+	int min_x;
+	int min_y;
+	int max_x;
+	int max_y;
+} grid_box;
+
+// the box around every point of the polygon, grown by margin on each side
+inline grid_box polygon_box(const Polygon& polygon, int margin) {
+	grid_box box;
+	box.min_x = polygon.points[0].x;
+	box.min_y = polygon.points[0].y;
+	box.max_x = box.min_x;
+	box.max_y = box.min_y;
+	for (int i = 1; i < polygon.num_points; i++) {
+		const point& p = polygon.points[i];
+		box.min_x = min(box.min_x, p.x);
+		box.min_y = min(box.min_y, p.y);
+		box.max_x = max(box.max_x, p.x);
+		box.max_y = max(box.max_y, p.y);
+	}
+	box.min_x -= margin;
+	box.min_y -= margin;
+	box.max_x += margin;
+	box.max_y += margin;
+	return box;
+}
+
+// the box around a circle, rounded outwards
+inline grid_box circle_box(double x, double y, double radius) {
+	grid_box box;
+	box.min_x = (int) floor(x - radius);
+	box.min_y = (int) floor(y - radius);
+	box.max_x = (int) ceil(x + radius);
+	box.max_y = (int) ceil(y + radius);
+	return box;
+}
+
+// true if the boxes share at least one point
+inline bool boxes_overlap(const grid_box& a, const grid_box& b) {
+	return (a.min_x <= b.max_x) && (b.min_x <= a.max_x) && (a.min_y <= b.max_y) && (b.min_y <= a.max_y);
+}
+
+
+template <typename T>
+class Spatial_Grid {
+
+public:
+	// covers a width by height field with square cells, objects outside the field go in the edge cells
+	Spatial_Grid(int width, int height, int cell_size);
+	~Spatial_Grid();
+
+	// removes every object, keeps the memory
+	void clear();
+	// adds an object covering the box
+	void insert(T* item, const grid_box& box);
+	// replaces found with every object whose box overlaps the box, in the order they were added
+	void query(const grid_box& box, vector<T*>& found);
+
+	// the number of objects in the grid
+	int size() const;
+
+private:
+	// the range of cells a box covers
+	void cell_range(const grid_box& box, int& first_column, int& first_row, int& last_column, int& last_row) const;
+
+	int columns;
+	int rows;
+	int cell_size;
+
+	// the objects in each cell, as indexes into items, row by row
+	vector<vector<int>> cells;
+	// the cells that have had an object added since the last clear, only these need emptying
+	vector<int> used_cells;
+	// every object and its box, in the order they were added
+	vector<T*> items;
+	vector<grid_box> boxes;
+	// the last query each object was found by, so an object in several cells is only returned once
+	vector<unsigned int> last_query;
+	unsigned int query_count;
+	// the indexes found by the current query, sorted before being returned
+	vector<int> found_indexes;
+
+};
+
+
+template <typename T>
+Spatial_Grid<T>::Spatial_Grid(int width, int height, int cell_size) : cell_size(cell_size) {
+	columns = (width + cell_size - 1) / cell_size;
+	rows = (height + cell_size - 1) / cell_size;
+	cells.resize(columns * rows);
+	query_count = 0;
+}
+
+template <typename T>
+Spatial_Grid<T>::~Spatial_Grid() {
+	// the grid does not own its objects
+}
+
+template <typename T>
+void Spatial_Grid<T>::clear() {
+	for (int cell : used_cells) {
+		cells[cell].clear();
+	}
+	used_cells.clear();
+	items.clear();
+	boxes.clear();
+	last_query.clear();
+}
+
+template <typename T>
+void Spatial_Grid<T>::insert(T* item, const grid_box& box) {
+	int index = items.size();
+	items.push_back(item);
+	boxes.push_back(box);
+	last_query.push_back(query_count);
+
+	int first_column, first_row, last_column, last_row;
+	cell_range(box, first_column, first_row, last_column, last_row);
+	for (int row = first_row; row <= last_row; row++) {
+		for (int column = first_column; column <= last_column; column++) {
+			vector<int>& cell = cells[row * columns + column];
+			if (cell.empty()) {
+				used_cells.push_back(row * columns + column);
+			}
+			cell.push_back(index);
+		}
+	}
+}
+
+template <typename T>
+void Spatial_Grid<T>::query(const grid_box& box, vector<T*>& found) {
+	found.clear();
+	found_indexes.clear();
+	query_count++;
+
+	int first_column, first_row, last_column, last_row;
+	cell_range(box, first_column, first_row, last_column, last_row);
+	for (int row = first_row; row <= last_row; row++) {
+		for (int column = first_column; column <= last_column; column++) {
+			for (int index : cells[row * columns + column]) {
+				if (last_query[index] == query_count) {
+					continue;
+				}
+				last_query[index] = query_count;
+
+				// the cells are coarse, the boxes themselves rule out most of what shares a cell
+				if (boxes_overlap(box, boxes[index])) {
+					found_indexes.push_back(index);
+				}
+			}
+		}
+	}
+
+	// only a few objects are found at a time, sorting them restores the order they were added
+	sort(found_indexes.begin(), found_indexes.end());
+	for (int index : found_indexes) {
+		found.push_back(items[index]);
+	}
+}
+
+template <typename T>
+int Spatial_Grid<T>::size() const {
+	return items.size();
+}
+
+template <typename T>
+void Spatial_Grid<T>::cell_range(const grid_box& box, int& first_column, int& first_row, int& last_column,
+								 int& last_row) const {
+	// negative coordinates must round down, not towards zero
+	first_column = (int) floor((double) box.min_x / cell_size);
+	first_row = (int) floor((double) box.min_y / cell_size);
+	last_column = (int) floor((double) box.max_x / cell_size);
+	last_row = (int) floor((double) box.max_y / cell_size);
+
+	first_column = min(max(first_column, 0), columns - 1);
+	first_row = min(max(first_row, 0), rows - 1);
+	last_column = min(max(last_column, 0), columns - 1);
+	last_row = min(max(last_row, 0), rows - 1);
+}
+
+#endif
@@ -0,0 +1,102 @@
+/*
+SPSC queue header file
+A fixed-size, lock-free queue with exactly one producer thread and one consumer thread
+
+Chaos The Game
+
+The entries live in an array that is allocated once, so pushing and popping never allocate.
+Meant for small, plain records that are cheap to copy.
+*/
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+
+template <typename T>
+class SPSC_Queue {
+
+public:
+	// the capacity is rounded up to a power of two
+	SPSC_Queue(size_t capacity);
+	~SPSC_Queue();
+
+	// the queue owns its entries, so it cannot be copied
+	SPSC_Queue(const SPSC_Queue&) = delete;
+	SPSC_Queue& operator=(const SPSC_Queue&) = delete;
+
+	// copies an entry into the queue, returns false if the queue is full
+	// must only be called from the producer thread
+	bool try_push(const T& item);
+
+	// copies the oldest entry out of the queue, returns false if the queue is empty
+	// must only be called from the consumer thread
+	bool try_pop(T& item);
+
+private:
+	T* entries;
+	// capacity - 1, used to wrap positions around the ring
+	size_t mask;
+
+	// kept on separate cache lines so the producer and the consumer do not slow each other down
+	// the position of the next entry to push, only written by the producer
+	alignas(64) atomic<size_t> tail;
+	// the position of the next entry to pop, only written by the consumer
+	alignas(64) atomic<size_t> head;
+
+};
+
+
+template <typename T>
+SPSC_Queue<T>::SPSC_Queue(size_t capacity) {
+	// round up to a power of two so positions can be wrapped with a mask
+	size_t size = 2;
+	while (size < capacity) {
+		size *= 2;
+	}
+	mask = size - 1;
+
+	entries = new T[size];
+	tail.store(0, memory_order_relaxed);
+	head.store(0, memory_order_relaxed);
+}
+
+template <typename T>
+SPSC_Queue<T>::~SPSC_Queue() {
+	delete[] entries;
+}
+
+template <typename T>
+bool SPSC_Queue<T>::try_push(const T& item) {
+	size_t position = tail.load(memory_order_relaxed);
+
+	// the consumer has not yet popped the entry a full ring behind this one
+	if (position - head.load(memory_order_acquire) > mask) {
+		return false;
+	}
+
+	entries[position & mask] = item;
+	// publish the entry to the consumer
+	tail.store(position + 1, memory_order_release);
+	return true;
+}
+
+template <typename T>
+bool SPSC_Queue<T>::try_pop(T& item) {
+	size_t position = head.load(memory_order_relaxed);
+
+	if (position == tail.load(memory_order_acquire)) {
+		return false;
+	}
+
+	item = entries[position & mask];
+	// hand the entry back to the producer
+	head.store(position + 1, memory_order_release);
+	return true;
+}
+
+#endif
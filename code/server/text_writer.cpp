@@ -0,0 +1,22 @@
+/*
+Text writer file
+Builds text messages in a buffer that is kept and reused from one message to the next
+
+Chaos The Game
+*/
+
+#include "text_writer.h"
+
+#include <string>
+
+using namespace std;
+
+
+Text_Writer::Text_Writer() {
+	buffer.reserve(INITIAL_CAPACITY);
+}
+
+// the buffer frees itself
+Text_Writer::~Text_Writer() {
+
+}
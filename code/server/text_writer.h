@@ -0,0 +1,78 @@
+/*
+Text writer class header file
+Builds text messages in a buffer that is kept and reused from one message to the next
+
+Chaos The Game
+
+Numbers are formatted with to_chars, which gives the same digits as to_string without
+creating a temporary string. Once the buffer has grown to fit the largest message, writing
+a message does not allocate.
+*/
+
+#ifndef TEXT_WRITER_H
+#define TEXT_WRITER_H
+
+#include <string>
+#include <charconv>
+#include <cstddef>
+
+using namespace std;
+
+
+class Text_Writer {
+
+public:
+	Text_Writer();
+	~Text_Writer();
+	
+	// empty the buffer for a new message, keeps the memory it has already allocated
+	void clear();
+	
+	// append to the message
+	void write_char(char c);
+	void write_int(int value);
+	void write_string(const string& text);
+	
+	// the message written since the last clear, only valid until the next write
+	const char* data() const;
+	size_t size() const;
+
+private:
+	// the memory reserved up front, enough for a full arena with a few hundred projectiles
+	static const size_t INITIAL_CAPACITY = 4096;
+	
+	string buffer;
+
+};
+
+
+// the appenders are called for every value of every snapshot, so they are kept inline
+
+inline void Text_Writer::clear() {
+	buffer.clear();
+}
+
+inline void Text_Writer::write_char(char c) {
+	buffer.push_back(c);
+}
+
+inline void Text_Writer::write_int(int value) {
+	// enough for the sign and every digit of the smallest int
+	char digits[12];
+	to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+	buffer.append(digits, result.ptr - digits);
+}
+
+inline void Text_Writer::write_string(const string& text) {
+	buffer.append(text);
+}
+
+inline const char* Text_Writer::data() const {
+	return buffer.data();
+}
+
+inline size_t Text_Writer::size() const {
+	return buffer.size();
+}
+
+#endif
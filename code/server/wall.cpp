@@ -7,6 +7,7 @@ Chaos The Game
 #include "wall.h"
 
 #include "polygon.h"
+#include "rotation_table.h"
 
 #include <iostream>
 #include <cmath>
@@ -31,6 +32,9 @@ Wall::Wall(int x, int y, int rot) : posX(x), posY(y) {
 	// set rectangle dimensions for the collision box
 	body.rect_height = WALL_HEIGHT;
 	
+	body_built = false;
+	body_rebuilds = 0;
+	body_reuses = 0;
 	update_points();
 }
 
@@ -41,22 +45,29 @@ Wall::~Wall() {
 
 // update the position of the two endpoints
 void Wall::update_points() {
-	// calculate the unit vectors normal to the rectangle along both axes
-	vect v1;
-	v1.x = sin(newRotation * (M_PI / 180));
-	v1.y = - cos(newRotation * (M_PI / 180));
+	// the body is already at the wall's position and rotations
+	if (body_built && (posX == body_x) && (posY == body_y) && (rotation == body_rotation) &&
+		(newRotation == body_new_rotation)) {
+		body_reuses++;
+		return;
+	}
+	body_built = true;
+	body_x = posX;
+	body_y = posY;
+	body_rotation = rotation;
+	body_new_rotation = newRotation;
+	body_rebuilds++;
 	
-	// scale both vectors
-	v1.x *= WALL_HEIGHT / 2;
-	v1.y *= WALL_HEIGHT / 2;
+	// the vector from the center to one end, already scaled to the wall's length
+	half_side v1 = Rotation_Table::wall_length(newRotation);
 	
-	// clear the points vector
-	body.points.clear();
+	// clear the points
+	body.clear_points();
 	
 	point p1((int) (posX + v1.x + 0.5), (int) (posY + v1.y + 0.5));
 	point p2((int) (posX - v1.x + 0.5), (int) (posY - v1.y + 0.5));
-	body.points.push_back(p1);
-	body.points.push_back(p2);
+	body.add_point(p1);
+	body.add_point(p2);
 	
 	// set other values for the collision box
 	body.center.x = posX;
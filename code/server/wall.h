@@ -37,10 +37,24 @@ public:
 	bool can_rotate;
 	
 	// calculate the coordinates of each point in the polygon
+	// the body is kept until the wall's position or either rotation changes, most walls stop rotating early in a game
 	void update_points();
 	
 	// the collision body
 	Polygon body;
+	
+	// the number of times the body has been rebuilt, and kept because it had not changed
+	// counted and cleared by the arena each frame
+	int body_rebuilds;
+	int body_reuses;
+
+private:
+	// the position and rotations the body was last built at
+	bool body_built;
+	int body_x;
+	int body_y;
+	int body_rotation;
+	int body_new_rotation;
 
 };
 
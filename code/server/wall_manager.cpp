@@ -8,8 +8,10 @@ Chaos the Game
 #include "wall_manager.h"
 
 #include "wall.h"
+#include "object_pool.h"
 
-#include <set>
+#include <vector>
+#include <algorithm>
 #include <chrono>
 // used for random number generation
 #include <stdio.h>
@@ -17,12 +19,16 @@ Chaos the Game
 #include <time.h>
 
 
-Wall_Manager::Wall_Manager() {
+Wall_Manager::Wall_Manager() : wall_pool(NUM_WALLS) {
 	waiting_time = 2.0;
+	walls.reserve(NUM_WALLS);
+	unrotated_walls.reserve(NUM_WALLS);
+	rotating_walls.reserve(NUM_WALLS);
+	finished_rotating_walls.reserve(NUM_WALLS);
 }
 
 Wall_Manager::~Wall_Manager() {
-	// if the game is suddenly shut down, deallocate the memory used for walls
+	// if the game is suddenly shut down, return the walls to the pool
 	clean_up();
 }
 
@@ -34,29 +40,21 @@ void Wall_Manager::start() {
 
 void Wall_Manager::create_walls() {
 	// bottom walls
-	Wall* w1 = new Wall(280, 500, 0);
-	Wall* w2 = new Wall(480, 500, 0);
-	Wall* w3 = new Wall(680, 500, 0);
-	walls.insert(w1);
-	walls.insert(w2);
-	walls.insert(w3);
+	walls.push_back(wall_pool.create(280, 500, 0));
+	walls.push_back(wall_pool.create(480, 500, 0));
+	walls.push_back(wall_pool.create(680, 500, 0));
 	
 	// top walls
-	Wall* w4 = new Wall(280, 140, 0);
-	Wall* w5 = new Wall(480, 140, 0);
-	Wall* w6 = new Wall(680, 140, 0);
-	walls.insert(w4);
-	walls.insert(w5);
-	walls.insert(w6);
+	walls.push_back(wall_pool.create(280, 140, 0));
+	walls.push_back(wall_pool.create(480, 140, 0));
+	walls.push_back(wall_pool.create(680, 140, 0));
 	
 	// side walls
-	Wall* w7 = new Wall(180, 320, 90);
-	Wall* w8 = new Wall(780, 320, 90);
-	walls.insert(w7);
-	walls.insert(w8);
+	walls.push_back(wall_pool.create(180, 320, 90));
+	walls.push_back(wall_pool.create(780, 320, 90));
 	
 	for (Wall* wall : walls) {
-		unrotated_walls.insert(wall);
+		unrotated_walls.push_back(wall);
 	}
 }
 
@@ -71,13 +69,10 @@ void Wall_Manager::update_walls() {
 		if (elapsed_seconds.count() > waiting_time) {
 			srand(time(NULL));
 			int index = rand() % unrotated_walls.size();
-			set<Wall*>::iterator itr = unrotated_walls.begin();
-			advance(itr, index);
-			Wall* wall = *itr;
+			Wall* wall = unrotated_walls[index];
 			
 			// move the wall to the rotating group
-			unrotated_walls.erase(wall);
-			rotating_walls.insert(wall);
+			move_wall(wall, unrotated_walls, rotating_walls);
 			
 			// update the timer
 			start_time += chrono::milliseconds((int) waiting_time * 1000);
@@ -85,32 +80,46 @@ void Wall_Manager::update_walls() {
 	}
 	
 	// rotate walls
-	for (Wall* wall : rotating_walls) {
+	// the walls still rotating are moved down over the finished ones, keeping their order
+	int kept = 0;
+	for (int i = 0; i < (int) rotating_walls.size(); i++) {
+		Wall* wall = rotating_walls[i];
 		if (wall->can_rotate) {
 			wall->rotation = wall->newRotation;
 		}
 		
 		// check if the wall has reached its target rotation
 		if (wall->rotation == wall->target_rotation) {
-			rotating_walls.erase(wall);
-			finished_rotating_walls.insert(wall);
+			finished_rotating_walls.push_back(wall);
+		} else {
+			rotating_walls[kept] = wall;
+			kept++;
 		}
 	}
+	rotating_walls.resize(kept);
+}
+
+void Wall_Manager::move_wall(Wall* wall, vector<Wall*>& from, vector<Wall*>& to) {
+	vector<Wall*>::iterator itr = find(from.begin(), from.end(), wall);
+	if (itr != from.end()) {
+		from.erase(itr);
+	}
+	to.push_back(wall);
 }
 
 // free memory and prepare for the arena to be reset
 void Wall_Manager::clean_up() {
-	// empty the three sets of walls
-	// do not delete the walls yet, they will all be deleted from the set of all walls
+	// empty the three lists of walls
+	// do not destroy the walls yet, they will all be destroyed from the list of all walls
 	unrotated_walls.clear();
 	rotating_walls.clear();
 	finished_rotating_walls.clear();
 	
-	// remove the walls from the set and delete the walls
+	// return the walls to the pool, then empty the list
 	for (Wall* wall : walls) {
-		walls.erase(wall);
-		delete wall;
+		wall_pool.destroy(wall);
 	}
+	walls.clear();
 }
 
 
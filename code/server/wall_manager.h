@@ -9,8 +9,9 @@ Chaos the Game
 #define WALL_MANAGER_H
 
 #include "wall.h"
+#include "object_pool.h"
 
-#include <set>
+#include <vector>
 #include <chrono>
 // used for random number generation
 #include <stdio.h>
@@ -30,14 +31,23 @@ public:
 	void create_walls();
 	void update_walls();
 	
+	// moves a wall from one of the lists of states to another
+	void move_wall(Wall* wall, vector<Wall*>& from, vector<Wall*>& to);
+	
 	// free memory and prepare for the arena to be reset
 	void clean_up();
 	
-	set<Wall*> walls;
-	// sets for the 3 states a wall can be in
-	set<Wall*> unrotated_walls;
-	set<Wall*> rotating_walls;
-	set<Wall*> finished_rotating_walls;
+	// the number of interior walls in a game
+	static const int NUM_WALLS = 8;
+	// the walls are created in the pool, declared before the lists so it outlives them
+	Object_Pool<Wall> wall_pool;
+	
+	// every wall, in the order they were created
+	vector<Wall*> walls;
+	// lists for the 3 states a wall can be in, each has room for every wall
+	vector<Wall*> unrotated_walls;
+	vector<Wall*> rotating_walls;
+	vector<Wall*> finished_rotating_walls;
 	
 	chrono::time_point<chrono::system_clock> start_time;
 	